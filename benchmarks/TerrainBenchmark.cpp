@@ -0,0 +1,245 @@
+/**
+ * Terrain streaming benchmark
+ * Drives Terrain::update along scripted flight paths without opening a window
+ *
+ * Reports per run:
+ * - Chunks generated per second of update time
+ * - p50/p99/max time spent in Terrain::update
+ * - Peak resident chunk memory
+ * - Terrain::getHeightAt cost per query
+ *
+ * Usage:
+ *   TerrainBenchmark [--path straight|circle|zigzag|all]
+ *                    [--aircraft cessna|737|a320|f16|f22|all]
+ *                    [--speed <m/s>] [--duration <seconds>] [--dt <seconds>]
+ */
+
+#include "Terrain.h"
+#include "Aircraft.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum class FlightPath {
+    STRAIGHT,
+    CIRCLE,
+    ZIGZAG
+};
+
+struct BenchmarkConfig {
+    std::vector<FlightPath> paths = {FlightPath::STRAIGHT, FlightPath::CIRCLE, FlightPath::ZIGZAG};
+    std::vector<AircraftType> aircraft = {AircraftType::CESSNA_172, AircraftType::BOEING_737,
+                                          AircraftType::F16_FIGHTER, AircraftType::F22_RAPTOR};
+    float speedOverride = 0.0f;    // m/s, 0 = use aircraft max speed
+    float duration = 120.0f;       // Simulated seconds per run
+    float dt = 1.0f / 60.0f;       // Simulated frame time
+};
+
+struct BenchmarkResult {
+    int frames = 0;
+    int chunksGenerated = 0;
+    double totalUpdateMs = 0.0;
+    double p50Ms = 0.0;
+    double p99Ms = 0.0;
+    double maxMs = 0.0;
+    size_t peakMemory = 0;
+};
+
+const char* pathName(FlightPath path) {
+    switch (path) {
+        case FlightPath::STRAIGHT: return "straight";
+        case FlightPath::CIRCLE:   return "circle";
+        case FlightPath::ZIGZAG:   return "zigzag";
+    }
+    return "?";
+}
+
+// Position along the scripted path after t seconds at the given ground speed
+Vector3 positionOnPath(FlightPath path, float t, float speed) {
+    const float altitude = 1000.0f;
+
+    switch (path) {
+        case FlightPath::STRAIGHT:
+            return Vector3(speed * t, altitude, 0.0f);
+
+        case FlightPath::CIRCLE: {
+            // 3 km radius orbit around the origin
+            float radius = 3000.0f;
+            float angle = speed * t / radius;
+            return Vector3(radius * std::sin(angle), altitude, radius * std::cos(angle));
+        }
+
+        case FlightPath::ZIGZAG: {
+            // Alternate +/-45 degree legs every 20 seconds, net progress along +X
+            float legTime = 20.0f;
+            float leg = speed * legTime * 0.7071f;
+            int legIndex = (int)(t / legTime);
+            float legT = (t - legIndex * legTime) / legTime;
+            float x = speed * t * 0.7071f;
+            float z = (legIndex % 2 == 0) ? legT * leg : (1.0f - legT) * leg;
+            return Vector3(x, altitude, z);
+        }
+    }
+    return Vector3(0.0f, altitude, 0.0f);
+}
+
+BenchmarkResult runStreaming(FlightPath path, float speed, const BenchmarkConfig& config) {
+    BenchmarkResult result;
+
+    Terrain terrain;
+    terrain.generate(32, 10.0f);  // Same chunk setup as Game::initialize
+    int initialChunks = terrain.getChunksGenerated();
+
+    std::vector<double> frameTimes;
+    int frameCount = (int)(config.duration / config.dt);
+    frameTimes.reserve(frameCount);
+
+    for (int i = 0; i < frameCount; ++i) {
+        Vector3 position = positionOnPath(path, i * config.dt, speed);
+
+        auto start = Clock::now();
+        terrain.update(config.dt, position);
+        auto end = Clock::now();
+
+        frameTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        result.peakMemory = std::max(result.peakMemory, terrain.getResidentMemory());
+    }
+
+    result.frames = frameCount;
+    result.chunksGenerated = terrain.getChunksGenerated() - initialChunks;
+    for (double t : frameTimes) {
+        result.totalUpdateMs += t;
+    }
+
+    std::sort(frameTimes.begin(), frameTimes.end());
+    if (!frameTimes.empty()) {
+        result.p50Ms = frameTimes[frameTimes.size() / 2];
+        result.p99Ms = frameTimes[std::min(frameTimes.size() - 1, frameTimes.size() * 99 / 100)];
+        result.maxMs = frameTimes.back();
+    }
+
+    return result;
+}
+
+// Cold generation of the initial area around the origin, in microseconds per chunk
+double measureChunkGeneration() {
+    double best = 1e30;
+    for (int rep = 0; rep < 5; ++rep) {
+        Terrain terrain;
+        auto start = Clock::now();
+        terrain.generate(32, 10.0f);
+        auto end = Clock::now();
+
+        double us = std::chrono::duration<double, std::micro>(end - start).count();
+        best = std::min(best, us / std::max(1, terrain.getChunksGenerated()));
+    }
+    return best;
+}
+
+double measureHeightQueries() {
+    Terrain terrain;
+    terrain.generate(32, 10.0f);
+
+    const int queryCount = 1000000;
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> dist(-20000.0f, 20000.0f);
+    std::vector<Vector3> points(queryCount);
+    for (auto& p : points) {
+        p = Vector3(dist(rng), 0.0f, dist(rng));
+    }
+
+    volatile float sink = 0.0f;
+    auto start = Clock::now();
+    for (const auto& p : points) {
+        sink = sink + terrain.getHeightAt(p.x, p.z);
+    }
+    auto end = Clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / queryCount;
+}
+
+bool parseArgs(int argc, char* argv[], BenchmarkConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string value = (i + 1 < argc) ? argv[i + 1] : "";
+
+        if (arg == "--path" && !value.empty()) {
+            ++i;
+            if (value == "straight") config.paths = {FlightPath::STRAIGHT};
+            else if (value == "circle") config.paths = {FlightPath::CIRCLE};
+            else if (value == "zigzag") config.paths = {FlightPath::ZIGZAG};
+            else if (value != "all") return false;
+        } else if (arg == "--aircraft" && !value.empty()) {
+            ++i;
+            if (value == "cessna") config.aircraft = {AircraftType::CESSNA_172};
+            else if (value == "737") config.aircraft = {AircraftType::BOEING_737};
+            else if (value == "a320") config.aircraft = {AircraftType::A320_AIRBUS};
+            else if (value == "f16") config.aircraft = {AircraftType::F16_FIGHTER};
+            else if (value == "f22") config.aircraft = {AircraftType::F22_RAPTOR};
+            else if (value != "all") return false;
+        } else if (arg == "--speed" && !value.empty()) {
+            ++i;
+            config.speedOverride = std::strtof(value.c_str(), nullptr);
+        } else if (arg == "--duration" && !value.empty()) {
+            ++i;
+            config.duration = std::max(1.0f, std::strtof(value.c_str(), nullptr));
+        } else if (arg == "--dt" && !value.empty()) {
+            ++i;
+            config.dt = std::max(0.001f, std::strtof(value.c_str(), nullptr));
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchmarkConfig config;
+    if (!parseArgs(argc, argv, config)) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--path straight|circle|zigzag|all]"
+                  << " [--aircraft cessna|737|a320|f16|f22|all]"
+                  << " [--speed m/s] [--duration s] [--dt s]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Terrain streaming benchmark" << std::endl;
+    std::printf("Chunk generation:   %8.1f us/chunk\n", measureChunkGeneration());
+    std::printf("getHeightAt:        %8.1f ns/query\n", measureHeightQueries());
+    std::cout << std::endl;
+
+    std::printf("%-10s %-22s %8s %8s %10s %9s %9s %9s %10s\n",
+                "path", "aircraft", "speed", "chunks", "chunks/s", "p50 ms", "p99 ms", "max ms", "peak MB");
+
+    for (AircraftType type : config.aircraft) {
+        Aircraft aircraft(type);
+        const AircraftSpecs& specs = aircraft.getSpecs();
+        float speed = config.speedOverride > 0.0f ? config.speedOverride : specs.maxSpeed / 3.6f;
+
+        for (FlightPath path : config.paths) {
+            BenchmarkResult result = runStreaming(path, speed, config);
+            double chunksPerSec = result.totalUpdateMs > 0.0
+                ? result.chunksGenerated / (result.totalUpdateMs / 1000.0) : 0.0;
+
+            std::printf("%-10s %-22s %6.0f/s %8d %10.0f %9.3f %9.3f %9.3f %10.2f\n",
+                        pathName(path), specs.name.c_str(), speed, result.chunksGenerated,
+                        chunksPerSec, result.p50Ms, result.p99Ms, result.maxMs,
+                        result.peakMemory / (1024.0 * 1024.0));
+        }
+    }
+
+    return 0;
+}
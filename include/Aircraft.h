@@ -21,12 +21,15 @@ public:
     
     // Setters for demo/spawn
     void setPosition(const Vector3& pos) { position = pos; onGround = (pos.y < 10); }
+    void setRotation(const Vector3& rot) { rotation = rot; }
+    void setVelocity(const Vector3& vel) { velocity = vel; }
     
     // Getters
     const Vector3& getPosition() const { return position; }
     const Vector3& getRotation() const { return rotation; }
     const Vector3& getVelocity() const { return velocity; }
     const AircraftSpecs& getSpecs() const { return specs; }
+    AircraftType getType() const { return type; }
     
     float getThrottle() const { return throttle; }
     float getSpeed() const { return speed; }
@@ -38,6 +41,7 @@ public:
     int getFlapsLevel() const { return flapsLevel; }
     bool isLandingGearDown() const { return landingGearDown; }
     float getGearAnimationState() const { return gearAnimationState; }  // 0=up, 1=down
+    float getGearHeight() const { return landingGearDown ? 3.0f : 1.5f; }  // Origin above the ground when on it
     float getFlapsAnimationState() const { return flapsLevel / 3.0f; }  // 0-1
     bool isOnGround() const { return onGround; }
     bool isStalling() const { return stalling; }
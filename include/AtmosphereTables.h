@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Types.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Precomputed Rayleigh and Mie scattering of sunlight in an Earth-like
+// atmosphere, after Bruneton's precomputed atmospheric scattering: a table
+// of transmittance by altitude and zenith angle, and a table of single
+// scattering by altitude, view zenith, sun zenith and the angle between view
+// and sun. Building them integrates along every ray and takes a moment on
+// all cores, so they are written to a cache file and read back on later
+// runs; after that a sky color is a handful of table lookups, at any
+// altitude and sun angle.
+//
+// Only single scattering is modelled, so twilight skies come out somewhat
+// darker than real ones.
+class AtmosphereTables {
+public:
+    AtmosphereTables();
+    ~AtmosphereTables();
+    
+    // Reads the tables from cachePath, or builds them and writes them there.
+    // False if they could not be built; failing to write the cache only costs
+    // the next run a rebuild.
+    bool initialize(const std::string& cachePath);
+    bool isReady() const { return !scattering.empty(); }
+    bool wasCached() const { return cached; }
+    
+    // Share of sunlight left after crossing the atmosphere down to altitude
+    // (meters) from a direction at cosZenith from straight up
+    Color getTransmittance(float altitude, float cosZenith) const;
+    
+    // Light scattered towards a viewer at altitude (meters) looking along
+    // direction, +y up, from a sun of unit irradiance towards sunDirection
+    Color getSkyRadiance(float altitude, const Vector3& direction, const Vector3& sunDirection) const;
+    
+private:
+    // Cache file layout: this header, the transmittance table, then the
+    // scattering table, all floats
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t sizes[6];          // Table dimensions, in the order of the constants
+        uint32_t parameters;        // Hash of the atmosphere constants
+        uint32_t reserved;
+    };
+    
+    bool build();                   // False, leaving the tables empty, on non-finite values
+    bool readCache(const std::string& cachePath);
+    void writeCache(const std::string& cachePath) const;
+    static Header makeHeader();
+    
+    // RGB per texel, kTransmittanceMuSize wide
+    std::vector<float> transmittance;
+    
+    // Rayleigh RGB then Mie RGB per texel; nu, then mu_s, mu and r from the
+    // fastest varying index to the slowest
+    std::vector<float> scattering;
+    bool cached = false;
+};
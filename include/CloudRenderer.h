@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Types.h"
+#include "ShaderProgram.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class Sky;
+class Frustum;
+class GLStateCache;
+class StreamBuffer;
+
+// Draws the sky's cloud puffs as camera-facing billboards. Clouds are culled
+// against the frustum as a whole, their puffs sorted back to front and drawn
+// in one call: instanced from a per-puff buffer when GL 3.3 is available,
+// otherwise expanded into quads on the CPU.
+class CloudRenderer {
+public:
+    CloudRenderer();
+    ~CloudRenderer();
+    
+    CloudRenderer(const CloudRenderer&) = delete;
+    CloudRenderer& operator=(const CloudRenderer&) = delete;
+    
+    void initialize(GLStateCache& state);
+    void release();
+    
+    // When set, prepare() writes instanced puffs straight into the stream
+    // buffer instead of a buffer uploaded at draw time
+    void setStreamBuffer(StreamBuffer* buffer) { stream = buffer; }
+    
+    // Each view has its own sorted puffs; set the count before preparing
+    void setViewCount(int count);
+    
+    // Culls, sorts and shades the puffs for one view. Makes no GL calls, so
+    // different views can be prepared on worker threads at the same time.
+    void prepare(int view, const Sky& sky, const Vector3& cameraPosition, const Matrix4& viewMatrix,
+                 const Frustum& frustum);
+    
+    // Draws what the last prepare() produced for the view. Expects its view
+    // matrix to be loaded as the modelview matrix.
+    void draw(int view, GLStateCache& state);
+    
+    // Counts from the last prepare() of the view
+    int getPuffsDrawn(int view) const { return views[view].puffsDrawn; }
+    int getPuffsCulled(int view) const { return views[view].puffsCulled; }
+    float getFarthestDistance(int view) const { return views[view].farthestDistance; }
+    
+private:
+    // Per-puff instance data
+    struct Instance {
+        float center[3];
+        float size;
+        uint8_t color[4];
+    };
+    
+    // Expanded quad corner for the fallback path
+    struct QuadVertex {
+        float position[3];
+        float texCoord[2];
+        uint8_t color[4];
+    };
+    
+    // Per-view scratch, kept to avoid reallocating
+    struct ViewBatch {
+        std::vector<uint8_t> cloudVisible;
+        std::vector<std::pair<float, int>> order;   // Squared distance, puff index
+        std::vector<Instance> instances;            // Unless streamed
+        bool streamed = false;
+        size_t streamOffset = 0;
+        std::vector<QuadVertex> quads;
+        int puffsDrawn = 0;
+        int puffsCulled = 0;
+        float farthestDistance = 0.0f;              // Of the first puff drawn
+    };
+    
+    void createTexture();
+    void drawInstanced(const ViewBatch& batch, GLStateCache& state);
+    void buildQuads(ViewBatch& batch, const Matrix4& viewMatrix);
+    void drawQuads(const ViewBatch& batch, GLStateCache& state);
+    
+    GLStateCache* state = nullptr;
+    StreamBuffer* stream = nullptr;
+    ShaderProgram program;
+    unsigned int cornerBuffer = 0;      // The four billboard corners
+    unsigned int instanceBuffer = 0;
+    unsigned int texture = 0;           // Soft round puff mask
+    
+    std::vector<ViewBatch> views;
+};
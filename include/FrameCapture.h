@@ -0,0 +1,83 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class GLStateCache;
+
+// Records rendered frames to disk. Each frame is read back into one of a
+// small ring of pixel buffer objects and only mapped a couple of frames
+// later, once the GPU has finished the copy, so readback never waits on the
+// frame that was just drawn. Encoding and file I/O run on a writer thread.
+class FrameCapture {
+public:
+    enum class Format {
+        Y4M,        // YUV 4:2:0 video stream (ffmpeg, mpv and most players read it)
+        RAW,        // Headerless rgb24 frames, top row first
+        PNG         // Numbered image sequence, stored without compression
+    };
+    
+    // From the file extension: .y4m, .png, anything else is raw
+    static Format formatForPath(const std::string& path);
+    
+    FrameCapture();
+    ~FrameCapture();
+    
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+    
+    // For PNG the path may contain a printf pattern such as frame_%05d.png;
+    // otherwise the frame number is added before the extension
+    bool start(const std::string& path, int width, int height, int fps, GLStateCache& state);
+    
+    // Call once per frame after everything has been drawn, before the swap
+    void captureFrame();
+    
+    // Writes out the frames still in flight and closes the output
+    void stop();
+    
+    bool isActive() const { return active; }
+    
+private:
+    static constexpr int kRingSize = 3;
+    static constexpr size_t kMaxQueuedFrames = 8;   // Bounds memory if the disk falls behind
+    
+    void collect(int slot);
+    void writerLoop();
+    void writeFrame(const std::vector<uint8_t>& rgba, int frameIndex);
+    void writeY4M(const std::vector<uint8_t>& rgba);
+    void writeRaw(const std::vector<uint8_t>& rgba);
+    void writePNG(const std::vector<uint8_t>& rgba, int frameIndex);
+    std::string framePath(int frameIndex) const;
+    
+    GLStateCache* state = nullptr;
+    bool active = false;
+    
+    Format format = Format::Y4M;
+    std::string path;
+    int width = 0;
+    int height = 0;
+    int fps = 60;
+    
+    unsigned int pixelBuffers[kRingSize] = {};
+    int framesIssued = 0;
+    int framesCollected = 0;
+    
+    // Main thread -> writer thread
+    std::thread writer;
+    std::mutex queueMutex;
+    std::condition_variable queueChanged;
+    std::deque<std::vector<uint8_t>> queuedFrames;
+    std::vector<std::vector<uint8_t>> freeFrames;
+    bool stopping = false;
+    
+    // Writer thread only
+    std::ofstream stream;               // Y4M and raw output
+    std::vector<uint8_t> scratch;       // Converted frame
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Types.h"
+
+// View frustum for visibility culling, extracted from a view-projection matrix
+class Frustum {
+public:
+    Frustum();
+    
+    void extract(const Matrix4& viewProjection);
+    
+    // Conservative tests: may report visible for objects just outside a corner
+    bool intersects(const AABB& box) const;
+    bool intersectsSphere(const Vector3& center, float radius) const;
+    
+private:
+    struct Plane {
+        Vector3 normal;     // Points into the frustum
+        float distance;
+    };
+    
+    Plane planes[6];        // Left, right, bottom, top, near, far
+};
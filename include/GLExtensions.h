@@ -0,0 +1,94 @@
+#pragma once
+
+#include "GLHeaders.h"
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+// GL 3.1 enums, missing from legacy-only headers
+#ifndef GL_UNIFORM_BUFFER
+#define GL_UNIFORM_BUFFER 0x8A11
+#endif
+#ifndef GL_INVALID_INDEX
+#define GL_INVALID_INDEX 0xFFFFFFFFu
+#endif
+#ifndef GL_COPY_READ_BUFFER
+#define GL_COPY_READ_BUFFER 0x8F36
+#define GL_COPY_WRITE_BUFFER 0x8F37
+#endif
+
+// GL 4.4 enums
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+// Optional OpenGL entry points, resolved at runtime so the game still runs on
+// plain GL 2.1 contexts. Check the matching capability flag before calling.
+namespace GLExt {
+    // GL 3.2 / ARB_draw_elements_base_vertex
+    typedef void (APIENTRY* MultiDrawElementsBaseVertexProc)(GLenum mode, const GLsizei* count, GLenum type,
+                                                             const void* const* indices, GLsizei drawCount,
+                                                             const GLint* baseVertex);
+    
+    extern bool hasBaseVertex;
+    extern MultiDrawElementsBaseVertexProc MultiDrawElementsBaseVertex;
+    
+    // GL 3.1 / ARB_uniform_buffer_object
+    typedef GLuint (APIENTRY* GetUniformBlockIndexProc)(GLuint program, const GLchar* name);
+    typedef void (APIENTRY* UniformBlockBindingProc)(GLuint program, GLuint blockIndex, GLuint binding);
+    typedef void (APIENTRY* BindBufferBaseProc)(GLenum target, GLuint index, GLuint buffer);
+    
+    extern bool hasUniformBuffer;
+    extern GetUniformBlockIndexProc GetUniformBlockIndex;
+    extern UniformBlockBindingProc UniformBlockBinding;
+    extern BindBufferBaseProc BindBufferBase;
+    
+    // GL 3.3 instanced drawing
+    typedef void (APIENTRY* DrawArraysInstancedProc)(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount);
+    typedef void (APIENTRY* DrawElementsInstancedProc)(GLenum mode, GLsizei count, GLenum type, const void* indices,
+                                                       GLsizei instanceCount);
+    typedef void (APIENTRY* VertexAttribDivisorProc)(GLuint index, GLuint divisor);
+    
+    extern bool hasInstancing;
+    extern DrawArraysInstancedProc DrawArraysInstanced;
+    extern DrawElementsInstancedProc DrawElementsInstanced;
+    extern VertexAttribDivisorProc VertexAttribDivisor;
+    
+    // GL 4.4 / ARB_buffer_storage with GL 3.2 / ARB_sync fences, for
+    // persistently mapped buffers
+    typedef void (APIENTRY* BufferStorageProc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+    typedef void* (APIENTRY* MapBufferRangeProc)(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+    typedef GLsync (APIENTRY* FenceSyncProc)(GLenum condition, GLbitfield flags);
+    typedef GLenum (APIENTRY* ClientWaitSyncProc)(GLsync sync, GLbitfield flags, GLuint64 timeout);
+    typedef void (APIENTRY* DeleteSyncProc)(GLsync sync);
+    
+    extern bool hasBufferStorage;
+    extern BufferStorageProc BufferStorage;
+    extern MapBufferRangeProc MapBufferRange;
+    extern FenceSyncProc FenceSync;
+    extern ClientWaitSyncProc ClientWaitSync;
+    extern DeleteSyncProc DeleteSync;
+    
+    // GL 3.1 / ARB_copy_buffer
+    typedef void (APIENTRY* CopyBufferSubDataProc)(GLenum readTarget, GLenum writeTarget, GLintptr readOffset,
+                                                   GLintptr writeOffset, GLsizeiptr size);
+    
+    extern bool hasCopyBuffer;
+    extern CopyBufferSubDataProc CopyBufferSubData;
+    
+    // GL 3.0 / ARB_framebuffer_object, called directly through glext.h prototypes
+    extern bool hasFramebuffer;
+    
+    // GLSL shaders (GL 2.0); GLSL 3.30 needs a 3.3 context
+    extern bool hasShaders;
+    extern bool hasGLSL330;
+    
+    // Context version, e.g. 21 for GL 2.1 or 45 for GL 4.5
+    extern int glVersion;
+    
+    // Resolve entry points for the current context
+    void load();
+    bool hasExtension(const char* name);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+// OpenGL headers for all platforms. Buffer objects and later entry points
+// are declared by glext.h; on Linux the prototypes must be requested explicitly.
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#include <OpenGL/glu.h>
+#include <OpenGL/glext.h>
+#else
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#include <GL/gl.h>
+#include <GL/glu.h>
+#include <GL/glext.h>
+#endif
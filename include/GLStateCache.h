@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+
+// Shadow copy of the OpenGL state the renderer touches most. Calls only reach
+// the driver when the value actually changes. Drawing code sets the state it
+// needs up front instead of restoring whatever it changed afterwards.
+//
+// Values are unknown until first set; call reset() if GL state was changed
+// behind the cache's back.
+class GLStateCache {
+public:
+    GLStateCache();
+    
+    void reset();
+    
+    // glEnable / glDisable
+    void enable(unsigned int cap) { setEnabled(cap, true); }
+    void disable(unsigned int cap) { setEnabled(cap, false); }
+    void setEnabled(unsigned int cap, bool enabled);
+    
+    // glEnableClientState / glDisableClientState
+    void enableClientState(unsigned int array) { setClientState(array, true); }
+    void disableClientState(unsigned int array) { setClientState(array, false); }
+    void setClientState(unsigned int array, bool enabled);
+    
+    void bindBuffer(unsigned int target, unsigned int buffer);
+    void deleteBuffer(unsigned int buffer);     // Also forgets any binding of it
+    void useProgram(unsigned int program);
+    void blendFunc(unsigned int source, unsigned int destination);
+    void blendFuncSeparate(unsigned int sourceRGB, unsigned int destinationRGB,
+                           unsigned int sourceAlpha, unsigned int destinationAlpha);
+    void matrixMode(unsigned int mode);
+    void depthMask(bool write);
+    
+    // Counters since the last resetCounters()
+    int getIssued() const { return issued; }
+    int getFiltered() const { return filtered; }
+    void resetCounters();
+    
+private:
+    struct Flag {
+        unsigned int name;
+        int value;              // -1 unknown, 0 off, 1 on
+    };
+    
+    struct Binding {
+        unsigned int target;
+        unsigned int buffer;
+        bool known;
+    };
+    
+    Flag& findFlag(std::vector<Flag>& flags, unsigned int name);
+    bool changed(bool isDifferent);
+    
+    std::vector<Flag> caps;
+    std::vector<Flag> clientStates;
+    std::vector<Binding> buffers;
+    
+    unsigned int program = 0;
+    bool programKnown = false;
+    unsigned int blendSource = 0;
+    unsigned int blendDestination = 0;
+    unsigned int blendSourceAlpha = 0;
+    unsigned int blendDestinationAlpha = 0;
+    bool blendKnown = false;
+    unsigned int currentMatrixMode = 0;
+    bool matrixModeKnown = false;
+    bool depthWrite = true;
+    bool depthWriteKnown = false;
+    
+    int issued = 0;
+    int filtered = 0;
+};
@@ -3,6 +3,8 @@
 #include "Types.h"
 #include <SDL2/SDL.h>
 #include <memory>
+#include <string>
+#include <vector>
 
 // Forward declarations
 class Renderer;
@@ -16,13 +18,37 @@ class Sky;
 class LoadingScreen;
 class Camera;
 class Physics;
+class Traffic;
+class ParticleSystem;
+struct RenderView;
+
+// Command line options
+struct GameOptions {
+    // Render offscreen into a framebuffer object with no visible window,
+    // fly a fixed number of frames at a fixed timestep and report timings
+    bool headless = false;
+    int frames = 300;
+    int width = 1920;
+    int height = 1080;
+    std::string outputPath;     // Last frame as a PPM image, if set
+    int renderThreads = 0;      // Render list build threads, 0 for one per core
+    bool towerView = false;     // Start with the tower picture-in-picture view open
+    bool splitScreen = false;   // Start in two-player split screen
+    int traffic = 0;            // AI aircraft circling the airport
+    float daySpeed = 0.0f;      // Hours of sky time per second, 0 to keep it noon
+    bool airborne = false;      // Headless: start climbing at 500 m instead of parked on the runway
+    
+    // Record every frame from startup; see Renderer::startCapture
+    std::string capturePath;
+    int captureFps = 60;
+};
 
 class Game {
 public:
     Game();
     ~Game();
     
-    bool initialize();
+    bool initialize(const GameOptions& options = GameOptions());
     void run();
     void shutdown();
     
@@ -50,6 +76,13 @@ private:
     void update(float deltaTime);
     void render();
     void loadResources();
+    void runHeadless();
+    void writeFrame(const std::string& path);
+    void toggleCapture();
+    void setSplitScreen(bool enabled);
+    void updateWingman(float deltaTime);
+    RenderView makeCameraView(const Camera& viewCamera, const Aircraft* hudAircraft) const;
+    RenderView makeTowerView(const RenderView& mainView) const;
     
     // Core systems
     SDL_Window* window = nullptr;
@@ -64,18 +97,30 @@ private:
     std::unique_ptr<LoadingScreen> loadingScreen;
     std::unique_ptr<Camera> camera;
     std::unique_ptr<Physics> physics;
+    std::unique_ptr<Traffic> traffic;
+    std::unique_ptr<ParticleSystem> particles;
+    std::vector<const Aircraft*> trailSources;     // Every aircraft flying this frame
     
     // Current aircraft
     std::unique_ptr<Aircraft> currentAircraft;
+    
+    // Second player in split screen, flown with the second controller
+    std::unique_ptr<Aircraft> wingmanAircraft;
+    std::unique_ptr<Camera> wingmanCamera;
     AircraftType selectedAircraftType = AircraftType::BOEING_737;
     
+    GameOptions options;
+    
     // Game state
     GameState currentState = GameState::LOADING;
     bool isRunning = false;
+    bool showRenderStats = false;
+    bool showTowerView = false;
     
     // Timing
     Uint64 lastFrameTime = 0;
     float deltaTime = 0.0f;
+    double particleSeconds = 0.0;   // Spent emitting and moving particles in the last update
     
     // Window properties
     int windowWidth = 1920;
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Types.h"
+#include "UIBatch.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Line-font text renderer. Glyph outlines are built once at startup and whole
+// strings are laid out into vertex runs that are reused across frames, so
+// unchanged text is copied straight into the UI batch.
+class GlyphCache {
+public:
+    GlyphCache();
+    
+    // Append text with its top-left corner at (x, y)
+    void drawText(UIBatch& batch, const std::string& text, float x, float y, float scale, const Color& color);
+    
+    // Drop layouts that have not been drawn for a while
+    void endFrame();
+    
+    size_t getCachedLayouts() const { return layouts.size(); }
+    int getHits() const { return hits; }
+    int getMisses() const { return misses; }
+    
+private:
+    struct Point {
+        float x, y;
+    };
+    
+    // Vertices for one string at one scale, relative to its origin
+    struct Layout {
+        std::string text;
+        float scale = 1.0f;
+        std::vector<Point> points;              // GL_LINES pairs
+        std::vector<uint32_t> charOffsets;      // First point of each character
+        
+        // Vertices at the last placement; the first bakedPoints are current
+        std::vector<UIBatch::Vertex> vertices;
+        size_t bakedPoints = 0;
+        float bakedX = 0.0f;
+        float bakedY = 0.0f;
+        Color bakedColor;
+        
+        uint64_t lastUsedFrame = 0;
+    };
+    
+    struct LayoutKey {
+        std::string text;
+        float scale;
+        
+        bool operator==(const LayoutKey& other) const {
+            return scale == other.scale && text == other.text;
+        }
+    };
+    
+    struct LayoutKeyHash {
+        size_t operator()(const LayoutKey& key) const;
+    };
+    
+    // Screen position text was last drawn at. New text at the same spot
+    // reuses that layout and re-lays out from the first changed character.
+    struct SlotKey {
+        int32_t x, y;
+        
+        bool operator==(const SlotKey& other) const {
+            return x == other.x && y == other.y;
+        }
+    };
+    
+    struct SlotKeyHash {
+        size_t operator()(const SlotKey& key) const {
+            return std::hash<int64_t>()(((int64_t)key.x << 32) ^ (uint32_t)key.y);
+        }
+    };
+    
+    void buildGlyphs();
+    Layout& findLayout(const std::string& text, float x, float y, float scale);
+    void layoutText(Layout& layout, const std::string& text) const;
+    void bake(Layout& layout, float x, float y, const Color& color) const;
+    
+    static const int kGlyphCount = 128;
+    static const uint64_t kEvictAfterFrames = 120;
+    
+    std::vector<Point> glyphs[kGlyphCount];     // Outlines at scale 1, origin top-left
+    
+    std::unordered_map<LayoutKey, Layout, LayoutKeyHash> layouts;
+    std::unordered_map<SlotKey, Layout*, SlotKeyHash> slots;
+    
+    uint64_t frame = 0;
+    int hits = 0;
+    int misses = 0;
+};
@@ -25,6 +25,14 @@ public:
     std::string getControllerName() const;
     int getControllerCount() const { return static_cast<int>(connectedControllers.size()); }
     
+    // Local multiplayer: player 0 has the keyboard and the active controller,
+    // player N the Nth connected controller after it. Values are read from
+    // that controller alone, so players never steer each other's aircraft.
+    bool hasPlayerController(int player) const { return getPlayerController(player) != nullptr; }
+    float getPlayerAxis(int player, InputAction action) const;
+    bool isPlayerButtonDown(int player, InputAction action) const;
+    bool wasPlayerButtonPressedThisFrame(int player, InputAction action) const;
+    
     // Input queries
     bool isActionPressed(InputAction action) const;
     bool isActionJustPressed(InputAction action) const;
@@ -70,6 +78,8 @@ public:
 private:
     void setupDefaultMappings();
     float applyDeadzone(float value) const;
+    SDL_GameController* getPlayerController(int player) const;
+    bool isActiveController(SDL_JoystickID id) const;
     
     // Controllers
     SDL_GameController* activeController = nullptr;
@@ -87,6 +97,7 @@ private:
     const Uint8* keyboardState = nullptr;
     std::map<SDL_Scancode, bool> previousKeyStates;
     std::set<SDL_Scancode> keysPressedThisFrame;  // Tracks keys pressed THIS frame
+    std::set<std::pair<SDL_JoystickID, int>> buttonsPressedThisFrame;   // Controller, button
     
     // Mouse state
     int mouseX = 0;
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Types.h"
+#include "GLStateCache.h"
+#include <cstdint>
+#include <vector>
+
+// Static triangle mesh stored in a vertex buffer. Geometry is specified with
+// the same begin/normal/color/vertex calls as immediate mode, then uploaded
+// once and drawn with a single glDrawArrays. Loaded models are uploaded
+// ready-made instead: quantized, indexed vertices drawn with glDrawElements.
+class Mesh {
+public:
+    enum class Primitive {
+        TRIANGLES,
+        QUADS
+    };
+    
+    struct Vertex {
+        float position[3];
+        float normal[3];
+        uint8_t color[4];
+    };
+    
+    // Position = offset + position * scale; normals are signed bytes. The
+    // fourth components only pad to 16 bytes.
+    struct QuantizedVertex {
+        int16_t position[4];
+        int8_t normal[4];
+        uint8_t color[4];
+    };
+    
+    Mesh();
+    ~Mesh();
+    
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    
+    // Building (CPU side)
+    void begin(Primitive primitive);
+    void end();
+    void normal(float x, float y, float z);
+    void color(const Color& c);
+    void vertex(float x, float y, float z);
+    
+    // Copy the built vertices to the GPU and free the CPU copy
+    bool upload(GLStateCache& state);
+    
+    // Replaces the mesh with indexed triangles, uploaded straight from the
+    // given memory. indexSize is 2 or 4 bytes.
+    bool uploadQuantized(GLStateCache& state, const QuantizedVertex* vertices, int vertexCount,
+                         const void* indices, int indexCount, int indexSize, const Vector3& offset, float scale);
+    void release();
+    
+    void draw(GLStateCache& state) const;
+    
+    bool isUploaded() const { return vertexBuffer != 0; }
+    int getVertexCount() const { return vertexCount; }
+    unsigned int getBuffer() const { return vertexBuffer; }
+    
+private:
+    std::vector<Vertex> vertices;
+    
+    // Immediate-mode style current state
+    Primitive primitive = Primitive::TRIANGLES;
+    Vertex current;
+    Vertex pending[4];
+    int pendingCount = 0;
+    
+    GLStateCache* state = nullptr;      // Cache the buffer was created through
+    unsigned int vertexBuffer = 0;
+    int vertexCount = 0;
+    
+    // Quantized meshes only
+    unsigned int indexBuffer = 0;
+    int indexCount = 0;
+    unsigned int indexType = 0;
+    Vector3 offset;
+    float scale = 1.0f;
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Types.h"
+#include "Mesh.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Triangle model loaded from a Wavefront OBJ file, ready for
+// Mesh::uploadQuantized. Conversion welds duplicate vertices, quantizes them
+// to 16 bytes and orders the triangles for the post-transform vertex cache;
+// the result is written next to the source as <file>.mesh and memory-mapped
+// on later loads, so only the first run after the model or one of its
+// material libraries changes pays for parsing.
+//
+// OBJ support covers what exported aircraft use: v (with optional r g b
+// vertex colors), vn, f with any polygon size and negative indices, and the
+// Kd colors of usemtl materials from mtllib files. Faces without normals get
+// flat ones; texture coordinates are ignored.
+class ModelFile {
+public:
+    ModelFile();
+    ~ModelFile();
+    
+    ModelFile(const ModelFile&) = delete;
+    ModelFile& operator=(const ModelFile&) = delete;
+    
+    // Vertices without a vertex or material color get defaultColor
+    bool load(const std::string& path, const Color& defaultColor);
+    void release();
+    
+    bool isLoaded() const { return header != nullptr; }
+    bool wasCached() const { return mapping != nullptr; }   // Mapped rather than converted
+    
+    const Mesh::QuantizedVertex* getVertices() const;
+    int getVertexCount() const;
+    const void* getIndices() const;
+    int getIndexCount() const;
+    int getIndexSize() const;               // 2 or 4 bytes
+    
+    // Dequantization: position = offset + vertex position * scale
+    Vector3 getOffset() const;
+    float getScale() const;
+    Vector3 getBoundsMin() const;
+    Vector3 getBoundsMax() const;
+    
+private:
+    // Layout of the cache file: this header, the vertices, the indices, then
+    // the stamps of the material libraries the model used. The geometry
+    // stays 16-byte aligned, so the mapping is used in place.
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceSize;                // Source file identity the cache was built from
+        int64_t sourceTime;
+        uint32_t defaultColor;              // RGBA8
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t indexSize;
+        float offset[3];
+        float scale;
+        float boundsMin[3];
+        float boundsMax[3];
+        uint32_t libraryBytes;              // Size of the library stamps
+        uint32_t padding[3];
+    };
+    static_assert(sizeof(Header) % 16 == 0, "Vertices after the header must stay aligned");
+    
+    bool mapCache(const std::string& cachePath, const Header& expected);
+    bool convert(const std::string& path, const Header& identity);
+    void writeCache(const std::string& cachePath) const;
+    
+    const uint8_t* data = nullptr;          // Header followed by the geometry
+    const Header* header = nullptr;
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+    std::vector<uint8_t> owned;             // Freshly converted data when not mapped
+};
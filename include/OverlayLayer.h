@@ -0,0 +1,70 @@
+#pragma once
+
+#include "UIBatch.h"
+#include <vector>
+
+class GLStateCache;
+
+// 2D drawing that changes far less often than the frame rate, cached in a
+// texture. A redraw lays the drawing out in texture pixels through getBatch()
+// and maps rectangles of the texture onto the screen; every frame after that
+// only composites the texture back, one textured quad per rectangle, until
+// the next redraw.
+//
+// The texture holds premultiplied alpha, so blended shapes composite to the
+// same result as drawing them straight onto the screen. It is multisampled
+// like the framebuffer it is composited onto.
+class OverlayLayer {
+public:
+    // Texture rectangle from the top left, and where its top left lands on screen
+    struct Region {
+        int x, y;
+        int width, height;
+        int screenX, screenY;
+    };
+    
+    OverlayLayer();
+    ~OverlayLayer();
+    
+    OverlayLayer(const OverlayLayer&) = delete;
+    OverlayLayer& operator=(const OverlayLayer&) = delete;
+    
+    // Needs framebuffer objects; without them, draw straight to the screen
+    static bool isSupported();
+    
+    void release();
+    
+    // Starts a redraw into a texture of the given size, dropping the previous
+    // drawing and regions. No GL calls, so safe on a worker thread.
+    void begin(int width, int height);
+    void addRegion(const Region& region);
+    UIBatch& getBatch() { return batch; }
+    
+    // On the GL thread: renders a pending redraw into the texture, then binds
+    // target again. Leaves the viewport on the texture and the clear color
+    // transparent. Returns false if the texture could not be created.
+    bool update(GLStateCache& state, unsigned int target, int samples);
+    bool isPending() const { return pending; }
+    
+    // Draws every region over the screen
+    void composite(GLStateCache& state, int screenWidth, int screenHeight);
+    
+private:
+    bool createTargets(int width, int height, int samples);
+    
+    unsigned int texture = 0;
+    unsigned int framebuffer = 0;           // Renders into texture
+    unsigned int multisampleBuffer = 0;     // Renders here and resolves into texture when samples > 1
+    unsigned int multisampleFramebuffer = 0;
+    int textureWidth = 0;
+    int textureHeight = 0;
+    int textureSamples = 0;
+    
+    // Layout of the latest redraw
+    int width = 0;
+    int height = 0;
+    std::vector<Region> regions;
+    UIBatch batch;
+    bool pending = false;
+    bool drawn = false;                     // Texture holds a complete redraw
+};
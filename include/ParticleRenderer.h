@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Types.h"
+#include "ShaderProgram.h"
+#include "ParticleSystem.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class GLStateCache;
+class StreamBuffer;
+
+// Draws the pools of a ParticleSystem as camera-facing billboards, one call
+// per pool: instanced straight from copies of the pool's position and age
+// arrays when GL 3.3 is available, otherwise expanded into quads on the CPU.
+// Particles are not sorted; they blend over the scene without depth writes,
+// sparks additively.
+class ParticleRenderer {
+public:
+    using Type = ParticleSystem::Type;
+    
+    ParticleRenderer();
+    ~ParticleRenderer();
+    
+    ParticleRenderer(const ParticleRenderer&) = delete;
+    ParticleRenderer& operator=(const ParticleRenderer&) = delete;
+    
+    void initialize(GLStateCache& state);
+    void release();
+    
+    // When set, prepare() copies the particles into the stream buffer instead
+    // of a buffer uploaded at draw time
+    void setStreamBuffer(StreamBuffer* buffer) { stream = buffer; }
+    
+    // Takes this frame's particles, for every view. Makes no GL calls, so it
+    // can run on a worker thread; the system must not change until drawn.
+    void prepare(const ParticleSystem* particles);
+    
+    // Box around everything drawn for a pool, billboards included
+    static AABB getBounds(const ParticleSystem::Pool& pool, Type type);
+    
+    // Draws one pool, lit by light. Expects the view matrix to be loaded as
+    // the modelview matrix.
+    void draw(Type type, const Matrix4& viewMatrix, const Color& light, GLStateCache& state);
+    
+private:
+    // Where prepare() left a pool's particles
+    struct PoolBatch {
+        const ParticleSystem::Pool* pool = nullptr;
+        int count = 0;
+        bool streamed = false;
+        size_t streamOffset = 0;        // x, y, z and age arrays, count floats each
+    };
+    
+    // Expanded quad corner for the fallback path
+    struct QuadVertex {
+        float position[3];
+        float texCoord[2];
+        uint8_t color[4];
+    };
+    
+    void createTexture();
+    void drawInstanced(const PoolBatch& batch, Type type, const Color& light, GLStateCache& state);
+    void buildQuads(const PoolBatch& batch, Type type, const Matrix4& viewMatrix, const Color& light);
+    void drawQuads(GLStateCache& state);
+    
+    GLStateCache* state = nullptr;
+    StreamBuffer* stream = nullptr;
+    ShaderProgram program;
+    int colorLocations[2] = { -1, -1 };     // Start and end colors
+    int sizeLocation = -1;
+    unsigned int cornerBuffer = 0;          // The four billboard corners
+    unsigned int particleBuffer = 0;
+    unsigned int texture = 0;               // Soft round particle mask
+    
+    PoolBatch pools[ParticleSystem::kTypeCount];
+    std::vector<QuadVertex> quads;
+};
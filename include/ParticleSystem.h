@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Types.h"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+class Aircraft;
+
+// Contrails, engine exhaust, runway dust and sparks. Each type lives in its
+// own fixed-size pool stored as one array per component, with the live
+// particles packed at the front: an update is one straight pass over the
+// arrays that moves four particles per SSE instruction, and an expired
+// particle is overwritten by the last live one. Nothing here touches GL; the
+// renderer copies the position and age arrays to the GPU as they are.
+class ParticleSystem {
+public:
+    enum class Type : uint8_t {
+        CONTRAIL,
+        EXHAUST,
+        DUST,
+        SPARK
+    };
+    static constexpr int kTypeCount = 4;
+    
+    // Engines leave contrails instead of exhaust smoke above this altitude
+    static constexpr float kContrailAltitude = 7500.0f;
+    
+    // Live particles of one type. Every array holds capacity floats, 16-byte
+    // aligned. age runs from 0 at emission to 1 at expiry, at ageRate
+    // (1 / lifetime) per second.
+    struct Pool {
+        float* x = nullptr;
+        float* y = nullptr;
+        float* z = nullptr;
+        float* vx = nullptr;
+        float* vy = nullptr;
+        float* vz = nullptr;
+        float* age = nullptr;
+        float* ageRate = nullptr;
+        int count = 0;
+        int capacity = 0;
+        
+        // Around the live particles as of the last update
+        Vector3 boundsMin;
+        Vector3 boundsMax;
+        
+        std::vector<float> storage;
+        std::vector<int> expired;       // Scratch for update
+    };
+    
+    ParticleSystem();
+    ~ParticleSystem();
+    
+    ParticleSystem(const ParticleSystem&) = delete;
+    ParticleSystem& operator=(const ParticleSystem&) = delete;
+    
+    // Dropped when the pool is full
+    void emit(Type type, const Vector3& position, const Vector3& velocity);
+    
+    // rate particles per second from an emitter that moved at emitterVelocity
+    // over the last deltaTime, spread along the path it covered so trails
+    // stay continuous at any frame rate and speed
+    void emitAlong(Type type, const Vector3& position, const Vector3& emitterVelocity, const Vector3& velocity,
+                   float rate, float deltaTime);
+    
+    // Exhaust from the engines of an aircraft, thicker with throttle, or
+    // contrails above kContrailAltitude
+    void emitTrails(const Aircraft& aircraft, float deltaTime);
+    
+    void update(float deltaTime);
+    void clear();
+    
+    const Pool& getPool(Type type) const { return pools[(int)type]; }
+    int getLiveCount() const;
+    
+private:
+    void integrate(Pool& pool, float lift, float damping, float deltaTime);
+    void removeExpired(Pool& pool);
+    
+    Pool pools[kTypeCount];
+    std::mt19937 random;
+};
@@ -4,6 +4,7 @@
 
 class Aircraft;
 class Terrain;
+class ParticleSystem;
 
 class Physics {
 public:
@@ -12,10 +13,21 @@ public:
     
     void update(float deltaTime, Aircraft* aircraft, const Terrain* terrain);
     
+    // Receives dust and sparks from ground contact; none are made without it
+    void setParticleSystem(ParticleSystem* system) { particles = system; }
+    
     // Physics constants
     static constexpr float GRAVITY = 9.81f;
     static constexpr float AIR_DENSITY = 1.225f;  // kg/m³ at sea level
     
+    // Ground contact effects
+    static constexpr float MIN_EFFECT_SPEED = 5.0f;         // m/s rolling before dust or sparks
+    static constexpr float HARD_LANDING_SINK_RATE = 6.0f;   // m/s
+    static constexpr int SPARK_BURST = 60;
+    static constexpr float SPARK_RATE = 300.0f;             // Per second sliding on the belly
+    static constexpr int DUST_BURST = 80;
+    static constexpr float DUST_RATE = 120.0f;              // Per second at full rollout speed
+    
     // Calculate forces
     Vector3 calculateLift(const Aircraft* aircraft) const;
     Vector3 calculateDrag(const Aircraft* aircraft) const;
@@ -29,6 +41,8 @@ public:
     
 private:
     void applyForces(Aircraft* aircraft, float deltaTime);
-    void handleGroundContact(Aircraft* aircraft, const Terrain* terrain);
+    void handleGroundContact(Aircraft* aircraft, const Terrain* terrain, float deltaTime);
     void handleCollision(Aircraft* aircraft, const Terrain* terrain);
+    
+    ParticleSystem* particles = nullptr;
 };
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Types.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class GLStateCache;
+class StreamBuffer;
+
+// Unit spheres, cylinders and cubes, tessellated once at a few detail levels
+// and kept together in one vertex and index buffer. Every draw takes an array
+// of instances, each a transform from the unit shape plus a color:
+//   sphere    radius 1 around the origin
+//   cylinder  radius 1, from y = 0 up to y = 1
+//   cube      edge 1 around the origin
+// Transforms should only scale along the shape's axes; normals are carried
+// through the upper 3x3 of the transform and renormalized.
+class PrimitiveMeshes {
+public:
+    enum class Shape {
+        SPHERE,
+        CYLINDER,
+        CUBE
+    };
+    
+    enum class Detail {
+        LOW,
+        MEDIUM,
+        HIGH
+    };
+    
+    static constexpr int kShapeCount = 3;
+    static constexpr int kDetailCount = 3;
+    
+    // Vertex attribute locations an instancing shader has to declare
+    static constexpr unsigned int kPositionAttribute = 0;
+    static constexpr unsigned int kNormalAttribute = 1;
+    static constexpr unsigned int kTransformAttribute = 2;     // mat4, locations 2 to 5
+    static constexpr unsigned int kColorAttribute = 6;
+    
+    struct Instance {
+        Matrix4 transform;
+        Color color;
+    };
+    
+    PrimitiveMeshes();
+    ~PrimitiveMeshes();
+    
+    PrimitiveMeshes(const PrimitiveMeshes&) = delete;
+    PrimitiveMeshes& operator=(const PrimitiveMeshes&) = delete;
+    
+    bool initialize(GLStateCache& state);
+    void release();
+    bool isReady() const { return vertexBuffer != 0; }
+    
+    // When set, instance data is written into the stream buffer rather than
+    // uploaded into a buffer of its own on every draw
+    void setStreamBuffer(StreamBuffer* buffer) { stream = buffer; }
+    
+    // One instanced draw through the bound program, which must read the
+    // attributes above. Needs GLExt::hasInstancing.
+    void drawInstanced(Shape shape, Detail detail, const Instance* instances, size_t count);
+    
+    // One draw per instance through the modelview matrix and the current color,
+    // for fixed-function and GLSL 1.20 programs
+    void drawEach(Shape shape, Detail detail, const Instance* instances, size_t count);
+    
+    // Radius of a sphere around the origin enclosing the unit shape
+    static float getBoundingRadius(Shape shape);
+    
+    int getTriangleCount(Shape shape, Detail detail) const;
+    
+private:
+    struct Vertex {
+        float position[3];
+        float normal[3];
+    };
+    
+    struct GPUInstance {
+        float transform[16];
+        uint8_t color[4];
+    };
+    
+    struct Range {
+        int firstIndex = 0;
+        int indexCount = 0;
+    };
+    
+    void addSphere(Range& range, int slices, int stacks);
+    void addCylinder(Range& range, int slices);
+    void addCube(Range& range);
+    void addVertex(float px, float py, float pz, float nx, float ny, float nz);
+    void bindGeometry();
+    
+    GLStateCache* state = nullptr;
+    StreamBuffer* stream = nullptr;
+    unsigned int vertexBuffer = 0;
+    unsigned int indexBuffer = 0;
+    unsigned int instanceBuffer = 0;
+    
+    Range ranges[kShapeCount][kDetailCount];
+    
+    // Geometry while building, freed once uploaded
+    std::vector<Vertex> vertices;
+    std::vector<uint16_t> indices;
+    
+    std::vector<GPUInstance> uploads;   // Per-draw scratch without a stream buffer
+};
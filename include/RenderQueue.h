@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Draw commands of one view in submission order. Everything drawn into the
+// 3D scene adds a command with a 64-bit sort key while the render lists are
+// built; one radix sort per frame then puts passes in order, opaque and
+// terrain commands front to back (for early depth rejection) and transparent
+// ones back to front (for correct blending).
+//
+// Key layout, most significant bits first:
+//   pass       4 bits
+//   depth     16 bits   logarithmic distance bucket, reversed for transparent
+//   material  12 bits   state setup the command needs
+//   mesh      32 bits   geometry it draws from
+class RenderQueue {
+public:
+    enum class Pass : uint8_t {
+        BACKGROUND,         // Drawn first, without depth testing
+        OPAQUE,
+        TERRAIN,            // Opaque too, apart so nothing splits the chunks' multi-draw
+        TRANSPARENT
+    };
+    
+    // What the command is and where its data lives are up to the submitter
+    struct Item {
+        uint64_t key;
+        uint16_t type;
+        uint16_t list;
+        uint32_t index;
+    };
+    
+    static uint64_t makeKey(Pass pass, float depth, uint32_t material, uint32_t mesh);
+    static Pass getPass(uint64_t key) { return (Pass)(key >> 60); }
+    
+    void clear() { items.clear(); }
+    void push(uint64_t key, uint16_t type, uint16_t list, uint32_t index) { items.push_back({key, type, list, index}); }
+    void append(const RenderQueue& other);
+    
+    // Stable least-significant-digit radix sort on the keys, a byte at a time;
+    // bytes every key shares are skipped
+    void sort();
+    
+    const std::vector<Item>& getItems() const { return items; }
+    size_t size() const { return items.size(); }
+    bool empty() const { return items.empty(); }
+    
+private:
+    std::vector<Item> items;
+    std::vector<Item> scratch;      // Other half of each sort pass
+};
@@ -1,18 +1,103 @@
 #pragma once
 
 #include "Types.h"
+#include "Terrain.h"
+#include "Frustum.h"
+#include "UIBatch.h"
+#include "GlyphCache.h"
+#include "Mesh.h"
+#include "PrimitiveMeshes.h"
+#include "GLStateCache.h"
+#include "ShaderProgram.h"
+#include "CloudRenderer.h"
+#include "ParticleRenderer.h"
+#include "FrameCapture.h"
+#include "ThreadPool.h"
+#include "StreamBuffer.h"
+#include "OverlayLayer.h"
+#include "RenderQueue.h"
 #include <SDL2/SDL.h>
 #include <string>
 #include <vector>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
 
-class Camera;
 class Aircraft;
-class Terrain;
 class Sky;
 
+// Per-frame rendering counters
+struct RenderStats {
+    int terrainChunksVisible = 0;
+    int terrainChunksCulled = 0;
+    int objectsVisible = 0;
+    int objectsCulled = 0;
+    int cloudPuffsVisible = 0;
+    int cloudPuffsCulled = 0;
+    
+    // Aircraft drawn at each level of detail, counted once per view
+    int aircraftFull = 0;
+    int aircraftReduced = 0;
+    int aircraftImpostors = 0;
+    
+    // Particles in the pools each view drew, counted once per view
+    int particlesDrawn = 0;
+    
+    // Resident terrain chunks repacked with lighting for a new sun
+    int terrainChunksRelit = 0;
+    
+    // Render list build phase, wall clock
+    float buildMilliseconds = 0.0f;
+    int buildThreads = 0;
+    
+    // HUD and minimap: building them, redrawing their cached textures and
+    // compositing those, wall clock
+    float overlayMilliseconds = 0.0f;
+    int overlayRedraws = 0;
+    float overlayRedrawMilliseconds = 0.0f;     // Part of the above spent redrawing
+    
+    // GL state changes over the previous frame
+    int stateChangesIssued = 0;
+    int stateChangesFiltered = 0;
+};
+
+// One camera looking at the scene through a rectangle of the screen
+struct RenderView {
+    Vector3 eye;
+    Vector3 target;
+    Vector3 up = Vector3(0, 1, 0);
+    float fov = 60.0f;
+    float nearPlane = 0.1f;
+    float farPlane = 10000.0f;
+    
+    // Screen rectangle in pixels from the top left; 0 width or height
+    // covers the whole screen
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+    
+    // Aircraft whose HUD and minimap overlay this view, if any
+    const Aircraft* hudAircraft = nullptr;
+};
+
+// Everything the views of the world draw. Culling, transforms and 2D layout
+// are built once for all views on worker threads, then submitted to GL view
+// by view in the order of each view's sorted RenderQueue.
+struct RenderScene {
+    const Sky* sky = nullptr;
+    const Terrain* terrain = nullptr;
+    std::vector<const Aircraft*> aircraft;
+    const ParticleSystem* particles = nullptr;
+    std::vector<RenderView> views;      // The first is the main view; later ones draw over it
+    bool showHUD = true;
+    bool showMinimap = true;
+};
+
 class Renderer {
 public:
-    Renderer();
+    // threadCount: threads building render lists, 0 for one per core
+    explicit Renderer(int threadCount = 0);
     ~Renderer();
     
     bool initialize(SDL_Window* window, int width, int height);
@@ -21,27 +106,31 @@ public:
     void beginFrame();
     void endFrame();
     
-    // Rendering functions
-    void renderAircraft(const Aircraft* aircraft, const Camera* camera);
-    void renderTerrain(const Terrain* terrain, const Camera* camera);
-    void renderSky(const Sky* sky, const Camera* camera);
-    void renderHUD(const Aircraft* aircraft);
-    void renderMinimap(const Aircraft* aircraft, const Terrain* terrain);
+    // Sky, terrain, aircraft, clouds and particles for every view, then the HUD
+    // overlays. Leaves the first view's matrices current and the viewport
+    // covering the whole screen.
+    void renderScene(const RenderScene& scene);
     
-    // UI rendering
+    static constexpr int kMaxViews = 8;
+    
+    // UI rendering. 2D primitives are queued and drawn together at endFrame;
+    // call flush2D to draw everything queued so far before a new UI layer.
     void renderText(const std::string& text, float x, float y, float scale, const Color& color);
     void renderRect(float x, float y, float width, float height, const Color& color, bool filled = true);
     void renderCircle(float x, float y, float radius, const Color& color, bool filled = true);
     void renderProgressBar(float x, float y, float width, float height, float progress, 
                           const Color& bgColor, const Color& fillColor);
+    void flush2D();
     
-    // 3D primitives
+    // 3D primitives, lit and fogged like the rest of the scene. Each shape is
+    // built once; the detail level follows its size on screen.
     void renderCube(const Vector3& position, const Vector3& size, const Color& color);
     void renderCylinder(const Vector3& position, float radius, float height, const Color& color);
     void renderSphere(const Vector3& position, float radius, const Color& color);
-    void renderPlane3D(const Vector3& position, const Vector3& rotation, 
-                       float wingspan, float length, const Color& primaryColor, const Color& secondaryColor,
-                       float gearState = 1.0f, float flapsState = 0.0f);
+    
+    // Many copies of one shape, culled and drawn in at most one call per
+    // detail level. See PrimitiveMeshes for the unit shapes the transforms apply to.
+    void renderPrimitives(PrimitiveMeshes::Shape shape, const PrimitiveMeshes::Instance* instances, size_t count);
     
     // Utility
     void setViewport(int x, int y, int width, int height);
@@ -49,13 +138,265 @@ public:
     void setProjectionMatrix(float fov, float aspect, float nearPlane, float farPlane);
     void setViewMatrix(const Vector3& eye, const Vector3& target, const Vector3& up);
     
+    // Offscreen rendering: every later frame goes to a framebuffer object of
+    // this size instead of the window. readPixels returns RGB rows, bottom first.
+    bool createOffscreenTarget(int width, int height);
+    bool readPixels(std::vector<unsigned char>& rgb);
+    
+    // Records every frame at endFrame until stopped; the format follows the
+    // extension (.y4m, .png sequence, otherwise raw rgb24)
+    bool startCapture(const std::string& path, int fps);
+    void stopCapture();
+    bool isCapturing() const { return frameCapture.isActive(); }
+    
     int getWidth() const { return screenWidth; }
     int getHeight() const { return screenHeight; }
     
+    // Visibility against the frustum of the current projection and view matrices
+    const Frustum& getFrustum() const { return frustum; }
+    bool isVisible(const AABB& bounds) const { return frustum.intersects(bounds); }
+    bool isVisible(const Vector3& center, float radius) const { return frustum.intersectsSphere(center, radius); }
+    
+    // Statistics
+    const RenderStats& getStats() const { return stats; }
+    void renderStats(float x, float y);
+    
 private:
     void initOpenGL();
+    void initShaders();
     void setupMatrices();
-    void drawCharacter(char c, float x, float y, float scale);
+    
+    // Per-frame camera, sun and fog values, laid out to match the std140
+    // FrameData uniform block
+    struct FrameUniforms {
+        float projection[16];
+        float sunDirection[4];      // Eye space, towards the sun
+        float sunColor[4];
+        float ambientColor[4];
+        float fogColor[4];
+        float fogParams[4];         // start, end, 1 / (end - start), unused
+    };
+    
+    void applyAtmosphere(const Sky* sky);
+    void beginLitPass();            // State for lit, fogged 3D geometry
+    void beginBakedPass();          // Fogged 3D geometry with lighting in its vertex colors
+    void beginUnlitPass();          // Fixed-function state for sky and 2D
+    
+    // Terrain chunks live in fixed-size slots of one shared vertex buffer and
+    // all use the same index buffer, since every chunk has the same grid topology.
+    // Their vertex colors have the sun's lighting baked in when packed.
+    struct TerrainSlot {
+        std::weak_ptr<TerrainChunk> chunk;   // Chunk the slot was filled from
+        int slot = -1;
+        uint32_t lighting = 0;               // terrainLightingVersion it was packed with
+    };
+    
+    // Aircraft geometry, built once per type. Landing gear and flaps are
+    // separate meshes posed from the animation state when drawn.
+    struct GearLeg {
+        Mesh strut;
+        Mesh wheel;
+        Vector3 mount;          // Hinge point on the fuselage
+        float strutLength = 0.0f;
+    };
+    
+    struct AircraftMesh {
+        Mesh body;              // Fuselage, nose, wings and tail
+        GearLeg gear[3];        // Nose, left main, right main
+        Mesh flap;
+        Vector3 flapMounts[2];
+        float wingspan = 0.0f;
+        float length = 0.0f;
+        
+        // Coarser levels of detail: a few boxes in the body's colors, and the
+        // body pre-rendered from kImpostorYaws x kImpostorPitches directions
+        // into one texture (0 without framebuffer objects)
+        Mesh reduced;
+        unsigned int impostorTexture = 0;
+        float radius = 0.0f;    // Bounding sphere, and half the size of an impostor frame
+    };
+    
+    const AircraftMesh& getAircraftMesh(AircraftType type, const AircraftSpecs& specs);
+    void buildAircraftMesh(AircraftMesh& mesh, float wingspan, float length,
+                           const Color& primaryColor, const Color& secondaryColor);
+    void buildReducedAircraftMesh(AircraftMesh& mesh, const Color& primaryColor, const Color& secondaryColor);
+    void buildAircraftImpostor(AircraftMesh& mesh);
+    void releaseAircraftMeshes();
+    // Replaces the body with assets/aircraft/<model>.obj when it exists
+    void loadAircraftModel(AircraftMesh& mesh, AircraftType type, const AircraftSpecs& specs);
+    
+    // Aircraft levels of detail, chosen per view from the size on screen
+    enum class AircraftLod : uint8_t {
+        FULL,                   // Body, landing gear and flaps
+        REDUCED,
+        IMPOSTOR
+    };
+    
+    // Level each aircraft was drawn at in each view, kept from frame to frame
+    // so a level only changes once the size is clearly past its threshold
+    struct AircraftLodState {
+        AircraftLod levels[kMaxViews];
+        uint32_t known = 0;     // Bit per view with a level
+        uint64_t frame = 0;     // Last frame the aircraft was in the scene
+    };
+    
+    static AircraftLod selectAircraftLod(float pixels, const AircraftLodState& state, int view, bool hasImpostor);
+    
+    // One mesh draw with its complete model transform
+    struct MeshDraw {
+        const Mesh* mesh;
+        Matrix4 transform;
+        bool normalize;         // Scaled, so lighting needs renormalized normals
+        uint32_t views;         // Bit per view it is visible in
+    };
+    
+    using ChunkEntry = std::pair<const std::pair<int, int>, std::shared_ptr<TerrainChunk>>;
+    
+    // Camera-facing quad textured with one impostor frame
+    struct ImpostorDraw {
+        unsigned int texture;
+        float vertices[4][5];   // x, y, z, s, t; counterclockwise from the bottom left
+    };
+    
+    struct ChunkDraw {
+        const ChunkEntry* entry;
+        uint32_t views;         // Bit per view it is visible in
+        int slot;               // Terrain buffer slot, set once uploaded
+        int64_t staged;         // Stream buffer offset of its packed vertices, or -1
+        bool relight;           // Resident, but packed again for the current sun
+    };
+    
+    // RenderQueue command types and the materials in their sort keys
+    enum class DrawType : uint16_t {
+        SKY,
+        GROUND,                 // Runway, or a flat plane before any terrain exists
+        TERRAIN_CHUNK,          // Index into terrainChunks
+        MESH,                   // Index into meshes
+        IMPOSTOR,               // Index into impostors
+        CLOUDS,
+        PARTICLES               // Index is the ParticleSystem::Type
+    };
+    
+    enum class DrawMaterial : uint32_t {
+        SKY,
+        TERRAIN,
+        GROUND,
+        MESH,
+        MESH_NORMALIZED,
+        IMPOSTOR,
+        CLOUDS,
+        PARTICLES
+    };
+    
+    // Camera matrices, frustum and GL viewport of one RenderView
+    struct ViewState {
+        Matrix4 projection;
+        Matrix4 view;
+        Frustum frustum;
+        Vector3 eye;
+        int viewport[4];        // GL order, from the bottom left
+        float skyRadius;        // Of the sky dome, between the near and far planes
+    };
+    
+    // Sky dome around the eye, colored from the atmosphere tables
+    struct SkyVertex {
+        float position[3];
+        uint8_t color[4];
+    };
+    
+    // Draw packets built by one thread. Every job writes only into the list of
+    // the thread running it; submission walks the lists in thread order.
+    struct RenderList {
+        std::vector<ChunkDraw> terrainChunks;           // Visible in some view and generated
+        std::vector<MeshDraw> meshes;
+        std::vector<ImpostorDraw> impostors;
+        std::vector<RenderQueue> queues;                // Commands for each view
+        UIBatch ui;
+        uint16_t index = 0;                             // In renderLists
+        int terrainChunksCulled = 0;
+        int objectsVisible = 0;
+        int objectsCulled = 0;
+        int aircraftLods[3] = {};                       // Views drawing an aircraft at each level
+        int particlesDrawn = 0;
+        int terrainChunksRelit = 0;
+        
+        void clear();
+    };
+    
+    // Build phase, on the worker threads. Only reads the scene and the view
+    // states; nothing here may touch GL.
+    void setupViews(const RenderScene& scene);
+    void buildRenderLists(const RenderScene& scene);
+    void buildTerrainList(const Terrain& terrain, int part, int partCount, RenderList& list);
+    void buildAircraftList(const Aircraft& aircraft, const AircraftMesh& mesh, AircraftLodState& lod,
+                           RenderList& list) const;
+    void queueMesh(RenderList& list, const MeshDraw& draw) const;
+    void buildSkyDome(const Sky& sky, const ViewState& view, std::vector<SkyVertex>& dome) const;
+    
+    // HUD and minimap readouts, rounded the way they are shown, and the
+    // screen rectangle they are laid out in. A view's overlay is cached only
+    // while these hold still, and redrawn when they change.
+    struct OverlayValues {
+        AircraftType type;
+        int speed;              // Knots
+        int altitude;           // Feet
+        int heading;            // Degrees
+        int verticalSpeed;      // Feet per minute
+        int throttle;           // Percent
+        int flaps;
+        int runwayOffset;       // Minimap pixels north of the aircraft
+        bool gearDown;
+        bool onGround;
+        bool stalling;
+        bool showHUD;
+        bool showMinimap;
+        int x, y, width, height;
+        
+        // Values that move things around rather than change what is shown
+        bool sameLayout(const OverlayValues& other) const;
+        bool operator==(const OverlayValues& other) const;
+    };
+    
+    struct ViewOverlay {
+        OverlayLayer layer;
+        OverlayValues values;   // What the layer was last drawn with
+        bool valid = false;
+        bool visible = false;   // Composited this frame
+        OverlayValues latest;   // Readings of the previous frame
+        int steadyFrames = -1;  // Frames they have held for, -1 before the first
+    };
+    
+    // Overlays of one view: cached panels into its layer, the pitch ladder
+    // (which has to follow the horizon every frame) into live
+    void buildOverlay(int viewIndex, const RenderView& view, const int* viewport, const RenderScene& scene,
+                      UIBatch& live);
+    static OverlayValues readOverlayValues(const Aircraft& aircraft, int x, int y, int width, int height);
+    
+    // Overlay parts with their top left at (x, y)
+    void buildFlightPanel(UIBatch& batch, const OverlayValues& values, float x, float y);
+    void buildStatusPanel(UIBatch& batch, const OverlayValues& values, const Aircraft& aircraft, float x, float y);
+    void buildCrosshair(UIBatch& batch, float x, float y);
+    void buildMinimap(UIBatch& batch, const OverlayValues& values, float x, float y);
+    void buildPitchLadder(UIBatch& batch, float pitch, float centerX, float centerY);
+    
+    // Submit phase, on this thread
+    void applyView(const ViewState& view);
+    void renderSky(const Sky* sky, int viewIndex);     // Also applies its sun and fog to later 3D passes
+    void prepareTerrainSlots(const Terrain* terrain);
+    void updateTerrainLighting(const Sky* sky);
+    void updateTerrainSlots();
+    void submitQueue(const RenderScene& scene, int viewIndex);
+    void drawTerrainChunks(const RenderQueue::Item* items, size_t count);
+    void drawImpostors(const RenderQueue::Item* items, size_t count);
+    void drawGround(const Terrain& terrain);
+    void redrawOverlays();
+    void submitOverlays();
+    
+    void createTerrainBuffers(int chunkSize, int slotCapacity);
+    void releaseTerrainBuffers();
+    bool uploadTerrainChunk(const std::shared_ptr<TerrainChunk>& chunk, TerrainSlot& slot, int64_t staged);
+    void releaseUnloadedChunks(const Terrain* terrain);
+    void releaseOffscreenTarget();
     
     SDL_Window* window = nullptr;
     SDL_GLContext glContext = nullptr;
@@ -64,4 +405,87 @@ private:
     int screenHeight = 1080;
     
     Color clearColor = Color::SkyBlue();
+    
+    // Shadowed GL state; all enable/bind/mode changes go through this
+    GLStateCache glState;
+    
+    // Camera matrices and the frustum derived from them
+    Matrix4 projectionMatrix;
+    Matrix4 viewMatrix;
+    Vector3 eyePosition;
+    Frustum frustum;
+    
+    RenderStats stats;
+    
+    // Lit geometry shader; fixed-function lighting and fog are used when invalid
+    ShaderProgram litProgram;
+    ShaderProgram litInstancedProgram;       // Same lighting for PrimitiveMeshes instances
+    FrameUniforms frameUniforms;
+    bool frameUniformsDirty = true;
+    unsigned int frameUniformBuffer = 0;     // Only with GLSL 3.30 and uniform buffers
+    
+    // Per-frame vertex and instance data, written by the build workers
+    StreamBuffer streamBuffer;
+    
+    CloudRenderer clouds;
+    ParticleRenderer particles;
+    
+    PrimitiveMeshes primitives;
+    std::vector<PrimitiveMeshes::Instance> primitiveBatches[PrimitiveMeshes::kDetailCount];
+    
+    FrameCapture frameCapture;
+    
+    // Headless render target
+    unsigned int offscreenFramebuffer = 0;
+    unsigned int offscreenColorBuffer = 0;
+    unsigned int offscreenDepthBuffer = 0;
+    
+    // Frame build workers and one render list per thread they run on
+    ThreadPool workers;
+    std::vector<RenderList> renderLists;
+    std::vector<ViewState> viewStates;
+    std::vector<RenderQueue> viewQueues;                    // Every list's commands, sorted
+    std::vector<const AircraftMesh*> sceneAircraftMeshes;   // One per RenderScene aircraft
+    std::vector<AircraftLodState*> sceneAircraftLods;       // Likewise
+    std::vector<std::vector<SkyVertex>> skyDomes;           // Per view, built by its job
+    std::vector<uint16_t> skyDomeIndices;                   // Triangles, shared by every dome
+    
+    // Queued 2D primitives for the current frame
+    UIBatch uiBatch;
+    GlyphCache glyphCache;
+    
+    // HUD and minimap of each view, cached in textures when framebuffer
+    // objects work
+    ViewOverlay overlays[kMaxViews];
+    bool overlaysCached = false;
+    int framebufferSamples = 0;          // Of the framebuffer overlays composite onto
+    
+    std::unordered_map<int, std::unique_ptr<AircraftMesh>> aircraftMeshes;
+    std::unordered_map<const Aircraft*, AircraftLodState> aircraftLods;
+    uint64_t sceneFrame = 0;             // renderScene calls so far
+    Color impostorTint;                  // Sunlight on the lighting baked into impostors
+    Color particleLight;                 // Sky and sun on smoke and dust, which scatter from every side
+    
+    // Terrain GPU buffers
+    unsigned int terrainVertexBuffer = 0;
+    unsigned int terrainIndexBuffer = 0;
+    int terrainChunkSize = 0;            // Vertices per chunk edge the buffers were built for
+    int terrainSlotCapacity = 0;
+    int terrainIndexCount = 0;           // Indices per chunk
+    unsigned int terrainIndexType = 0;   // GL_UNSIGNED_SHORT, or GL_UNSIGNED_INT past 65536 vertices a chunk
+    std::unordered_map<std::pair<int, int>, TerrainSlot, ChunkCoordHash> terrainSlots;
+    
+    // Sunlight baked into the terrain. Each noticeable change of the sun
+    // bumps the version, and resident chunks packed with an older one are
+    // packed again on the build workers, a few each frame.
+    Vector3 terrainSunDirection;
+    Color terrainSunLight;
+    uint32_t terrainLightingVersion = 0;
+    std::atomic<int> terrainRelightBudget{0};
+    std::vector<int> freeTerrainSlots;
+    
+    // Per-frame multi-draw arguments
+    std::vector<int> terrainDrawCounts;
+    std::vector<const void*> terrainDrawOffsets;
+    std::vector<int> terrainDrawBaseVertices;
 };
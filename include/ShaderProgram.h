@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+// Linked GLSL vertex + fragment program
+class ShaderProgram {
+public:
+    ShaderProgram();
+    ~ShaderProgram();
+    
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+    
+    // Compile and link; logs the info log and returns false on failure
+    bool compile(const std::string& name, const std::string& vertexSource, const std::string& fragmentSource);
+    void release();
+    
+    bool isValid() const { return program != 0; }
+    unsigned int getId() const { return program; }
+    
+    // Cached lookup, -1 if the uniform is not active
+    int getUniformLocation(const char* uniformName);
+    
+    // Attach a uniform block to a buffer binding point; false if the block is absent
+    bool bindUniformBlock(const char* blockName, unsigned int bindingPoint);
+    
+private:
+    unsigned int compileStage(unsigned int type, const std::string& source);
+    
+    std::string name;
+    unsigned int program = 0;
+    std::unordered_map<std::string, int> uniformLocations;
+};
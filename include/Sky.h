@@ -1,8 +1,19 @@
 #pragma once
 
 #include "Types.h"
+#include "AtmosphereTables.h"
+#include <algorithm>
+#include <string>
 #include <vector>
 
+// One billboard of a cloud, placed relative to its cloud's center
+struct CloudPuff {
+    int cloud;              // Index into the cloud positions
+    Vector3 offset;
+    float size;             // Billboard half-extent
+    float shade;            // 0-1, darker at the base
+};
+
 class Sky {
 public:
     Sky();
@@ -10,16 +21,29 @@ public:
     
     void update(float deltaTime);
     
+    // Reads or builds the scattering tables (see AtmosphereTables). Until
+    // then, or if that fails, the sky uses fixed colors by time of day.
+    bool loadAtmosphere(const std::string& cachePath);
+    bool hasAtmosphere() const { return atmosphere.isReady(); }
+    
     // Time of day (0-24 hours)
     void setTimeOfDay(float hours);
     float getTimeOfDay() const { return timeOfDay; }
     
+    // Hours the time of day advances per second; 0 stops it
+    void setDaySpeed(float hoursPerSecond) { daySpeed = std::max(0.0f, hoursPerSecond); }
+    float getDaySpeed() const { return daySpeed; }
+    
     // Sky colors
     Color getSkyColorTop() const { return skyColorTop; }
     Color getSkyColorHorizon() const { return skyColorHorizon; }
     Color getSunColor() const { return sunColor; }
     Color getFogColor() const { return fogColor; }
     
+    // Displayable sky color seen along direction from altitude (meters),
+    // with the current sun and weather. Needs the atmosphere tables.
+    Color getSkyColor(const Vector3& direction, float altitude) const;
+    
     // Sun position
     Vector3 getSunDirection() const;
     float getSunIntensity() const { return sunIntensity; }
@@ -27,6 +51,7 @@ public:
     // Clouds
     const std::vector<Vector3>& getCloudPositions() const { return cloudPositions; }
     const std::vector<float>& getCloudSizes() const { return cloudSizes; }
+    const std::vector<CloudPuff>& getCloudPuffs() const { return cloudPuffs; }
     
     // Fog
     float getFogDensity() const { return fogDensity; }
@@ -39,6 +64,7 @@ public:
     
 private:
     void updateSkyColors();
+    void updateAtmosphereColors();
     void generateClouds();
     void updateClouds(float deltaTime);
     
@@ -59,7 +85,10 @@ private:
     // Clouds
     std::vector<Vector3> cloudPositions;
     std::vector<float> cloudSizes;
+    std::vector<CloudPuff> cloudPuffs;
     float cloudSpeed = 5.0f;
     
     int currentWeather = 0;
+    
+    AtmosphereTables atmosphere;
 };
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+class GLStateCache;
+
+// Ring of GPU-visible memory for data that is rewritten every frame. The
+// buffer is split into one segment per frame in flight; each frame bump
+// allocates from its own segment and fences it at the end, so the CPU never
+// writes into memory the GPU may still be reading.
+//
+// With ARB_buffer_storage the whole ring stays persistently mapped and
+// allocations point straight into it. Without it, allocations point into a
+// CPU staging copy of the segment, and flush() uploads them into a buffer
+// that is orphaned at the start of every frame.
+class StreamBuffer {
+public:
+    static constexpr int kFramesInFlight = 3;
+    
+    StreamBuffer();
+    ~StreamBuffer();
+    
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+    
+    // frameSize: bytes available to each frame; grows when a frame runs out
+    bool initialize(GLStateCache& state, size_t frameSize);
+    void release();
+    bool isReady() const { return buffer != 0; }
+    bool isPersistent() const { return mapped != nullptr; }
+    
+    unsigned int getBuffer() const { return buffer; }
+    size_t getFrameSize() const { return frameSize; }
+    
+    // Waits for the GPU to finish with the segment this frame reuses
+    void beginFrame();
+    
+    // Fences this frame's segment
+    void endFrame();
+    
+    // Reserves size bytes and returns where to write them, with their offset
+    // into getBuffer(). Safe to call from any thread between beginFrame() and
+    // endFrame(), as long as the writes finish before the GL thread draws
+    // from them. Returns nullptr when the segment is full; it is enlarged at
+    // the next beginFrame().
+    void* allocate(size_t size, size_t& offset);
+    
+    // Makes everything allocated so far readable by GL. Call on the GL thread
+    // before drawing from or copying out of the buffer; a no-op when mapped.
+    void flush();
+    
+private:
+    static constexpr size_t kAlignment = 64;     // Keeps attribute offsets aligned and writers off each other's cache lines
+    
+    bool createBuffer();
+    void destroyBuffer();
+    void waitForSegment(int segment);
+    
+    GLStateCache* state = nullptr;
+    unsigned int buffer = 0;
+    size_t frameSize = 0;
+    
+    // Persistent mapping of all segments, or nullptr in orphaning mode
+    unsigned char* mapped = nullptr;
+    void* fences[kFramesInFlight] = {};       // GLsync per segment
+    int segment = 0;
+    
+    // Orphaning mode: this frame's data until flush()
+    std::vector<unsigned char> staging;
+    size_t flushed = 0;
+    
+    std::atomic<size_t> head{0};              // Bytes asked for this frame, including any that did not fit
+};
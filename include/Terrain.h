@@ -4,6 +4,17 @@
 #include <unordered_map>
 #include <memory>
 #include <vector>
+#include <cstdint>
+
+// Terrain biomes (index into the terrain color palette)
+enum class Biome : uint8_t {
+    GRASSLAND,
+    FOREST,
+    DESERT,
+    ROCK,
+    SNOW,
+    COUNT
+};
 
 // Chunk system for infinite terrain
 struct TerrainChunk {
@@ -12,9 +23,15 @@ struct TerrainChunk {
     std::vector<Vector3> vertices;
     std::vector<Vector3> normals;
     std::vector<Color> colors;
+    std::vector<Biome> biomes;         // Per-vertex palette index
+    std::vector<float> skyVisibility;  // Per-vertex share of the sky not hidden by the terrain around it, 0-1
+    AABB bounds;                       // World-space bounds, set when generated
     bool generated;
     
     TerrainChunk(int x, int z) : chunkX(x), chunkZ(z), generated(false) {}
+    
+    // Heap bytes held by this chunk's vertex data
+    size_t getMemoryUsage() const;
 };
 
 // Hash function for chunk coordinates
@@ -32,6 +49,11 @@ public:
     void generate(int chunkSize, float scale);
     void update(float deltaTime, const Vector3& playerPosition);
     
+    // Streams chunks around several players at once, e.g. for split screen.
+    // Areas that overlap share their chunks, and a chunk is only unloaded
+    // once it is out of range of every player.
+    void update(float deltaTime, const Vector3* playerPositions, int playerCount);
+    
     // Height queries
     float getHeightAt(float x, float z) const;
     Vector3 getNormalAt(float x, float z) const;
@@ -39,6 +61,12 @@ public:
     // Terrain properties
     int getChunkSize() const { return chunkSize; }
     float getScale() const { return terrainScale; }
+    int getRenderDistance() const { return renderDistance; }
+    
+    // Streaming statistics
+    int getChunksGenerated() const { return chunksGenerated; }
+    int getChunksUnloaded() const { return chunksUnloaded; }
+    size_t getResidentMemory() const;
     
     // Runway
     const Runway& getRunway() const { return mainRunway; }
@@ -51,20 +79,30 @@ public:
     
 private:
     void generateChunk(int chunkX, int chunkZ);
-    void unloadDistantChunks(const Vector3& playerPosition);
+    void unloadDistantChunks();
     void loadChunksAroundPlayer(const Vector3& playerPosition);
+    std::pair<int, int> getChunkCoord(const Vector3& position) const;
     
+    float sampleHeight(float worldX, float worldZ) const;     // Generated height, flat under the runway
     float smoothNoise(float x, float z) const;
     float perlinNoise(float x, float z) const;
     
+    // Biomes
+    float climateNoise(float x, float z) const;
+    Biome classifyBiome(float height, float temperature, float moisture, float slope) const;
+    
     // Chunk system
     int chunkSize = 64;                // Vertices per chunk edge
     float terrainScale = 10.0f;        // Meters per vertex
     float heightScale = 400.0f;        // Max height
     int renderDistance = 4;            // Chunks to render in each direction
+    int biomeGridStep = 8;             // Vertices between biome field samples
     
     std::unordered_map<std::pair<int, int>, std::shared_ptr<TerrainChunk>, ChunkCoordHash> activeChunks;
-    std::pair<int, int> lastPlayerChunk = {0, 0};
+    std::vector<std::pair<int, int>> lastPlayerChunks = {{0, 0}};
+    
+    int chunksGenerated = 0;
+    int chunksUnloaded = 0;
     
     Runway mainRunway;
 };
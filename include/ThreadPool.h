@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for splitting up per-frame CPU work. run()
+// hands out job indices to the workers and to the calling thread alike and
+// only returns once every job has finished, so results can be used straight
+// away without further synchronisation.
+class ThreadPool {
+public:
+    // Threads including the caller of run(); 0 uses one per hardware thread
+    explicit ThreadPool(int threadCount = 0);
+    ~ThreadPool();
+    
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    
+    // Threads that execute jobs, including the one calling run()
+    int getThreadCount() const { return (int)workers.size() + 1; }
+    
+    // Calls job(index, thread) for every index in [0, jobCount). thread is 0
+    // for the caller and below getThreadCount() otherwise, so jobs can write
+    // into per-thread storage without locking. Not reentrant.
+    void run(int jobCount, const std::function<void(int index, int thread)>& job);
+    
+private:
+    static constexpr int kMaxThreads = 16;      // Frame jobs are too small to split further
+    
+    void workerLoop(int thread);
+    void runJobs(int thread);
+    
+    std::vector<std::thread> workers;
+    
+    std::mutex mutex;
+    std::condition_variable wake;               // New batch or shutdown
+    std::condition_variable finished;           // Last worker left the batch
+    uint64_t batch = 0;
+    int busyWorkers = 0;
+    bool stopping = false;
+    
+    // Current batch; written before batch is bumped under the mutex
+    const std::function<void(int, int)>* job = nullptr;
+    int jobCount = 0;
+    std::atomic<int> nextJob{0};
+};
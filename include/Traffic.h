@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Types.h"
+#include <memory>
+#include <random>
+#include <vector>
+
+class Aircraft;
+
+// AI aircraft flying level circuits around the airport. They follow their
+// circles exactly, without physics, so they cost next to nothing to update;
+// they exist to fill the sky and the renderer's aircraft path. Placement comes
+// from a fixed seed, so headless runs see the same traffic every time.
+class Traffic {
+public:
+    Traffic();
+    ~Traffic();
+    
+    // Replaces the traffic with count aircraft circling center
+    void spawn(int count, const Vector3& center);
+    void clear();
+    void update(float deltaTime);
+    
+    void appendAircraft(std::vector<const Aircraft*>& aircraft) const;
+    size_t size() const { return circuits.size(); }
+    
+private:
+    struct Circuit {
+        std::unique_ptr<Aircraft> aircraft;
+        Vector3 center;
+        float radius;
+        float angle;            // Radians around the center
+        float angularSpeed;     // Radians per second, negative for clockwise
+    };
+    
+    void place(Circuit& circuit) const;
+    
+    std::vector<Circuit> circuits;
+    std::mt19937 random;
+};
@@ -64,6 +64,124 @@ struct Vector3 {
     }
 };
 
+// Axis-aligned bounding box
+struct AABB {
+    Vector3 min;
+    Vector3 max;
+    
+    AABB() {}
+    AABB(const Vector3& min, const Vector3& max) : min(min), max(max) {}
+    
+    Vector3 center() const { return (min + max) * 0.5f; }
+    Vector3 extents() const { return (max - min) * 0.5f; }
+};
+
+// 4x4 matrix, column-major as OpenGL expects
+struct Matrix4 {
+    float m[16];
+    
+    Matrix4() {
+        for (int i = 0; i < 16; i++) m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+    }
+    
+    Matrix4 operator*(const Matrix4& other) const {
+        Matrix4 result;
+        for (int col = 0; col < 4; col++) {
+            for (int row = 0; row < 4; row++) {
+                float sum = 0.0f;
+                for (int k = 0; k < 4; k++) {
+                    sum += m[k * 4 + row] * other.m[col * 4 + k];
+                }
+                result.m[col * 4 + row] = sum;
+            }
+        }
+        return result;
+    }
+    
+    Vector3 transformPoint(const Vector3& p) const {
+        float w = m[3] * p.x + m[7] * p.y + m[11] * p.z + m[15];
+        float invW = (w != 0.0f) ? 1.0f / w : 1.0f;
+        return Vector3(
+            (m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12]) * invW,
+            (m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13]) * invW,
+            (m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14]) * invW
+        );
+    }
+    
+    static Matrix4 translation(const Vector3& t) {
+        Matrix4 result;
+        result.m[12] = t.x;
+        result.m[13] = t.y;
+        result.m[14] = t.z;
+        return result;
+    }
+    
+    static Matrix4 scale(float x, float y, float z) {
+        Matrix4 result;
+        result.m[0] = x;
+        result.m[5] = y;
+        result.m[10] = z;
+        return result;
+    }
+    
+    // Rotations about the principal axes, same as glRotatef(degrees, axis)
+    static Matrix4 rotationX(float degrees) {
+        Matrix4 result;
+        float c = std::cos(degrees * DEG_TO_RAD);
+        float s = std::sin(degrees * DEG_TO_RAD);
+        result.m[5] = c;  result.m[9] = -s;
+        result.m[6] = s;  result.m[10] = c;
+        return result;
+    }
+    
+    static Matrix4 rotationY(float degrees) {
+        Matrix4 result;
+        float c = std::cos(degrees * DEG_TO_RAD);
+        float s = std::sin(degrees * DEG_TO_RAD);
+        result.m[0] = c;  result.m[8] = s;
+        result.m[2] = -s; result.m[10] = c;
+        return result;
+    }
+    
+    static Matrix4 rotationZ(float degrees) {
+        Matrix4 result;
+        float c = std::cos(degrees * DEG_TO_RAD);
+        float s = std::sin(degrees * DEG_TO_RAD);
+        result.m[0] = c;  result.m[4] = -s;
+        result.m[1] = s;  result.m[5] = c;
+        return result;
+    }
+    
+    // Same matrix as gluPerspective
+    static Matrix4 perspective(float fovDegrees, float aspect, float nearPlane, float farPlane) {
+        Matrix4 result;
+        float f = 1.0f / std::tan(fovDegrees * DEG_TO_RAD * 0.5f);
+        result.m[0] = f / aspect;
+        result.m[5] = f;
+        result.m[10] = (farPlane + nearPlane) / (nearPlane - farPlane);
+        result.m[11] = -1.0f;
+        result.m[14] = 2.0f * farPlane * nearPlane / (nearPlane - farPlane);
+        result.m[15] = 0.0f;
+        return result;
+    }
+    
+    // Same matrix as gluLookAt
+    static Matrix4 lookAt(const Vector3& eye, const Vector3& target, const Vector3& up) {
+        Vector3 f = (target - eye).normalized();
+        Vector3 s = Vector3::cross(f, up).normalized();
+        Vector3 u = Vector3::cross(s, f);
+        
+        Matrix4 result;
+        result.m[0] = s.x;  result.m[4] = s.y;  result.m[8] = s.z;
+        result.m[1] = u.x;  result.m[5] = u.y;  result.m[9] = u.z;
+        result.m[2] = -f.x; result.m[6] = -f.y; result.m[10] = -f.z;
+        result.m[12] = -Vector3::dot(s, eye);
+        result.m[13] = -Vector3::dot(u, eye);
+        result.m[14] = Vector3::dot(f, eye);
+        return result;
+    }
+};
+
 // Color structure
 struct Color {
     float r, g, b, a;
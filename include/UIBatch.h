@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Types.h"
+#include "GLStateCache.h"
+#include <cstdint>
+#include <vector>
+
+// Screen-space 2D primitives collected over a frame and drawn together.
+// Coordinates are in pixels with the origin at the top-left corner.
+class UIBatch {
+public:
+    struct Vertex {
+        float x, y;
+        uint8_t color[4];
+    };
+    
+    UIBatch();
+    
+    void addTriangle(float x0, float y0, float x1, float y1, float x2, float y2, const Color& color);
+    void addRect(float x, float y, float width, float height, const Color& color);
+    void addRectOutline(float x, float y, float width, float height, const Color& color);
+    void addCircle(float x, float y, float radius, const Color& color);
+    void addCircleOutline(float x, float y, float radius, const Color& color);
+    void addLine(float x0, float y0, float x1, float y1, const Color& color);
+    void addLines(const Vertex* vertices, size_t count);    // Pairs, copied as-is
+    void append(const UIBatch& other);                      // Queued after everything already here
+    
+    // Draw everything queued so far (filled shapes first, then lines) and clear
+    void flush(GLStateCache& state, int screenWidth, int screenHeight);
+    void clear();
+    
+    bool empty() const { return triangles.empty() && lines.empty(); }
+    size_t getVertexCount() const { return triangles.size() + lines.size(); }
+    
+    static Vertex makeVertex(float x, float y, const Color& color);
+    
+private:
+    static const int kCircleSegments = 32;
+    
+    std::vector<Vertex> triangles;   // GL_TRIANGLES
+    std::vector<Vertex> lines;       // GL_LINES
+    
+    // Unit circle, shared by every circle in the batch; small circles use every
+    // second or fourth point
+    float circleCos[kCircleSegments + 1];
+    float circleSin[kCircleSegments + 1];
+};
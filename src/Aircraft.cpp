@@ -268,7 +268,7 @@ void Aircraft::applyPhysics(float deltaTime) {
 
 void Aircraft::checkGroundCollision() {
     float groundHeight = 0.0f;  // Flat ground for now
-    float gearHeight = landingGearDown ? 3.0f : 1.5f;
+    float gearHeight = getGearHeight();
     
     if (position.y <= groundHeight + gearHeight) {
         // Check if landing or crashing
@@ -0,0 +1,471 @@
+#include "AtmosphereTables.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    // Table sizes. Scattering is indexed by the altitude r, the view zenith
+    // cosine mu, the sun zenith cosine mu_s and the view-sun cosine nu.
+    constexpr int kTransmittanceMuSize = 256;
+    constexpr int kTransmittanceRSize = 64;
+    constexpr int kScatteringRSize = 16;
+    constexpr int kScatteringMuSize = 64;
+    constexpr int kScatteringMuSSize = 32;
+    constexpr int kScatteringNuSize = 8;
+    constexpr int kScatteringChannels = 6;
+    
+    constexpr int kTransmittanceSamples = 100;
+    constexpr int kScatteringSamples = 50;
+    
+    constexpr char kMagic[4] = { 'F', 'S', 'A', 'T' };
+    constexpr uint32_t kVersion = 1;
+    
+    // Earth's atmosphere, lengths in kilometers (Bruneton 2017, with ozone)
+    constexpr double kBottomRadius = 6360.0;
+    constexpr double kTopRadius = 6420.0;
+    constexpr double kRayleighScattering[3] = { 5.802e-3, 13.558e-3, 33.1e-3 };
+    constexpr double kRayleighScaleHeight = 8.0;
+    constexpr double kMieScattering = 3.996e-3;
+    constexpr double kMieExtinction = 4.44e-3;
+    constexpr double kMieScaleHeight = 1.2;
+    constexpr double kMieAsymmetry = 0.8;
+    constexpr double kOzoneAbsorption[3] = { 0.650e-3, 1.881e-3, 0.085e-3 };
+    constexpr double kOzoneCenter = 25.0;           // Ozone density peaks here and falls off linearly
+    constexpr double kOzoneHalfWidth = 15.0;
+    constexpr double kSunAngularRadius = 0.004675;
+    constexpr double kMuSMin = -0.2;                // Lowest sun that still lights the sky, about 102 degrees
+    
+    constexpr double kPi = 3.14159265358979323846;
+    
+    // Distance to the top boundary along a ray tangent to the ground
+    const double kHorizonDistance = std::sqrt(kTopRadius * kTopRadius - kBottomRadius * kBottomRadius);
+    
+    struct Rgb {
+        double r, g, b;
+        
+        Rgb operator+(const Rgb& o) const { return { r + o.r, g + o.g, b + o.b }; }
+        Rgb operator*(const Rgb& o) const { return { r * o.r, g * o.g, b * o.b }; }
+        Rgb operator*(double s) const { return { r * s, g * s, b * s }; }
+        Rgb& operator+=(const Rgb& o) { r += o.r; g += o.g; b += o.b; return *this; }
+    };
+    
+    const Rgb kRayleigh = { kRayleighScattering[0], kRayleighScattering[1], kRayleighScattering[2] };
+    
+    double clampCosine(double mu) { return std::max(-1.0, std::min(1.0, mu)); }
+    double clampDistance(double d) { return std::max(d, 0.0); }
+    double clampRadius(double r) { return std::max(kBottomRadius, std::min(kTopRadius, r)); }
+    double safeSqrt(double a) { return std::sqrt(std::max(a, 0.0)); }
+    
+    double distanceToTop(double r, double mu) {
+        return clampDistance(-r * mu + safeSqrt(r * r * (mu * mu - 1.0) + kTopRadius * kTopRadius));
+    }
+    
+    double distanceToBottom(double r, double mu) {
+        return clampDistance(-r * mu - safeSqrt(r * r * (mu * mu - 1.0) + kBottomRadius * kBottomRadius));
+    }
+    
+    bool rayIntersectsGround(double r, double mu) {
+        return mu < 0.0 && r * r * (mu * mu - 1.0) + kBottomRadius * kBottomRadius >= 0.0;
+    }
+    
+    // Texture coordinates that put 0 and 1 on the first and last texel centers
+    double textureCoord(double x, int size) { return 0.5 / size + x * (1.0 - 1.0 / size); }
+    double unitRange(double u, int size) { return (u - 0.5 / size) / (1.0 - 1.0 / size); }
+    
+    Rgb extinctionAt(double altitude) {
+        double rayleigh = std::exp(-altitude / kRayleighScaleHeight);
+        double mie = std::exp(-altitude / kMieScaleHeight) * kMieExtinction;
+        double ozone = std::max(0.0, 1.0 - std::fabs(altitude - kOzoneCenter) / kOzoneHalfWidth);
+        return { kRayleighScattering[0] * rayleigh + mie + kOzoneAbsorption[0] * ozone,
+                 kRayleighScattering[1] * rayleigh + mie + kOzoneAbsorption[1] * ozone,
+                 kRayleighScattering[2] * rayleigh + mie + kOzoneAbsorption[2] * ozone };
+    }
+    
+    // Transmittance table: x is the distance to the top boundary between its
+    // shortest and longest for the altitude, y the distance to the horizon
+    void transmittanceUv(double r, double mu, double& u, double& v) {
+        double rho = safeSqrt(r * r - kBottomRadius * kBottomRadius);
+        double d = distanceToTop(r, mu);
+        double dMin = kTopRadius - r;
+        double dMax = rho + kHorizonDistance;
+        u = textureCoord((d - dMin) / (dMax - dMin), kTransmittanceMuSize);
+        v = textureCoord(rho / kHorizonDistance, kTransmittanceRSize);
+    }
+    
+    void transmittanceRMu(double u, double v, double& r, double& mu) {
+        double rho = kHorizonDistance * unitRange(v, kTransmittanceRSize);
+        r = std::sqrt(rho * rho + kBottomRadius * kBottomRadius);
+        double dMin = kTopRadius - r;
+        double dMax = rho + kHorizonDistance;
+        double d = dMin + unitRange(u, kTransmittanceMuSize) * (dMax - dMin);
+        mu = d == 0.0 ? 1.0 : clampCosine((kHorizonDistance * kHorizonDistance - rho * rho - d * d) / (2.0 * r * d));
+    }
+    
+    // Scattering table coordinates. Rays that hit the ground use the lower
+    // half of mu and the rest the upper half, so filtering never mixes them.
+    struct ScatteringUv {
+        double nu, muS, mu, r;
+    };
+    
+    ScatteringUv scatteringUv(double r, double mu, double muS, double nu, bool ground) {
+        ScatteringUv uv;
+        double rho = safeSqrt(r * r - kBottomRadius * kBottomRadius);
+        uv.r = textureCoord(rho / kHorizonDistance, kScatteringRSize);
+        
+        double rMu = r * mu;
+        double discriminant = rMu * rMu - r * r + kBottomRadius * kBottomRadius;
+        if (ground) {
+            double d = -rMu - safeSqrt(discriminant);
+            double dMin = r - kBottomRadius;
+            double dMax = rho;
+            double x = dMax == dMin ? 0.0 : (d - dMin) / (dMax - dMin);
+            uv.mu = 0.5 - 0.5 * textureCoord(x, kScatteringMuSize / 2);
+        } else {
+            double d = -rMu + safeSqrt(discriminant + kHorizonDistance * kHorizonDistance);
+            double dMin = kTopRadius - r;
+            double dMax = rho + kHorizonDistance;
+            uv.mu = 0.5 + 0.5 * textureCoord((d - dMin) / (dMax - dMin), kScatteringMuSize / 2);
+        }
+        
+        double d = distanceToTop(kBottomRadius, muS);
+        double dMin = kTopRadius - kBottomRadius;
+        double dMax = kHorizonDistance;
+        double a = (d - dMin) / (dMax - dMin);
+        double bigA = (distanceToTop(kBottomRadius, kMuSMin) - dMin) / (dMax - dMin);
+        uv.muS = textureCoord(std::max(1.0 - a / bigA, 0.0) / (1.0 + a), kScatteringMuSSize);
+        
+        uv.nu = (nu + 1.0) * 0.5;
+        return uv;
+    }
+    
+    void scatteringParameters(const ScatteringUv& uv, double& r, double& mu, double& muS, double& nu, bool& ground) {
+        double rho = kHorizonDistance * unitRange(uv.r, kScatteringRSize);
+        r = std::sqrt(rho * rho + kBottomRadius * kBottomRadius);
+        
+        if (uv.mu < 0.5) {
+            double dMin = r - kBottomRadius;
+            double dMax = rho;
+            double d = dMin + (dMax - dMin) * unitRange(1.0 - 2.0 * uv.mu, kScatteringMuSize / 2);
+            mu = d == 0.0 ? -1.0 : clampCosine(-(rho * rho + d * d) / (2.0 * r * d));
+            ground = true;
+        } else {
+            double dMin = kTopRadius - r;
+            double dMax = rho + kHorizonDistance;
+            double d = dMin + (dMax - dMin) * unitRange(2.0 * uv.mu - 1.0, kScatteringMuSize / 2);
+            mu = d == 0.0 ? 1.0 : clampCosine((kHorizonDistance * kHorizonDistance - rho * rho - d * d) / (2.0 * r * d));
+            ground = false;
+        }
+        
+        double xMuS = unitRange(uv.muS, kScatteringMuSSize);
+        double dMin = kTopRadius - kBottomRadius;
+        double dMax = kHorizonDistance;
+        double bigA = (distanceToTop(kBottomRadius, kMuSMin) - dMin) / (dMax - dMin);
+        double a = (bigA - xMuS * bigA) / (1.0 + xMuS * bigA);
+        double d = dMin + std::min(a, bigA) * (dMax - dMin);
+        muS = d == 0.0 ? 1.0 : clampCosine((kHorizonDistance * kHorizonDistance - d * d) / (2.0 * kBottomRadius * d));
+        
+        // Only cosines the two zenith angles allow
+        double spread = std::sqrt((1.0 - mu * mu) * (1.0 - muS * muS));
+        nu = std::max(mu * muS - spread, std::min(mu * muS + spread, clampCosine(uv.nu * 2.0 - 1.0)));
+    }
+    
+    // Linear filtering between texel centers, clamped at the edges
+    void filterWeights(double coord, int size, int& index, double& fraction) {
+        double position = std::max(0.0, std::min((double)(size - 1), coord * size - 0.5));
+        index = std::min((int)position, size - 2);
+        fraction = position - index;
+    }
+    
+    Rgb lookupTransmittance(const std::vector<float>& table, double r, double mu) {
+        double u, v;
+        transmittanceUv(r, mu, u, v);
+        int x, y;
+        double fx, fy;
+        filterWeights(u, kTransmittanceMuSize, x, fx);
+        filterWeights(v, kTransmittanceRSize, y, fy);
+        
+        Rgb result = { 0.0, 0.0, 0.0 };
+        for (int dy = 0; dy < 2; dy++) {
+            for (int dx = 0; dx < 2; dx++) {
+                const float* texel = &table[((y + dy) * kTransmittanceMuSize + x + dx) * 3];
+                double weight = (dx ? fx : 1.0 - fx) * (dy ? fy : 1.0 - fy);
+                result += Rgb{ texel[0], texel[1], texel[2] } * weight;
+            }
+        }
+        return result;
+    }
+    
+    // Along a ray from radius r at zenith cosine mu, to distance d
+    Rgb transmittanceAlong(const std::vector<float>& table, double r, double mu, double d, bool ground) {
+        double rD = clampRadius(std::sqrt(d * d + 2.0 * r * mu * d + r * r));
+        double muD = clampCosine((r * mu + d) / rD);
+        Rgb near, far;
+        if (ground) {
+            near = lookupTransmittance(table, rD, -muD);
+            far = lookupTransmittance(table, r, -mu);
+        } else {
+            near = lookupTransmittance(table, r, mu);
+            far = lookupTransmittance(table, rD, muD);
+        }
+        return { std::min(near.r / std::max(far.r, 1e-12), 1.0), std::min(near.g / std::max(far.g, 1e-12), 1.0),
+                 std::min(near.b / std::max(far.b, 1e-12), 1.0) };
+    }
+    
+    // Fades the sun out as it sets behind the horizon
+    Rgb transmittanceToSun(const std::vector<float>& table, double r, double muS) {
+        double sinHorizon = kBottomRadius / r;
+        double cosHorizon = -safeSqrt(1.0 - sinHorizon * sinHorizon);
+        double edge = sinHorizon * kSunAngularRadius;
+        double t = std::max(0.0, std::min(1.0, (muS - cosHorizon + edge) / (2.0 * edge)));
+        return lookupTransmittance(table, r, muS) * (t * t * (3.0 - 2.0 * t));
+    }
+    
+    double rayleighPhase(double nu) {
+        return 3.0 / (16.0 * kPi) * (1.0 + nu * nu);
+    }
+    
+    double miePhase(double nu) {
+        double g = kMieAsymmetry;
+        double k = 3.0 / (8.0 * kPi) * (1.0 - g * g) / (2.0 + g * g);
+        return k * (1.0 + nu * nu) / std::pow(1.0 + g * g - 2.0 * g * nu, 1.5);
+    }
+}
+
+AtmosphereTables::AtmosphereTables() {}
+
+AtmosphereTables::~AtmosphereTables() {}
+
+AtmosphereTables::Header AtmosphereTables::makeHeader() {
+    Header header = {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    const uint32_t sizes[] = { kTransmittanceMuSize, kTransmittanceRSize, kScatteringRSize, kScatteringMuSize,
+                               kScatteringMuSSize, kScatteringNuSize };
+    std::copy(sizes, sizes + 6, header.sizes);
+    
+    // FNV-1a over the constants, so tables built for other ones are rebuilt
+    const double parameters[] = {
+        kBottomRadius, kTopRadius, kRayleighScattering[0], kRayleighScattering[1], kRayleighScattering[2],
+        kRayleighScaleHeight, kMieScattering, kMieExtinction, kMieScaleHeight, kOzoneAbsorption[0],
+        kOzoneAbsorption[1], kOzoneAbsorption[2], kOzoneCenter, kOzoneHalfWidth, kSunAngularRadius, kMuSMin,
+        (double)kTransmittanceSamples, (double)kScatteringSamples
+    };
+    uint32_t hash = 2166136261u;
+    const uint8_t* bytes = (const uint8_t*)parameters;
+    for (size_t i = 0; i < sizeof(parameters); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    header.parameters = hash;
+    return header;
+}
+
+bool AtmosphereTables::initialize(const std::string& cachePath) {
+    if (readCache(cachePath)) {
+        cached = true;
+        std::cout << "Atmosphere: tables read from " << cachePath << std::endl;
+        return true;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    cached = false;
+    if (!build()) {
+        std::cerr << "Atmosphere: building the tables produced invalid values" << std::endl;
+        return false;
+    }
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Atmosphere: tables built in " << (int)milliseconds << " ms" << std::endl;
+    
+    // Not fatal: the tables are in memory, the next run builds them again
+    writeCache(cachePath);
+    return isReady();
+}
+
+bool AtmosphereTables::build() {
+    ThreadPool workers;
+    
+    // Transmittance first, a row per job; scattering reads it
+    std::vector<float> transmittanceTable((size_t)kTransmittanceMuSize * kTransmittanceRSize * 3);
+    workers.run(kTransmittanceRSize, [&](int y, int) {
+        for (int x = 0; x < kTransmittanceMuSize; x++) {
+            double r, mu;
+            transmittanceRMu((x + 0.5) / kTransmittanceMuSize, (y + 0.5) / kTransmittanceRSize, r, mu);
+            
+            double step = distanceToTop(r, mu) / kTransmittanceSamples;
+            Rgb depth = { 0.0, 0.0, 0.0 };
+            for (int i = 0; i <= kTransmittanceSamples; i++) {
+                double d = i * step;
+                double altitude = std::sqrt(d * d + 2.0 * r * mu * d + r * r) - kBottomRadius;
+                double weight = (i == 0 || i == kTransmittanceSamples) ? 0.5 : 1.0;
+                depth += extinctionAt(altitude) * (weight * step);
+            }
+            
+            float* texel = &transmittanceTable[((size_t)y * kTransmittanceMuSize + x) * 3];
+            texel[0] = (float)std::exp(-depth.r);
+            texel[1] = (float)std::exp(-depth.g);
+            texel[2] = (float)std::exp(-depth.b);
+        }
+    });
+    
+    // Single scattering, one (r, mu) row of mu_s and nu per job
+    std::vector<float> scatteringTable((size_t)kScatteringRSize * kScatteringMuSize * kScatteringMuSSize *
+                                       kScatteringNuSize * kScatteringChannels);
+    workers.run(kScatteringRSize * kScatteringMuSize, [&](int row, int) {
+        int rIndex = row / kScatteringMuSize;
+        int muIndex = row % kScatteringMuSize;
+        float* texel = &scatteringTable[(size_t)row * kScatteringMuSSize * kScatteringNuSize * kScatteringChannels];
+        
+        for (int muSIndex = 0; muSIndex < kScatteringMuSSize; muSIndex++) {
+            for (int nuIndex = 0; nuIndex < kScatteringNuSize; nuIndex++, texel += kScatteringChannels) {
+                ScatteringUv uv;
+                uv.r = (rIndex + 0.5) / kScatteringRSize;
+                uv.mu = (muIndex + 0.5) / kScatteringMuSize;
+                uv.muS = (muSIndex + 0.5) / kScatteringMuSSize;
+                uv.nu = (double)nuIndex / (kScatteringNuSize - 1);
+                double r, mu, muS, nu;
+                bool ground;
+                scatteringParameters(uv, r, mu, muS, nu, ground);
+                
+                // Sunlight scattered at points along the ray, attenuated on
+                // its way in from the sun and out to the viewer
+                double step = (ground ? distanceToBottom(r, mu) : distanceToTop(r, mu)) / kScatteringSamples;
+                Rgb rayleigh = { 0.0, 0.0, 0.0 };
+                Rgb mie = { 0.0, 0.0, 0.0 };
+                for (int i = 0; i <= kScatteringSamples; i++) {
+                    double d = i * step;
+                    double rD = clampRadius(std::sqrt(d * d + 2.0 * r * mu * d + r * r));
+                    double muSD = clampCosine((r * muS + d * nu) / rD);
+                    Rgb light = transmittanceAlong(transmittanceTable, r, mu, d, ground) *
+                                transmittanceToSun(transmittanceTable, rD, muSD);
+                    double weight = (i == 0 || i == kScatteringSamples) ? 0.5 : 1.0;
+                    double altitude = rD - kBottomRadius;
+                    rayleigh += light * (std::exp(-altitude / kRayleighScaleHeight) * weight);
+                    mie += light * (std::exp(-altitude / kMieScaleHeight) * weight);
+                }
+                rayleigh = rayleigh * kRayleigh * step;
+                mie = mie * (kMieScattering * step);
+                
+                texel[0] = (float)rayleigh.r;
+                texel[1] = (float)rayleigh.g;
+                texel[2] = (float)rayleigh.b;
+                texel[3] = (float)mie.r;
+                texel[4] = (float)mie.g;
+                texel[5] = (float)mie.b;
+            }
+        }
+    });
+    
+    // One NaN would spread to every sky color interpolated from it
+    auto finite = [](const std::vector<float>& table) {
+        return std::all_of(table.begin(), table.end(), [](float value) { return std::isfinite(value); });
+    };
+    if (!finite(transmittanceTable) || !finite(scatteringTable)) return false;
+    
+    transmittance.swap(transmittanceTable);
+    scattering.swap(scatteringTable);
+    return true;
+}
+
+bool AtmosphereTables::readCache(const std::string& cachePath) {
+    std::ifstream file(cachePath, std::ios::binary);
+    if (!file.is_open()) return false;
+    
+    Header expected = makeHeader();
+    Header header;
+    if (!file.read((char*)&header, sizeof(header)) || std::memcmp(&header, &expected, sizeof(header)) != 0) {
+        return false;
+    }
+    
+    std::vector<float> transmittanceTable((size_t)kTransmittanceMuSize * kTransmittanceRSize * 3);
+    std::vector<float> scatteringTable((size_t)kScatteringRSize * kScatteringMuSize * kScatteringMuSSize *
+                                       kScatteringNuSize * kScatteringChannels);
+    if (!file.read((char*)transmittanceTable.data(), transmittanceTable.size() * sizeof(float)) ||
+        !file.read((char*)scatteringTable.data(), scatteringTable.size() * sizeof(float)) ||
+        file.peek() != std::ifstream::traits_type::eof()) {
+        return false;
+    }
+    
+    transmittance.swap(transmittanceTable);
+    scattering.swap(scatteringTable);
+    return true;
+}
+
+void AtmosphereTables::writeCache(const std::string& cachePath) const {
+    // Written aside and renamed into place, so a concurrent or interrupted
+    // run never reads a partial file
+    Header header = makeHeader();
+    std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file.is_open() || !file.write((const char*)&header, sizeof(header)) ||
+            !file.write((const char*)transmittance.data(), transmittance.size() * sizeof(float)) ||
+            !file.write((const char*)scattering.data(), scattering.size() * sizeof(float))) {
+            std::cerr << "Atmosphere: failed to write cache " << cachePath << ", continuing without it" << std::endl;
+            file.close();
+            std::remove(tempPath.c_str());
+            return;
+        }
+    }
+    if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+        std::cerr << "Atmosphere: failed to write cache " << cachePath << ", continuing without it" << std::endl;
+        std::remove(tempPath.c_str());
+    }
+}
+
+Color AtmosphereTables::getTransmittance(float altitude, float cosZenith) const {
+    if (!isReady()) return Color(1.0f, 1.0f, 1.0f, 1.0f);
+    
+    double r = kBottomRadius + std::max(0.0, std::min((double)altitude * 0.001, kTopRadius - kBottomRadius));
+    Rgb result = transmittanceToSun(transmittance, r, clampCosine(cosZenith));
+    return Color((float)result.r, (float)result.g, (float)result.b, 1.0f);
+}
+
+Color AtmosphereTables::getSkyRadiance(float altitude, const Vector3& direction, const Vector3& sunDirection) const {
+    if (!isReady()) return Color(0.0f, 0.0f, 0.0f, 1.0f);
+    
+    // The viewer stands on the +y axis of the planet
+    double r = kBottomRadius + std::max(0.0, std::min((double)altitude * 0.001, kTopRadius - kBottomRadius - 0.01));
+    Vector3 view = direction.normalized();
+    Vector3 sun = sunDirection.normalized();
+    double mu = view.y;
+    double muS = sun.y;
+    double nu = Vector3::dot(view, sun);
+    bool ground = rayIntersectsGround(r, mu);
+    
+    ScatteringUv uv = scatteringUv(r, mu, muS, nu, ground);
+    int rIndex, muIndex, muSIndex, nuIndex;
+    double rFraction, muFraction, muSFraction;
+    filterWeights(uv.r, kScatteringRSize, rIndex, rFraction);
+    filterWeights(uv.mu, kScatteringMuSize, muIndex, muFraction);
+    filterWeights(uv.muS, kScatteringMuSSize, muSIndex, muSFraction);
+    
+    // nu is sampled at the texels themselves, from -1 to 1
+    double nuPosition = uv.nu * (kScatteringNuSize - 1);
+    nuIndex = std::min((int)nuPosition, kScatteringNuSize - 2);
+    double nuFraction = nuPosition - nuIndex;
+    
+    Rgb rayleigh = { 0.0, 0.0, 0.0 };
+    Rgb mie = { 0.0, 0.0, 0.0 };
+    for (int corner = 0; corner < 16; corner++) {
+        int dr = corner & 1;
+        int dmu = (corner >> 1) & 1;
+        int dmuS = (corner >> 2) & 1;
+        int dnu = corner >> 3;
+        double weight = (dr ? rFraction : 1.0 - rFraction) * (dmu ? muFraction : 1.0 - muFraction) *
+                        (dmuS ? muSFraction : 1.0 - muSFraction) * (dnu ? nuFraction : 1.0 - nuFraction);
+        if (weight == 0.0) continue;
+        
+        size_t index = (((size_t)(rIndex + dr) * kScatteringMuSize + muIndex + dmu) * kScatteringMuSSize +
+                        muSIndex + dmuS) * kScatteringNuSize + nuIndex + dnu;
+        const float* texel = &scattering[index * kScatteringChannels];
+        rayleigh += Rgb{ texel[0], texel[1], texel[2] } * weight;
+        mie += Rgb{ texel[3], texel[4], texel[5] } * weight;
+    }
+    
+    Rgb radiance = rayleigh * rayleighPhase(nu) + mie * miePhase(nu);
+    return Color((float)radiance.r, (float)radiance.g, (float)radiance.b, 1.0f);
+}
@@ -0,0 +1,311 @@
+#include "CloudRenderer.h"
+#include "Sky.h"
+#include "Frustum.h"
+#include "GLStateCache.h"
+#include "GLExtensions.h"
+#include "StreamBuffer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+namespace {
+    constexpr int kTextureSize = 64;
+    
+    // Puff centers lie within 1.44 cloud sizes of the cloud center and puffs
+    // reach up to 0.6 sizes beyond that
+    constexpr float kCloudRadiusScale = 2.05f;
+    
+    const char* kCloudVertexShader =
+        "#version 330 compatibility\n"
+        "layout(location = 0) in vec2 corner;\n"
+        "layout(location = 1) in vec4 puff;\n"           // Center xyz, half-extent w
+        "layout(location = 2) in vec4 puffColor;\n"
+        "out vec2 texCoord;\n"
+        "out vec4 color;\n"
+        "void main() {\n"
+        "    vec4 eyeCenter = gl_ModelViewMatrix * vec4(puff.xyz, 1.0);\n"
+        "    gl_Position = gl_ProjectionMatrix * (eyeCenter + vec4(corner * puff.w, 0.0, 0.0));\n"
+        "    texCoord = corner * 0.5 + 0.5;\n"
+        "    color = puffColor;\n"
+        "}\n";
+    
+    const char* kCloudFragmentShader =
+        "#version 330 compatibility\n"
+        "uniform sampler2D puffTexture;\n"
+        "in vec2 texCoord;\n"
+        "in vec4 color;\n"
+        "out vec4 fragColor;\n"
+        "void main() {\n"
+        "    fragColor = color * texture(puffTexture, texCoord);\n"
+        "}\n";
+    
+    uint8_t toByte(float value) {
+        return (uint8_t)(std::max(0.0f, std::min(1.0f, value)) * 255.0f + 0.5f);
+    }
+}
+
+CloudRenderer::CloudRenderer() : views(1) {
+}
+
+CloudRenderer::~CloudRenderer() {
+    release();
+}
+
+void CloudRenderer::initialize(GLStateCache& cache) {
+    release();
+    state = &cache;
+    
+    createTexture();
+    
+    if (GLExt::hasInstancing &&
+        program.compile("clouds", kCloudVertexShader, kCloudFragmentShader)) {
+        state->useProgram(program.getId());
+        glUniform1i(program.getUniformLocation("puffTexture"), 0);
+        
+        // Triangle strip order
+        const float corners[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+        glGenBuffers(1, &cornerBuffer);
+        state->bindBuffer(GL_ARRAY_BUFFER, cornerBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        
+        glGenBuffers(1, &instanceBuffer);
+    }
+    
+    std::cout << "Clouds: " << (program.isValid() ? "instanced billboards" : "CPU billboards") << std::endl;
+}
+
+void CloudRenderer::release() {
+    program.release();
+    if (state) {
+        state->deleteBuffer(cornerBuffer);
+        state->deleteBuffer(instanceBuffer);
+    }
+    cornerBuffer = 0;
+    instanceBuffer = 0;
+    
+    if (texture) {
+        glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+}
+
+void CloudRenderer::createTexture() {
+    // White with a soft round alpha falloff
+    std::vector<uint8_t> pixels(kTextureSize * kTextureSize * 4);
+    for (int y = 0; y < kTextureSize; y++) {
+        for (int x = 0; x < kTextureSize; x++) {
+            float dx = (x + 0.5f) / kTextureSize * 2.0f - 1.0f;
+            float dy = (y + 0.5f) / kTextureSize * 2.0f - 1.0f;
+            float falloff = std::max(0.0f, 1.0f - (dx * dx + dy * dy));
+            
+            uint8_t* pixel = &pixels[(y * kTextureSize + x) * 4];
+            pixel[0] = pixel[1] = pixel[2] = 255;
+            pixel[3] = toByte(falloff * std::sqrt(falloff));
+        }
+    }
+    
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, kTextureSize, kTextureSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+}
+
+void CloudRenderer::setViewCount(int count) {
+    views.resize(std::max(count, 1));
+}
+
+void CloudRenderer::prepare(int view, const Sky& sky, const Vector3& cameraPosition, const Matrix4& viewMatrix,
+                            const Frustum& frustum) {
+    ViewBatch& batch = views[view];
+    batch.puffsDrawn = 0;
+    batch.puffsCulled = 0;
+    batch.instances.clear();
+    batch.quads.clear();
+    
+    const std::vector<Vector3>& positions = sky.getCloudPositions();
+    const std::vector<float>& sizes = sky.getCloudSizes();
+    const std::vector<CloudPuff>& puffs = sky.getCloudPuffs();
+    if (puffs.empty() || !texture) return;
+    
+    float fogStart = sky.getFogStart();
+    float fogEnd = sky.getFogEnd();
+    float invFogRange = 1.0f / std::max(fogEnd - fogStart, 1.0f);
+    
+    // Whole clouds against the frustum and the fog distance
+    batch.cloudVisible.resize(positions.size());
+    for (size_t i = 0; i < positions.size(); i++) {
+        float radius = sizes[i] * kCloudRadiusScale;
+        float distance = (positions[i] - cameraPosition).length();
+        batch.cloudVisible[i] = distance - radius < fogEnd && frustum.intersectsSphere(positions[i], radius);
+    }
+    
+    batch.order.clear();
+    for (size_t i = 0; i < puffs.size(); i++) {
+        const CloudPuff& puff = puffs[i];
+        if (!batch.cloudVisible[puff.cloud]) {
+            batch.puffsCulled++;
+            continue;
+        }
+        
+        Vector3 toPuff = positions[puff.cloud] + puff.offset - cameraPosition;
+        batch.order.emplace_back(toPuff.x * toPuff.x + toPuff.y * toPuff.y + toPuff.z * toPuff.z, (int)i);
+    }
+    
+    // Back to front for blending
+    std::sort(batch.order.begin(), batch.order.end(), [](const std::pair<float, int>& a, const std::pair<float, int>& b) {
+        return a.first > b.first;
+    });
+    batch.farthestDistance = batch.order.empty() ? 0.0f : std::sqrt(batch.order.front().first);
+    
+    // Lit by sky ambient plus the sun, darker in heavier weather, and faded
+    // into the fog on the CPU since every puff is touched here anyway
+    Color sun = sky.getSunColor();
+    Color fog = sky.getFogColor();
+    float sunStrength = 0.45f * sky.getSunIntensity();
+    float weatherShade = 1.0f - 0.15f * sky.getWeather();
+    
+    // Room for every sorted puff; the instanced path writes them straight
+    // into GPU-visible memory so drawing only binds it
+    Instance* out = nullptr;
+    batch.streamed = false;
+    if (stream && program.isValid() && !batch.order.empty()) {
+        out = (Instance*)stream->allocate(batch.order.size() * sizeof(Instance), batch.streamOffset);
+        batch.streamed = (out != nullptr);
+    }
+    if (!out) {
+        batch.instances.resize(batch.order.size());
+        out = batch.instances.data();
+    }
+    
+    int count = 0;
+    for (const auto& entry : batch.order) {
+        const CloudPuff& puff = puffs[entry.second];
+        float visibility = std::min(1.0f, (fogEnd - std::sqrt(entry.first)) * invFogRange);
+        if (visibility <= 0.0f) {
+            batch.puffsCulled++;
+            continue;
+        }
+        
+        float shade = puff.shade * weatherShade;
+        Vector3 center = positions[puff.cloud] + puff.offset;
+        
+        Instance instance;
+        instance.center[0] = center.x;
+        instance.center[1] = center.y;
+        instance.center[2] = center.z;
+        instance.size = puff.size;
+        instance.color[0] = toByte(fog.r + ((0.55f + sun.r * sunStrength) * shade - fog.r) * visibility);
+        instance.color[1] = toByte(fog.g + ((0.55f + sun.g * sunStrength) * shade - fog.g) * visibility);
+        instance.color[2] = toByte(fog.b + ((0.6f + sun.b * sunStrength) * shade - fog.b) * visibility);
+        instance.color[3] = toByte(0.85f * visibility);
+        out[count++] = instance;
+    }
+    
+    batch.puffsDrawn = count;
+    if (!batch.streamed) {
+        batch.instances.resize(count);
+    }
+    
+    if (!program.isValid()) {
+        buildQuads(batch, viewMatrix);
+    }
+}
+
+void CloudRenderer::draw(int view, GLStateCache& state) {
+    const ViewBatch& batch = views[view];
+    if (batch.puffsDrawn == 0) return;
+    
+    // Blended over the scene: depth tested, but no depth writes
+    state.disable(GL_LIGHTING);
+    state.disable(GL_FOG);
+    state.enable(GL_DEPTH_TEST);
+    state.depthMask(false);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    
+    if (program.isValid()) {
+        drawInstanced(batch, state);
+    } else {
+        drawQuads(batch, state);
+    }
+}
+
+void CloudRenderer::drawInstanced(const ViewBatch& batch, GLStateCache& state) {
+    state.useProgram(program.getId());
+    
+    size_t base = 0;
+    if (batch.streamed) {
+        stream->flush();
+        state.bindBuffer(GL_ARRAY_BUFFER, stream->getBuffer());
+        base = batch.streamOffset;
+    } else {
+        state.bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, batch.instances.size() * sizeof(Instance), batch.instances.data(),
+                     GL_STREAM_DRAW);
+    }
+    
+    // Generic attribute 0 overrides gl_Vertex in the compatibility profile, so
+    // these arrays are switched off again before any fixed-function draw
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (const void*)(base + offsetof(Instance, center)));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Instance),
+                          (const void*)(base + offsetof(Instance, color)));
+    GLExt::VertexAttribDivisor(1, 1);
+    GLExt::VertexAttribDivisor(2, 1);
+    
+    state.bindBuffer(GL_ARRAY_BUFFER, cornerBuffer);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    
+    GLExt::DrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)batch.puffsDrawn);
+    
+    glDisableVertexAttribArray(0);
+    glDisableVertexAttribArray(1);
+    glDisableVertexAttribArray(2);
+}
+
+void CloudRenderer::buildQuads(ViewBatch& batch, const Matrix4& viewMatrix) {
+    // Camera right and up axes are the first two rows of the view rotation
+    const float* v = viewMatrix.m;
+    Vector3 right(v[0], v[4], v[8]);
+    Vector3 up(v[1], v[5], v[9]);
+    
+    const float corners[4][2] = { {-1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 1.0f} };
+    
+    batch.quads.resize(batch.instances.size() * 4);
+    QuadVertex* out = batch.quads.data();
+    for (const Instance& instance : batch.instances) {
+        for (const auto& corner : corners) {
+            Vector3 offset = (right * corner[0] + up * corner[1]) * instance.size;
+            out->position[0] = instance.center[0] + offset.x;
+            out->position[1] = instance.center[1] + offset.y;
+            out->position[2] = instance.center[2] + offset.z;
+            out->texCoord[0] = corner[0] * 0.5f + 0.5f;
+            out->texCoord[1] = corner[1] * 0.5f + 0.5f;
+            std::copy(instance.color, instance.color + 4, out->color);
+            out++;
+        }
+    }
+}
+
+void CloudRenderer::drawQuads(const ViewBatch& batch, GLStateCache& state) {
+    state.useProgram(0);
+    state.enable(GL_TEXTURE_2D);
+    
+    // Vertices come from client memory
+    state.bindBuffer(GL_ARRAY_BUFFER, 0);
+    state.enableClientState(GL_VERTEX_ARRAY);
+    state.enableClientState(GL_COLOR_ARRAY);
+    state.enableClientState(GL_TEXTURE_COORD_ARRAY);
+    state.disableClientState(GL_NORMAL_ARRAY);
+    
+    glVertexPointer(3, GL_FLOAT, sizeof(QuadVertex), batch.quads[0].position);
+    glTexCoordPointer(2, GL_FLOAT, sizeof(QuadVertex), batch.quads[0].texCoord);
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(QuadVertex), batch.quads[0].color);
+    glDrawArrays(GL_QUADS, 0, (GLsizei)batch.quads.size());
+}
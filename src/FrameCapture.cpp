@@ -0,0 +1,368 @@
+#include "FrameCapture.h"
+#include "GLStateCache.h"
+#include "GLExtensions.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    // PNG chunk checksums
+    uint32_t crc32(uint32_t crc, const uint8_t* data, size_t length) {
+        static uint32_t table[256];
+        static bool tableReady = false;
+        if (!tableReady) {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                table[i] = c;
+            }
+            tableReady = true;
+        }
+        
+        crc = ~crc;
+        for (size_t i = 0; i < length; i++) {
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+    
+    void appendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+        out.push_back((uint8_t)(value >> 24));
+        out.push_back((uint8_t)(value >> 16));
+        out.push_back((uint8_t)(value >> 8));
+        out.push_back((uint8_t)value);
+    }
+    
+    void appendChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+        appendBigEndian(out, (uint32_t)data.size());
+        size_t typeStart = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        appendBigEndian(out, crc32(0, &out[typeStart], out.size() - typeStart));
+    }
+    
+    // Full-range BT.601, as the C420jpeg tag declares
+    uint8_t lumaOf(int r, int g, int b) {
+        return (uint8_t)((77 * r + 150 * g + 29 * b + 128) >> 8);
+    }
+    
+    uint8_t chromaBlueOf(int r, int g, int b) {
+        return (uint8_t)std::max(0, std::min(255, ((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128));
+    }
+    
+    uint8_t chromaRedOf(int r, int g, int b) {
+        return (uint8_t)std::max(0, std::min(255, ((128 * r - 107 * g - 21 * b + 128) >> 8) + 128));
+    }
+}
+
+FrameCapture::Format FrameCapture::formatForPath(const std::string& path) {
+    size_t dot = path.find_last_of('.');
+    std::string extension = (dot == std::string::npos) ? "" : path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    
+    if (extension == "y4m") return Format::Y4M;
+    if (extension == "png") return Format::PNG;
+    return Format::RAW;
+}
+
+FrameCapture::FrameCapture() {
+}
+
+FrameCapture::~FrameCapture() {
+    stop();
+}
+
+bool FrameCapture::start(const std::string& outputPath, int captureWidth, int captureHeight, int framesPerSecond,
+                         GLStateCache& cache) {
+    stop();
+    
+    state = &cache;
+    path = outputPath;
+    format = formatForPath(path);
+    width = captureWidth;
+    height = captureHeight;
+    fps = std::max(1, framesPerSecond);
+    
+    if (format != Format::PNG) {
+        stream.open(path, std::ios::binary);
+        if (!stream) {
+            std::cerr << "Failed to open capture output " << path << std::endl;
+            return false;
+        }
+        if (format == Format::Y4M) {
+            stream << "YUV4MPEG2 W" << width << " H" << height << " F" << fps << ":1 Ip A1:1 C420jpeg\n";
+        }
+    }
+    
+    // Room for an RGBA frame in each ring slot
+    size_t frameBytes = (size_t)width * height * 4;
+    glGenBuffers(kRingSize, pixelBuffers);
+    for (unsigned int buffer : pixelBuffers) {
+        state->bindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, nullptr, GL_STREAM_READ);
+    }
+    state->bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    
+    framesIssued = 0;
+    framesCollected = 0;
+    stopping = false;
+    writer = std::thread(&FrameCapture::writerLoop, this);
+    active = true;
+    
+    std::cout << "Capturing " << width << "x" << height << " at " << fps << " fps to " << path << std::endl;
+    return true;
+}
+
+void FrameCapture::captureFrame() {
+    if (!active) return;
+    
+    // The slot's previous readback was issued kRingSize frames ago and is
+    // normally complete by now, so mapping it does not stall
+    int slot = framesIssued % kRingSize;
+    if (framesIssued - framesCollected == kRingSize) {
+        collect(slot);
+    }
+    
+    state->bindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    state->bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    framesIssued++;
+}
+
+void FrameCapture::collect(int slot) {
+    std::vector<uint8_t> frame;
+    {
+        // Wait for the writer if it is a full queue behind
+        std::unique_lock<std::mutex> lock(queueMutex);
+        queueChanged.wait(lock, [this] { return queuedFrames.size() < kMaxQueuedFrames; });
+        if (!freeFrames.empty()) {
+            frame.swap(freeFrames.back());
+            freeFrames.pop_back();
+        }
+    }
+    frame.resize((size_t)width * height * 4);
+    
+    state->bindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+    const void* pixels = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+    if (pixels) {
+        std::memcpy(frame.data(), pixels, frame.size());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    state->bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    framesCollected++;
+    
+    if (!pixels) {
+        std::cerr << "Capture: failed to map frame " << framesCollected - 1 << std::endl;
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queuedFrames.push_back(std::move(frame));
+    }
+    queueChanged.notify_all();
+}
+
+void FrameCapture::stop() {
+    if (!active) return;
+    
+    // Frames still in the ring, oldest first
+    while (framesCollected < framesIssued) {
+        collect(framesCollected % kRingSize);
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueChanged.notify_all();
+    writer.join();
+    
+    for (unsigned int& buffer : pixelBuffers) {
+        state->deleteBuffer(buffer);
+        buffer = 0;
+    }
+    
+    stream.close();
+    queuedFrames.clear();
+    freeFrames.clear();
+    active = false;
+    
+    std::cout << "Capture finished: " << framesCollected << " frames" << std::endl;
+}
+
+void FrameCapture::writerLoop() {
+    int frameIndex = 0;
+    while (true) {
+        std::vector<uint8_t> frame;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueChanged.wait(lock, [this] { return stopping || !queuedFrames.empty(); });
+            if (queuedFrames.empty()) return;   // Stopping and drained
+            
+            frame.swap(queuedFrames.front());
+            queuedFrames.pop_front();
+        }
+        queueChanged.notify_all();
+        
+        writeFrame(frame, frameIndex++);
+        
+        std::lock_guard<std::mutex> lock(queueMutex);
+        freeFrames.push_back(std::move(frame));
+    }
+}
+
+void FrameCapture::writeFrame(const std::vector<uint8_t>& rgba, int frameIndex) {
+    switch (format) {
+        case Format::Y4M:
+            writeY4M(rgba);
+            break;
+        case Format::RAW:
+            writeRaw(rgba);
+            break;
+        case Format::PNG:
+            writePNG(rgba, frameIndex);
+            break;
+    }
+}
+
+void FrameCapture::writeY4M(const std::vector<uint8_t>& rgba) {
+    int chromaWidth = (width + 1) / 2;
+    int chromaHeight = (height + 1) / 2;
+    scratch.resize((size_t)width * height + 2 * (size_t)chromaWidth * chromaHeight);
+    
+    uint8_t* lumaPlane = scratch.data();
+    uint8_t* bluePlane = lumaPlane + (size_t)width * height;
+    uint8_t* redPlane = bluePlane + (size_t)chromaWidth * chromaHeight;
+    
+    // GL rows are bottom first
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = &rgba[(size_t)(height - 1 - y) * width * 4];
+        uint8_t* luma = lumaPlane + (size_t)y * width;
+        for (int x = 0; x < width; x++) {
+            luma[x] = lumaOf(row[x * 4], row[x * 4 + 1], row[x * 4 + 2]);
+        }
+    }
+    
+    // Chroma from the average of each 2x2 block
+    for (int cy = 0; cy < chromaHeight; cy++) {
+        for (int cx = 0; cx < chromaWidth; cx++) {
+            int r = 0, g = 0, b = 0, count = 0;
+            for (int dy = 0; dy < 2; dy++) {
+                int y = std::min(cy * 2 + dy, height - 1);
+                const uint8_t* row = &rgba[(size_t)(height - 1 - y) * width * 4];
+                for (int dx = 0; dx < 2; dx++) {
+                    int x = std::min(cx * 2 + dx, width - 1);
+                    r += row[x * 4];
+                    g += row[x * 4 + 1];
+                    b += row[x * 4 + 2];
+                    count++;
+                }
+            }
+            r /= count;
+            g /= count;
+            b /= count;
+            bluePlane[(size_t)cy * chromaWidth + cx] = chromaBlueOf(r, g, b);
+            redPlane[(size_t)cy * chromaWidth + cx] = chromaRedOf(r, g, b);
+        }
+    }
+    
+    stream << "FRAME\n";
+    stream.write(reinterpret_cast<const char*>(scratch.data()), scratch.size());
+}
+
+void FrameCapture::writeRaw(const std::vector<uint8_t>& rgba) {
+    scratch.resize((size_t)width * height * 3);
+    
+    for (int y = 0; y < height; y++) {
+        const uint8_t* in = &rgba[(size_t)(height - 1 - y) * width * 4];
+        uint8_t* out = &scratch[(size_t)y * width * 3];
+        for (int x = 0; x < width; x++) {
+            out[x * 3] = in[x * 4];
+            out[x * 3 + 1] = in[x * 4 + 1];
+            out[x * 3 + 2] = in[x * 4 + 2];
+        }
+    }
+    
+    stream.write(reinterpret_cast<const char*>(scratch.data()), scratch.size());
+}
+
+void FrameCapture::writePNG(const std::vector<uint8_t>& rgba, int frameIndex) {
+    // Scanlines with filter type 0, wrapped in stored (uncompressed) deflate
+    // blocks: bigger files, but no zlib dependency and no encoding cost
+    size_t rowBytes = (size_t)width * 3 + 1;
+    std::vector<uint8_t> raw(rowBytes * height);
+    for (int y = 0; y < height; y++) {
+        const uint8_t* in = &rgba[(size_t)(height - 1 - y) * width * 4];
+        uint8_t* out = &raw[y * rowBytes];
+        out[0] = 0;
+        for (int x = 0; x < width; x++) {
+            out[1 + x * 3] = in[x * 4];
+            out[2 + x * 3] = in[x * 4 + 1];
+            out[3 + x * 3] = in[x * 4 + 2];
+        }
+    }
+    
+    std::vector<uint8_t> deflate = { 0x78, 0x01 };
+    uint32_t adlerA = 1, adlerB = 0;
+    size_t offset = 0;
+    bool last = false;
+    while (!last) {
+        size_t blockSize = std::min<size_t>(65535, raw.size() - offset);
+        last = (offset + blockSize == raw.size());
+        deflate.push_back(last ? 1 : 0);
+        deflate.push_back((uint8_t)blockSize);
+        deflate.push_back((uint8_t)(blockSize >> 8));
+        deflate.push_back((uint8_t)~blockSize);
+        deflate.push_back((uint8_t)(~blockSize >> 8));
+        deflate.insert(deflate.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+        
+        for (size_t i = offset; i < offset + blockSize; i++) {
+            adlerA = (adlerA + raw[i]) % 65521;
+            adlerB = (adlerB + adlerA) % 65521;
+        }
+        offset += blockSize;
+    }
+    appendBigEndian(deflate, (adlerB << 16) | adlerA);
+    
+    std::vector<uint8_t> header;
+    appendBigEndian(header, (uint32_t)width);
+    appendBigEndian(header, (uint32_t)height);
+    header.push_back(8);    // Bit depth
+    header.push_back(2);    // RGB
+    header.push_back(0);    // Deflate
+    header.push_back(0);    // Adaptive filtering
+    header.push_back(0);    // No interlace
+    
+    scratch = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    appendChunk(scratch, "IHDR", header);
+    appendChunk(scratch, "IDAT", deflate);
+    appendChunk(scratch, "IEND", {});
+    
+    std::string filePath = framePath(frameIndex);
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file) {
+        std::cerr << "Capture: failed to write " << filePath << std::endl;
+        return;
+    }
+    file.write(reinterpret_cast<const char*>(scratch.data()), scratch.size());
+}
+
+std::string FrameCapture::framePath(int frameIndex) const {
+    char buffer[512];
+    if (path.find('%') != std::string::npos) {
+        snprintf(buffer, sizeof(buffer), path.c_str(), frameIndex);
+        return buffer;
+    }
+    
+    size_t dot = path.find_last_of('.');
+    std::string stem = (dot == std::string::npos) ? path : path.substr(0, dot);
+    std::string extension = (dot == std::string::npos) ? "" : path.substr(dot);
+    snprintf(buffer, sizeof(buffer), "_%05d", frameIndex);
+    return stem + buffer + extension;
+}
@@ -0,0 +1,57 @@
+#include "Frustum.h"
+#include <cmath>
+
+Frustum::Frustum() {
+    // Accept everything until a matrix is provided
+    for (auto& plane : planes) {
+        plane.normal = Vector3(0, 0, 0);
+        plane.distance = 1.0f;
+    }
+}
+
+void Frustum::extract(const Matrix4& viewProjection) {
+    const float* m = viewProjection.m;
+    
+    // Gribb-Hartmann: planes are sums/differences of the clip matrix rows
+    auto row = [m](int i, float sign, Plane& plane) {
+        plane.normal = Vector3(m[3] + sign * m[i], m[7] + sign * m[4 + i], m[11] + sign * m[8 + i]);
+        plane.distance = m[15] + sign * m[12 + i];
+        
+        float len = plane.normal.length();
+        if (len > 0.0f) {
+            plane.normal = plane.normal * (1.0f / len);
+            plane.distance /= len;
+        }
+    };
+    
+    row(0, 1.0f, planes[0]);    // Left
+    row(0, -1.0f, planes[1]);   // Right
+    row(1, 1.0f, planes[2]);    // Bottom
+    row(1, -1.0f, planes[3]);   // Top
+    row(2, 1.0f, planes[4]);    // Near
+    row(2, -1.0f, planes[5]);   // Far
+}
+
+bool Frustum::intersects(const AABB& box) const {
+    for (const auto& plane : planes) {
+        // Corner furthest along the plane normal
+        Vector3 corner(
+            plane.normal.x >= 0.0f ? box.max.x : box.min.x,
+            plane.normal.y >= 0.0f ? box.max.y : box.min.y,
+            plane.normal.z >= 0.0f ? box.max.z : box.min.z
+        );
+        if (Vector3::dot(plane.normal, corner) + plane.distance < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::intersectsSphere(const Vector3& center, float radius) const {
+    for (const auto& plane : planes) {
+        if (Vector3::dot(plane.normal, center) + plane.distance < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
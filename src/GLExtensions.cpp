@@ -0,0 +1,112 @@
+#include "GLExtensions.h"
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace GLExt {
+    bool hasBaseVertex = false;
+    MultiDrawElementsBaseVertexProc MultiDrawElementsBaseVertex = nullptr;
+    
+    bool hasUniformBuffer = false;
+    GetUniformBlockIndexProc GetUniformBlockIndex = nullptr;
+    UniformBlockBindingProc UniformBlockBinding = nullptr;
+    BindBufferBaseProc BindBufferBase = nullptr;
+    
+    bool hasInstancing = false;
+    DrawArraysInstancedProc DrawArraysInstanced = nullptr;
+    DrawElementsInstancedProc DrawElementsInstanced = nullptr;
+    VertexAttribDivisorProc VertexAttribDivisor = nullptr;
+    
+    bool hasBufferStorage = false;
+    BufferStorageProc BufferStorage = nullptr;
+    MapBufferRangeProc MapBufferRange = nullptr;
+    FenceSyncProc FenceSync = nullptr;
+    ClientWaitSyncProc ClientWaitSync = nullptr;
+    DeleteSyncProc DeleteSync = nullptr;
+    
+    bool hasCopyBuffer = false;
+    CopyBufferSubDataProc CopyBufferSubData = nullptr;
+    
+    bool hasFramebuffer = false;
+    
+    bool hasShaders = false;
+    bool hasGLSL330 = false;
+    
+    int glVersion = 0;
+    
+    bool hasExtension(const char* name) {
+        const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+        if (!extensions) return false;
+        
+        // Match whole names only (GL_ARB_foo must not match GL_ARB_foo_bar)
+        size_t length = std::strlen(name);
+        const char* pos = extensions;
+        while ((pos = std::strstr(pos, name)) != nullptr) {
+            bool startOk = (pos == extensions || pos[-1] == ' ');
+            bool endOk = (pos[length] == ' ' || pos[length] == '\0');
+            if (startOk && endOk) return true;
+            pos += length;
+        }
+        return false;
+    }
+    
+    void load() {
+        int major = 0;
+        int minor = 0;
+        const char* version = (const char*)glGetString(GL_VERSION);
+        if (version) {
+            std::sscanf(version, "%d.%d", &major, &minor);
+        }
+        glVersion = major * 10 + minor;
+        
+        if (glVersion >= 32 || hasExtension("GL_ARB_draw_elements_base_vertex")) {
+            MultiDrawElementsBaseVertex = (MultiDrawElementsBaseVertexProc)
+                SDL_GL_GetProcAddress("glMultiDrawElementsBaseVertex");
+        }
+        hasBaseVertex = (MultiDrawElementsBaseVertex != nullptr);
+        
+        if (glVersion >= 31 || hasExtension("GL_ARB_uniform_buffer_object")) {
+            GetUniformBlockIndex = (GetUniformBlockIndexProc)SDL_GL_GetProcAddress("glGetUniformBlockIndex");
+            UniformBlockBinding = (UniformBlockBindingProc)SDL_GL_GetProcAddress("glUniformBlockBinding");
+            BindBufferBase = (BindBufferBaseProc)SDL_GL_GetProcAddress("glBindBufferBase");
+        }
+        hasUniformBuffer = GetUniformBlockIndex && UniformBlockBinding && BindBufferBase;
+        
+        // Instanced shaders are written in GLSL 3.30, so only a 3.3 context is useful
+        if (glVersion >= 33) {
+            DrawArraysInstanced = (DrawArraysInstancedProc)SDL_GL_GetProcAddress("glDrawArraysInstanced");
+            DrawElementsInstanced = (DrawElementsInstancedProc)SDL_GL_GetProcAddress("glDrawElementsInstanced");
+            VertexAttribDivisor = (VertexAttribDivisorProc)SDL_GL_GetProcAddress("glVertexAttribDivisor");
+        }
+        hasInstancing = DrawArraysInstanced && DrawElementsInstanced && VertexAttribDivisor;
+        
+        if (glVersion >= 44 || hasExtension("GL_ARB_buffer_storage")) {
+            BufferStorage = (BufferStorageProc)SDL_GL_GetProcAddress("glBufferStorage");
+        }
+        if (glVersion >= 32 || hasExtension("GL_ARB_sync")) {
+            FenceSync = (FenceSyncProc)SDL_GL_GetProcAddress("glFenceSync");
+            ClientWaitSync = (ClientWaitSyncProc)SDL_GL_GetProcAddress("glClientWaitSync");
+            DeleteSync = (DeleteSyncProc)SDL_GL_GetProcAddress("glDeleteSync");
+        }
+        if (glVersion >= 30 || hasExtension("GL_ARB_map_buffer_range")) {
+            MapBufferRange = (MapBufferRangeProc)SDL_GL_GetProcAddress("glMapBufferRange");
+        }
+        hasBufferStorage = BufferStorage && MapBufferRange && FenceSync && ClientWaitSync && DeleteSync;
+        
+        if (glVersion >= 31 || hasExtension("GL_ARB_copy_buffer")) {
+            CopyBufferSubData = (CopyBufferSubDataProc)SDL_GL_GetProcAddress("glCopyBufferSubData");
+        }
+        hasCopyBuffer = (CopyBufferSubData != nullptr);
+        
+        hasFramebuffer = (glVersion >= 30 || hasExtension("GL_ARB_framebuffer_object"));
+        hasShaders = (glVersion >= 20);
+        hasGLSL330 = (glVersion >= 33);
+        
+        std::cout << "OpenGL " << (version ? version : "unknown")
+                  << (hasBaseVertex ? " (multi-draw base vertex)" : "")
+                  << (hasUniformBuffer ? " (uniform buffers)" : "")
+                  << (hasInstancing ? " (instancing)" : "")
+                  << (hasBufferStorage ? " (buffer storage)" : "") << std::endl;
+    }
+}
@@ -0,0 +1,164 @@
+#include "GLStateCache.h"
+#include "GLExtensions.h"
+
+GLStateCache::GLStateCache() {
+    // The handful of caps and arrays the renderer uses; others are added on first use
+    const unsigned int knownCaps[] = {
+        GL_LIGHTING, GL_DEPTH_TEST, GL_BLEND, GL_NORMALIZE, GL_CULL_FACE,
+        GL_TEXTURE_2D, GL_FOG, GL_COLOR_MATERIAL, GL_LIGHT0, GL_MULTISAMPLE
+    };
+    for (unsigned int cap : knownCaps) {
+        caps.push_back({cap, -1});
+    }
+    
+    const unsigned int knownArrays[] = {
+        GL_VERTEX_ARRAY, GL_NORMAL_ARRAY, GL_COLOR_ARRAY, GL_TEXTURE_COORD_ARRAY
+    };
+    for (unsigned int array : knownArrays) {
+        clientStates.push_back({array, -1});
+    }
+    
+    const unsigned int knownTargets[] = {
+        GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_PIXEL_PACK_BUFFER, GL_PIXEL_UNPACK_BUFFER
+    };
+    for (unsigned int target : knownTargets) {
+        buffers.push_back({target, 0, false});
+    }
+}
+
+void GLStateCache::reset() {
+    for (Flag& flag : caps) flag.value = -1;
+    for (Flag& flag : clientStates) flag.value = -1;
+    for (Binding& binding : buffers) binding.known = false;
+    
+    // Nothing but the renderer binds programs, and asking for program 0 must
+    // not reach glUseProgram on contexts without GLSL
+    program = 0;
+    programKnown = true;
+    blendKnown = false;
+    matrixModeKnown = false;
+    depthWriteKnown = false;
+}
+
+GLStateCache::Flag& GLStateCache::findFlag(std::vector<Flag>& flags, unsigned int name) {
+    for (Flag& flag : flags) {
+        if (flag.name == name) return flag;
+    }
+    flags.push_back({name, -1});
+    return flags.back();
+}
+
+bool GLStateCache::changed(bool isDifferent) {
+    if (isDifferent) {
+        issued++;
+    } else {
+        filtered++;
+    }
+    return isDifferent;
+}
+
+void GLStateCache::setEnabled(unsigned int cap, bool enabled) {
+    Flag& flag = findFlag(caps, cap);
+    if (!changed(flag.value != (int)enabled)) return;
+    
+    flag.value = enabled ? 1 : 0;
+    if (enabled) {
+        glEnable(cap);
+    } else {
+        glDisable(cap);
+    }
+}
+
+void GLStateCache::setClientState(unsigned int array, bool enabled) {
+    Flag& flag = findFlag(clientStates, array);
+    if (!changed(flag.value != (int)enabled)) return;
+    
+    flag.value = enabled ? 1 : 0;
+    if (enabled) {
+        glEnableClientState(array);
+    } else {
+        glDisableClientState(array);
+    }
+}
+
+void GLStateCache::bindBuffer(unsigned int target, unsigned int buffer) {
+    Binding* binding = nullptr;
+    for (Binding& b : buffers) {
+        if (b.target == target) {
+            binding = &b;
+            break;
+        }
+    }
+    if (!binding) {
+        buffers.push_back({target, 0, false});
+        binding = &buffers.back();
+    }
+    
+    if (!changed(!binding->known || binding->buffer != buffer)) return;
+    
+    binding->buffer = buffer;
+    binding->known = true;
+    glBindBuffer(target, buffer);
+}
+
+void GLStateCache::deleteBuffer(unsigned int buffer) {
+    if (buffer == 0) return;
+    
+    // Deleting a bound buffer reverts that binding to zero
+    for (Binding& binding : buffers) {
+        if (binding.known && binding.buffer == buffer) {
+            binding.buffer = 0;
+        }
+    }
+    glDeleteBuffers(1, &buffer);
+}
+
+void GLStateCache::useProgram(unsigned int newProgram) {
+    if (!changed(!programKnown || program != newProgram)) return;
+    
+    program = newProgram;
+    programKnown = true;
+    glUseProgram(newProgram);
+}
+
+void GLStateCache::blendFunc(unsigned int source, unsigned int destination) {
+    blendFuncSeparate(source, destination, source, destination);
+}
+
+void GLStateCache::blendFuncSeparate(unsigned int sourceRGB, unsigned int destinationRGB,
+                                     unsigned int sourceAlpha, unsigned int destinationAlpha) {
+    if (!changed(!blendKnown || blendSource != sourceRGB || blendDestination != destinationRGB ||
+                 blendSourceAlpha != sourceAlpha || blendDestinationAlpha != destinationAlpha)) return;
+    
+    blendSource = sourceRGB;
+    blendDestination = destinationRGB;
+    blendSourceAlpha = sourceAlpha;
+    blendDestinationAlpha = destinationAlpha;
+    blendKnown = true;
+    if (sourceRGB == sourceAlpha && destinationRGB == destinationAlpha) {
+        glBlendFunc(sourceRGB, destinationRGB);
+    } else {
+        glBlendFuncSeparate(sourceRGB, destinationRGB, sourceAlpha, destinationAlpha);
+    }
+}
+
+void GLStateCache::matrixMode(unsigned int mode) {
+    if (!changed(!matrixModeKnown || currentMatrixMode != mode)) return;
+    
+    currentMatrixMode = mode;
+    matrixModeKnown = true;
+    glMatrixMode(mode);
+}
+
+void GLStateCache::depthMask(bool write) {
+    if (!changed(!depthWriteKnown || depthWrite != write)) return;
+    
+    depthWrite = write;
+    depthWriteKnown = true;
+    glDepthMask(write ? GL_TRUE : GL_FALSE);
+}
+
+void GLStateCache::resetCounters() {
+    issued = 0;
+    filtered = 0;
+}
@@ -10,18 +10,19 @@
 #include "LoadingScreen.h"
 #include "Camera.h"
 #include "Physics.h"
+#include "Traffic.h"
+#include "ParticleSystem.h"
 
+#include <algorithm>
+#include <cmath>
+#include <fstream>
 #include <iostream>
+#include <vector>
 #include <thread>
 #include <chrono>
+#include <ctime>
 
-#ifdef __APPLE__
-#include <OpenGL/gl.h>
-#include <OpenGL/glu.h>
-#else
-#include <GL/gl.h>
-#include <GL/glu.h>
-#endif
+#include "GLHeaders.h"
 
 Game::Game() {
 }
@@ -30,16 +31,35 @@ Game::~Game() {
     shutdown();
 }
 
-bool Game::initialize() {
+bool Game::initialize(const GameOptions& gameOptions) {
+    options = gameOptions;
+    showTowerView = options.towerView;
+    
     // Initialize SDL
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_GAMECONTROLLER | SDL_INIT_HAPTIC) < 0) {
+    if (options.headless) {
+        // SDL's offscreen driver creates an EGL context without a display;
+        // fall back to the default driver (e.g. under Xvfb) if it is missing
+        windowWidth = options.width;
+        windowHeight = options.height;
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, "offscreen");
+        if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+            std::cerr << "Offscreen video driver unavailable (" << SDL_GetError() << "), trying default" << std::endl;
+            SDL_SetHint(SDL_HINT_VIDEODRIVER, "");
+            if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+                std::cerr << "SDL initialization failed: " << SDL_GetError() << std::endl;
+                return false;
+            }
+        }
+    } else if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_GAMECONTROLLER | SDL_INIT_HAPTIC) < 0) {
         std::cerr << "SDL initialization failed: " << SDL_GetError() << std::endl;
         return false;
     }
     
-    // Set OpenGL attributes
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+    // Set OpenGL attributes. Ask for 3.3 so the renderer can use GLSL 3.30 and
+    // uniform buffers; the compatibility profile keeps the immediate-mode UI paths working.
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_COMPATIBILITY);
     SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
     SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
     SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
@@ -52,7 +72,8 @@ bool Game::initialize() {
         SDL_WINDOWPOS_CENTERED,
         windowWidth,
         windowHeight,
-        SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE
+        options.headless ? (SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN)
+                         : (SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE)
     );
     
     if (!window) {
@@ -64,28 +85,45 @@ bool Game::initialize() {
     
     // Create OpenGL context
     glContext = SDL_GL_CreateContext(window);
+    if (!glContext) {
+        // Drivers without a 3.3 compatibility profile (e.g. macOS) still give us 2.1
+        std::cerr << "OpenGL 3.3 context unavailable (" << SDL_GetError() << "), falling back to 2.1" << std::endl;
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, 0);
+        glContext = SDL_GL_CreateContext(window);
+    }
     if (!glContext) {
         std::cerr << "OpenGL context creation failed: " << SDL_GetError() << std::endl;
         return false;
     }
     
     // Enable VSync
-    SDL_GL_SetSwapInterval(1);
+    SDL_GL_SetSwapInterval(options.headless ? 0 : 1);
     
     // Initialize subsystems
-    renderer = std::make_unique<Renderer>();
+    renderer = std::make_unique<Renderer>(options.renderThreads);
     if (!renderer->initialize(window, windowWidth, windowHeight)) {
         std::cerr << "Renderer initialization failed!" << std::endl;
         return false;
     }
     
+    if (options.headless && !renderer->createOffscreenTarget(windowWidth, windowHeight)) {
+        std::cerr << "Offscreen render target creation failed!" << std::endl;
+        return false;
+    }
+    
+    if (!options.capturePath.empty() && !renderer->startCapture(options.capturePath, options.captureFps)) {
+        std::cerr << "Warning: Frame capture could not start, continuing without it" << std::endl;
+    }
     
     std::cout << "Initializing settings manager..." << std::endl;
     settingsManager = std::make_unique<SettingsManager>();
     settingsManager->loadSettings("settings.cfg");
     
+    // Headless runs stay silent; the audio manager works without a device
     audioManager = std::make_unique<AudioManager>();
-    if (!audioManager->initialize()) {
+    if (!options.headless && !audioManager->initialize()) {
         std::cerr << "Warning: Audio initialization failed, continuing without sound" << std::endl;
     }
     
@@ -106,6 +144,10 @@ bool Game::initialize() {
     
     sky = std::make_unique<Sky>();
     sky->setTimeOfDay(12.0f);
+    sky->setDaySpeed(options.daySpeed);
+    if (!sky->loadAtmosphere("atmosphere.lut")) {
+        std::cerr << "Warning: Atmosphere tables unavailable, using a simple sky" << std::endl;
+    }
     
     loadingScreen = std::make_unique<LoadingScreen>();
     
@@ -113,9 +155,20 @@ bool Game::initialize() {
     camera->setMode(CameraMode::CHASE);
     
     physics = std::make_unique<Physics>();
+    particles = std::make_unique<ParticleSystem>();
+    physics->setParticleSystem(particles.get());
     
     // Create default aircraft
     selectAircraft(AircraftType::BOEING_737);
+    if (options.splitScreen) {
+        setSplitScreen(true);
+    }
+    
+    traffic = std::make_unique<Traffic>();
+    if (options.traffic > 0) {
+        traffic->spawn(options.traffic, currentAircraft->getPosition());
+        std::cout << "Traffic: " << options.traffic << " aircraft" << std::endl;
+    }
     
     isRunning = true;
     lastFrameTime = SDL_GetPerformanceCounter();
@@ -124,6 +177,11 @@ bool Game::initialize() {
 }
 
 void Game::run() {
+    if (options.headless) {
+        runHeadless();
+        return;
+    }
+    
     // Show main menu
     setState(GameState::MAIN_MENU);
     
@@ -149,11 +207,126 @@ void Game::run() {
     }
 }
 
+void Game::runHeadless() {
+    // Straight into flight: no menus, music or mouse capture
+    currentState = GameState::PLAYING;
+    
+    // Climbing under power, so the instruments change every frame
+    if (options.airborne && currentAircraft) {
+        currentAircraft->setPosition(Vector3(0.0f, 500.0f, -400.0f));
+        currentAircraft->setThrottle(0.8f);
+    }
+    
+    // Fixed timestep so runs are repeatable
+    const float frameTime = 1.0f / 60.0f;
+    double updateSeconds = 0.0;
+    double renderSeconds = 0.0;
+    double buildMilliseconds = 0.0;
+    double overlayMilliseconds = 0.0;
+    int overlayRedraws = 0;
+    double overlayRedrawMilliseconds = 0.0;
+    int terrainChunksRelit = 0;
+    double particleMilliseconds = 0.0;
+    double slowestFrame = 0.0;
+    double frequency = (double)SDL_GetPerformanceFrequency();
+    
+    std::cout << "Headless run: " << options.frames << " frames at "
+              << windowWidth << "x" << windowHeight << std::endl;
+    
+    for (int frame = 0; frame < options.frames && isRunning; frame++) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        processInput();
+        update(frameTime);
+        
+        Uint64 rendered = SDL_GetPerformanceCounter();
+        render();
+        glFinish();     // Count the GPU work, not just its submission
+        Uint64 end = SDL_GetPerformanceCounter();
+        
+        inputManager->clearMouseClicksThisFrame();
+        inputManager->clearKeyPressesThisFrame();
+        
+        updateSeconds += (rendered - start) / frequency;
+        renderSeconds += (end - rendered) / frequency;
+        buildMilliseconds += renderer->getStats().buildMilliseconds;
+        overlayMilliseconds += renderer->getStats().overlayMilliseconds;
+        overlayRedraws += renderer->getStats().overlayRedraws;
+        overlayRedrawMilliseconds += renderer->getStats().overlayRedrawMilliseconds;
+        terrainChunksRelit += renderer->getStats().terrainChunksRelit;
+        particleMilliseconds += particleSeconds * 1000.0;
+        slowestFrame = std::max(slowestFrame, (end - start) / frequency);
+    }
+    
+    int frames = std::max(1, options.frames);
+    double frameMs = (updateSeconds + renderSeconds) * 1000.0 / frames;
+    std::cout << "Frames: " << options.frames
+              << "  avg " << frameMs << " ms (" << (frameMs > 0.0 ? 1000.0 / frameMs : 0.0) << " fps)"
+              << "  update " << updateSeconds * 1000.0 / frames << " ms"
+              << "  render " << renderSeconds * 1000.0 / frames << " ms"
+              << "  slowest " << slowestFrame * 1000.0 << " ms" << std::endl;
+    std::cout << "Render list build: " << buildMilliseconds / frames << " ms on "
+              << renderer->getStats().buildThreads << " threads" << std::endl;
+    std::cout << "HUD and minimap: " << overlayMilliseconds / frames << " ms, "
+              << overlayRedraws << " cached redraws of "
+              << (overlayRedraws > 0 ? overlayRedrawMilliseconds / overlayRedraws : 0.0) << " ms" << std::endl;
+    if (currentAircraft) {
+        std::cout << "Player aircraft: " << currentAircraft->getAltitude() << " m, "
+                  << currentAircraft->getSpeed() * 3.6f << " km/h" << std::endl;
+    }
+    const RenderStats& stats = renderer->getStats();
+    std::cout << "Aircraft in the last frame: " << stats.aircraftFull << " full, " << stats.aircraftReduced
+              << " reduced, " << stats.aircraftImpostors << " impostors" << std::endl;
+    std::cout << "Particles: " << particleMilliseconds / frames << " ms, "
+              << particles->getLiveCount() << " live in the last frame" << std::endl;
+    std::cout << "Terrain chunks relit for the moving sun: " << terrainChunksRelit << std::endl;
+    
+    if (!options.outputPath.empty()) {
+        writeFrame(options.outputPath);
+    }
+}
+
+void Game::writeFrame(const std::string& path) {
+    std::vector<unsigned char> pixels;
+    if (!renderer->readPixels(pixels)) {
+        std::cerr << "Failed to read back frame" << std::endl;
+        return;
+    }
+    
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open " << path << " for writing" << std::endl;
+        return;
+    }
+    
+    // PPM stores rows top first; GL returns them bottom first
+    int width = renderer->getWidth();
+    int height = renderer->getHeight();
+    file << "P6\n" << width << " " << height << "\n255\n";
+    for (int y = height - 1; y >= 0; y--) {
+        file.write(reinterpret_cast<const char*>(&pixels[(size_t)y * width * 3]), width * 3);
+    }
+    
+    std::cout << "Wrote " << path << std::endl;
+}
+
+void Game::toggleCapture() {
+    if (renderer->isCapturing()) {
+        renderer->stopCapture();
+        return;
+    }
+    
+    // One video per recording, named after the time it started
+    char name[64];
+    std::time_t now = std::time(nullptr);
+    std::strftime(name, sizeof(name), "flight_%Y%m%d_%H%M%S.y4m", std::localtime(&now));
+    renderer->startCapture(name, options.captureFps);
+}
+
 void Game::shutdown() {
     std::cout << "Shutting down game..." << std::endl;
     
-    // Save settings
-    if (settingsManager) {
+    // Save settings; headless runs leave the user's file alone
+    if (settingsManager && !options.headless) {
         settingsManager->saveSettings("settings.cfg");
     }
     
@@ -205,6 +378,21 @@ void Game::processInput() {
                         SDL_SetWindowFullscreen(window, SDL_WINDOW_FULLSCREEN_DESKTOP);
                     }
                 }
+                if (event.key.keysym.sym == SDLK_F3) {
+                    // Toggle render statistics overlay
+                    showRenderStats = !showRenderStats;
+                }
+                if (event.key.keysym.sym == SDLK_F4) {
+                    // Toggle the tower picture-in-picture view
+                    showTowerView = !showTowerView;
+                }
+                if (event.key.keysym.sym == SDLK_F5) {
+                    // Toggle two-player split screen
+                    setSplitScreen(!wingmanAircraft);
+                }
+                if (event.key.keysym.sym == SDLK_F9) {
+                    toggleCapture();
+                }
                 break;
                 
             case SDL_CONTROLLERDEVICEADDED:
@@ -333,11 +521,38 @@ void Game::update(float deltaTime) {
             // Update camera
             camera->update(deltaTime, currentAircraft.get());
             
+            if (wingmanAircraft) {
+                updateWingman(deltaTime);
+            }
+            
             // Update sky
             sky->update(deltaTime);
             
-            // Update terrain with player position for infinite world generation
-            terrain->update(deltaTime, currentAircraft->getPosition());
+            traffic->update(deltaTime);
+            
+            // Exhaust and contrails from everything flying, then every particle moves
+            Uint64 particleStart = SDL_GetPerformanceCounter();
+            trailSources.clear();
+            if (currentAircraft) {
+                trailSources.push_back(currentAircraft.get());
+            }
+            if (wingmanAircraft) {
+                trailSources.push_back(wingmanAircraft.get());
+            }
+            traffic->appendAircraft(trailSources);
+            for (const Aircraft* aircraft : trailSources) {
+                particles->emitTrails(*aircraft, deltaTime);
+            }
+            particles->update(deltaTime);
+            particleSeconds = (double)(SDL_GetPerformanceCounter() - particleStart) / SDL_GetPerformanceFrequency();
+            
+            // Update terrain with player positions for infinite world generation
+            if (wingmanAircraft) {
+                Vector3 players[] = { currentAircraft->getPosition(), wingmanAircraft->getPosition() };
+                terrain->update(deltaTime, players, 2);
+            } else {
+                terrain->update(deltaTime, currentAircraft->getPosition());
+            }
             
             // Update audio
             audioManager->update(deltaTime);
@@ -350,6 +565,98 @@ void Game::update(float deltaTime) {
     }
 }
 
+void Game::updateWingman(float deltaTime) {
+    // Same controls as the first player, from the second controller only
+    float throttleAxis = inputManager->getPlayerAxis(1, InputAction::THROTTLE_UP) -
+                         inputManager->getPlayerAxis(1, InputAction::THROTTLE_DOWN);
+    wingmanAircraft->setThrottle(wingmanAircraft->getThrottle() + throttleAxis * deltaTime * 0.5f);
+    wingmanAircraft->setPitch(-inputManager->getPlayerAxis(1, InputAction::PITCH_UP));
+    wingmanAircraft->setRoll(inputManager->getPlayerAxis(1, InputAction::ROLL_LEFT));
+    wingmanAircraft->setYaw(inputManager->getPlayerAxis(1, InputAction::YAW_LEFT));
+    wingmanAircraft->setBrake(inputManager->isPlayerButtonDown(1, InputAction::BRAKE));
+    
+    if (inputManager->wasPlayerButtonPressedThisFrame(1, InputAction::LANDING_GEAR)) {
+        wingmanAircraft->toggleLandingGear();
+        audioManager->playSound(SoundEffect::LANDING_GEAR);
+    }
+    if (inputManager->wasPlayerButtonPressedThisFrame(1, InputAction::FLAPS_UP)) {
+        wingmanAircraft->adjustFlaps(1);
+        audioManager->playSound(SoundEffect::FLAPS);
+    }
+    if (inputManager->wasPlayerButtonPressedThisFrame(1, InputAction::FLAPS_DOWN)) {
+        wingmanAircraft->adjustFlaps(-1);
+        audioManager->playSound(SoundEffect::FLAPS);
+    }
+    if (inputManager->wasPlayerButtonPressedThisFrame(1, InputAction::CAMERA_TOGGLE)) {
+        wingmanCamera->cycleMode();
+    }
+    
+    physics->update(deltaTime, wingmanAircraft.get(), terrain.get());
+    wingmanAircraft->update(deltaTime);
+    wingmanCamera->update(deltaTime, wingmanAircraft.get());
+}
+
+void Game::setSplitScreen(bool enabled) {
+    if (!enabled) {
+        wingmanAircraft.reset();
+        wingmanCamera.reset();
+        std::cout << "Split screen off" << std::endl;
+        return;
+    }
+    
+    // Same type as the first player, parked beside it
+    wingmanAircraft = std::make_unique<Aircraft>(selectedAircraftType);
+    wingmanAircraft->reset();
+    wingmanAircraft->setPosition(wingmanAircraft->getPosition() + Vector3(60.0f, 0.0f, 0.0f));
+    
+    wingmanCamera = std::make_unique<Camera>();
+    wingmanCamera->setMode(CameraMode::CHASE);
+    
+    if (!inputManager->hasPlayerController(1)) {
+        std::cout << "Split screen: connect a second controller to fly player 2" << std::endl;
+    } else {
+        std::cout << "Split screen on" << std::endl;
+    }
+}
+
+RenderView Game::makeCameraView(const Camera& viewCamera, const Aircraft* hudAircraft) const {
+    RenderView view;
+    view.eye = viewCamera.getPosition();
+    view.target = viewCamera.getTarget();
+    view.up = viewCamera.getUp();
+    view.fov = viewCamera.getFOV();
+    view.nearPlane = viewCamera.getNearPlane();
+    // Nothing is visible through the fog, so the far plane stops at fog end
+    view.farPlane = std::min(viewCamera.getFarPlane(), sky->getFogEnd());
+    view.hudAircraft = hudAircraft;
+    return view;
+}
+
+RenderView Game::makeTowerView(const RenderView& mainView) const {
+    // Tower beside the middle of the runway, zoomed so the aircraft keeps
+    // roughly the same size on screen as it flies away
+    const Runway& runway = terrain->getRunway();
+    
+    RenderView view = mainView;
+    view.hudAircraft = nullptr;
+    view.eye = Vector3((runway.startX + runway.endX) * 0.5f, runway.height + 40.0f,
+                       (runway.startZ + runway.endZ) * 0.5f + runway.width * 0.5f + 150.0f);
+    view.target = currentAircraft->getPosition();
+    view.up = Vector3(0, 1, 0);
+    view.nearPlane = 1.0f;
+    
+    float distance = std::max((view.target - view.eye).length(), 1.0f);
+    float zoom = 2.0f * std::atan(60.0f / distance) * RAD_TO_DEG;
+    view.fov = std::max(4.0f, std::min(zoom, 60.0f));
+    
+    // Quarter size, centered at the top of the screen
+    view.width = windowWidth / 4;
+    view.height = windowHeight / 4;
+    view.x = (windowWidth - view.width) / 2;
+    view.y = 20;
+    return view;
+}
+
 void Game::render() {
     renderer->beginFrame();
     
@@ -370,33 +677,56 @@ void Game::render() {
             // Render 3D world
             if (camera && currentAircraft) {
                 // Setup camera
-                float aspect = (float)windowWidth / (float)windowHeight;
-                renderer->setProjectionMatrix(camera->getFOV(), aspect, 
-                                             camera->getNearPlane(), camera->getFarPlane());
-                renderer->setViewMatrix(camera->getPosition(), camera->getTarget(), camera->getUp());
+                RenderView mainView = makeCameraView(*camera, currentAircraft.get());
                 
-                // Render sky
-                renderer->renderSky(sky.get(), camera.get());
+                RenderScene scene;
+                scene.sky = sky.get();
+                scene.terrain = terrain.get();
+                scene.aircraft.push_back(currentAircraft.get());
                 
-                // Render terrain
-                renderer->renderTerrain(terrain.get(), camera.get());
+                if (wingmanAircraft) {
+                    // Side by side halves; both views share one culling pass
+                    // and the same resident terrain
+                    RenderView wingmanView = makeCameraView(*wingmanCamera, wingmanAircraft.get());
+                    mainView.width = windowWidth / 2;
+                    wingmanView.x = mainView.width;
+                    wingmanView.width = windowWidth - mainView.width;
+                    scene.aircraft.push_back(wingmanAircraft.get());
+                    scene.views.push_back(mainView);
+                    scene.views.push_back(wingmanView);
+                } else {
+                    scene.views.push_back(mainView);
+                }
                 
-                // Render aircraft
-                renderer->renderAircraft(currentAircraft.get(), camera.get());
+                if (showTowerView) {
+                    scene.views.push_back(makeTowerView(mainView));
+                }
+                traffic->appendAircraft(scene.aircraft);
+                scene.particles = particles.get();
+                scene.showHUD = settingsManager->isHUDEnabled();
+                scene.showMinimap = settingsManager->isMinimapEnabled();
+                renderer->renderScene(scene);
                 
-                // Render HUD
-                if (settingsManager->isHUDEnabled()) {
-                    renderer->renderHUD(currentAircraft.get());
+                if (wingmanAircraft) {
+                    renderer->renderRect(windowWidth / 2 - 1.0f, 0.0f, 2.0f, (float)windowHeight,
+                                         Color(0.0f, 0.0f, 0.0f, 1.0f));
+                }
+                if (showTowerView) {
+                    const RenderView& tower = scene.views.back();
+                    renderer->renderRect((float)tower.x, (float)tower.y, (float)tower.width, (float)tower.height,
+                                         Color(0.3f, 0.8f, 0.3f, 0.8f), false);
+                    renderer->renderText("TOWER", tower.x + 8.0f, tower.y + 8.0f, 1.0f, Color(0.3f, 0.8f, 0.3f, 1.0f));
                 }
                 
-                // Render minimap
-                if (settingsManager->isMinimapEnabled()) {
-                    renderer->renderMinimap(currentAircraft.get(), terrain.get());
+                // Render statistics overlay
+                if (showRenderStats) {
+                    renderer->renderStats(20.0f, 20.0f);
                 }
             }
             
-            // Render pause menu overlay
+            // Render pause menu overlay on top of the HUD
             if (currentState == GameState::PAUSED) {
+                renderer->flush2D();
                 menuSystem->render(renderer.get());
             }
             break;
@@ -501,6 +831,10 @@ void Game::selectAircraft(AircraftType type) {
     currentAircraft = std::make_unique<Aircraft>(type);
     currentAircraft->reset();
     
+    if (wingmanAircraft) {
+        setSplitScreen(true);
+    }
+    
     std::cout << "Selected aircraft: " << currentAircraft->getSpecs().name << std::endl;
     std::cout << "Ready to fly! Use WASD/Arrows for pitch/roll, Z/X for yaw, Q/E for throttle." << std::endl;
 }
@@ -0,0 +1,472 @@
+#include "GlyphCache.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+GlyphCache::GlyphCache() {
+    buildGlyphs();
+}
+
+void GlyphCache::buildGlyphs() {
+    // Outlines at scale 1 with the glyph's top-left corner at the origin
+    const float x = 0.0f;
+    const float y = 0.0f;
+    const float w = 8.0f;
+    const float h = 14.0f;
+    
+    for (int i = 0; i < kGlyphCount; i++) {
+        char c = (char)i;
+        std::vector<Point>& points = glyphs[i];
+        
+        auto line = [&](float x0, float y0, float x1, float y1) {
+            points.push_back({x0, y0});
+            points.push_back({x1, y1});
+        };
+        
+        // Define simple line-based characters
+        switch (c) {
+            case 'A': case 'a':
+                line(x, y + h, x + w/2, y);
+                line(x + w/2, y, x + w, y + h);
+                line(x + w*0.2f, y + h*0.6f, x + w*0.8f, y + h*0.6f);
+                break;
+            case 'B': case 'b':
+                line(x, y, x, y + h);
+                line(x, y, x + w*0.7f, y);
+                line(x + w*0.7f, y, x + w, y + h*0.2f);
+                line(x + w, y + h*0.2f, x + w*0.7f, y + h*0.5f);
+                line(x, y + h*0.5f, x + w*0.7f, y + h*0.5f);
+                line(x + w*0.7f, y + h*0.5f, x + w, y + h*0.8f);
+                line(x + w, y + h*0.8f, x + w*0.7f, y + h);
+                line(x, y + h, x + w*0.7f, y + h);
+                break;
+            case 'C': case 'c':
+                line(x + w, y + h*0.2f, x + w*0.5f, y);
+                line(x + w*0.5f, y, x, y + h*0.3f);
+                line(x, y + h*0.3f, x, y + h*0.7f);
+                line(x, y + h*0.7f, x + w*0.5f, y + h);
+                line(x + w*0.5f, y + h, x + w, y + h*0.8f);
+                break;
+            case 'D': case 'd':
+                line(x, y, x, y + h);
+                line(x, y, x + w*0.6f, y);
+                line(x + w*0.6f, y, x + w, y + h*0.3f);
+                line(x + w, y + h*0.3f, x + w, y + h*0.7f);
+                line(x + w, y + h*0.7f, x + w*0.6f, y + h);
+                line(x + w*0.6f, y + h, x, y + h);
+                break;
+            case 'E': case 'e':
+                line(x, y, x, y + h);
+                line(x, y, x + w, y);
+                line(x, y + h*0.5f, x + w*0.7f, y + h*0.5f);
+                line(x, y + h, x + w, y + h);
+                break;
+            case 'F': case 'f':
+                line(x, y, x, y + h);
+                line(x, y, x + w, y);
+                line(x, y + h*0.5f, x + w*0.7f, y + h*0.5f);
+                break;
+            case 'G': case 'g':
+                line(x + w, y + h*0.2f, x + w*0.5f, y);
+                line(x + w*0.5f, y, x, y + h*0.3f);
+                line(x, y + h*0.3f, x, y + h*0.7f);
+                line(x, y + h*0.7f, x + w*0.5f, y + h);
+                line(x + w*0.5f, y + h, x + w, y + h*0.7f);
+                line(x + w, y + h*0.7f, x + w, y + h*0.5f);
+                line(x + w, y + h*0.5f, x + w*0.5f, y + h*0.5f);
+                break;
+            case 'H': case 'h':
+                line(x, y, x, y + h);
+                line(x + w, y, x + w, y + h);
+                line(x, y + h*0.5f, x + w, y + h*0.5f);
+                break;
+            case 'I': case 'i':
+                line(x + w*0.3f, y, x + w*0.7f, y);
+                line(x + w*0.5f, y, x + w*0.5f, y + h);
+                line(x + w*0.3f, y + h, x + w*0.7f, y + h);
+                break;
+            case 'L': case 'l':
+                line(x, y, x, y + h);
+                line(x, y + h, x + w, y + h);
+                break;
+            case 'M': case 'm':
+                line(x, y + h, x, y);
+                line(x, y, x + w*0.5f, y + h*0.4f);
+                line(x + w*0.5f, y + h*0.4f, x + w, y);
+                line(x + w, y, x + w, y + h);
+                break;
+            case 'N': case 'n':
+                line(x, y + h, x, y);
+                line(x, y, x + w, y + h);
+                line(x + w, y + h, x + w, y);
+                break;
+            case 'O': case 'o':
+                line(x + w*0.3f, y, x + w*0.7f, y);
+                line(x + w*0.7f, y, x + w, y + h*0.3f);
+                line(x + w, y + h*0.3f, x + w, y + h*0.7f);
+                line(x + w, y + h*0.7f, x + w*0.7f, y + h);
+                line(x + w*0.7f, y + h, x + w*0.3f, y + h);
+                line(x + w*0.3f, y + h, x, y + h*0.7f);
+                line(x, y + h*0.7f, x, y + h*0.3f);
+                line(x, y + h*0.3f, x + w*0.3f, y);
+                break;
+            case 'P': case 'p':
+                line(x, y, x, y + h);
+                line(x, y, x + w*0.7f, y);
+                line(x + w*0.7f, y, x + w, y + h*0.15f);
+                line(x + w, y + h*0.15f, x + w, y + h*0.35f);
+                line(x + w, y + h*0.35f, x + w*0.7f, y + h*0.5f);
+                line(x + w*0.7f, y + h*0.5f, x, y + h*0.5f);
+                break;
+            case 'R': case 'r':
+                line(x, y, x, y + h);
+                line(x, y, x + w*0.7f, y);
+                line(x + w*0.7f, y, x + w, y + h*0.15f);
+                line(x + w, y + h*0.15f, x + w, y + h*0.35f);
+                line(x + w, y + h*0.35f, x + w*0.7f, y + h*0.5f);
+                line(x + w*0.7f, y + h*0.5f, x, y + h*0.5f);
+                line(x + w*0.5f, y + h*0.5f, x + w, y + h);
+                break;
+            case 'S': case 's':
+                line(x + w, y + h*0.15f, x + w*0.7f, y);
+                line(x + w*0.7f, y, x + w*0.3f, y);
+                line(x + w*0.3f, y, x, y + h*0.15f);
+                line(x, y + h*0.15f, x, y + h*0.35f);
+                line(x, y + h*0.35f, x + w*0.3f, y + h*0.5f);
+                line(x + w*0.3f, y + h*0.5f, x + w*0.7f, y + h*0.5f);
+                line(x + w*0.7f, y + h*0.5f, x + w, y + h*0.65f);
+                line(x + w, y + h*0.65f, x + w, y + h*0.85f);
+                line(x + w, y + h*0.85f, x + w*0.7f, y + h);
+                line(x + w*0.7f, y + h, x + w*0.3f, y + h);
+                line(x + w*0.3f, y + h, x, y + h*0.85f);
+                break;
+            case 'T': case 't':
+                line(x, y, x + w, y);
+                line(x + w*0.5f, y, x + w*0.5f, y + h);
+                break;
+            case 'U': case 'u':
+                line(x, y, x, y + h*0.7f);
+                line(x, y + h*0.7f, x + w*0.3f, y + h);
+                line(x + w*0.3f, y + h, x + w*0.7f, y + h);
+                line(x + w*0.7f, y + h, x + w, y + h*0.7f);
+                line(x + w, y + h*0.7f, x + w, y);
+                break;
+            case 'V': case 'v':
+                line(x, y, x + w*0.5f, y + h);
+                line(x + w*0.5f, y + h, x + w, y);
+                break;
+            case 'W': case 'w':
+                line(x, y, x + w*0.25f, y + h);
+                line(x + w*0.25f, y + h, x + w*0.5f, y + h*0.6f);
+                line(x + w*0.5f, y + h*0.6f, x + w*0.75f, y + h);
+                line(x + w*0.75f, y + h, x + w, y);
+                break;
+            case 'X': case 'x':
+                line(x, y, x + w, y + h);
+                line(x + w, y, x, y + h);
+                break;
+            case 'Y': case 'y':
+                line(x, y, x + w*0.5f, y + h*0.5f);
+                line(x + w, y, x + w*0.5f, y + h*0.5f);
+                line(x + w*0.5f, y + h*0.5f, x + w*0.5f, y + h);
+                break;
+            case 'Z': case 'z':
+                line(x, y, x + w, y);
+                line(x + w, y, x, y + h);
+                line(x, y + h, x + w, y + h);
+                break;
+            case '0':
+                line(x + w*0.3f, y, x + w*0.7f, y);
+                line(x + w*0.7f, y, x + w, y + h*0.2f);
+                line(x + w, y + h*0.2f, x + w, y + h*0.8f);
+                line(x + w, y + h*0.8f, x + w*0.7f, y + h);
+                line(x + w*0.7f, y + h, x + w*0.3f, y + h);
+                line(x + w*0.3f, y + h, x, y + h*0.8f);
+                line(x, y + h*0.8f, x, y + h*0.2f);
+                line(x, y + h*0.2f, x + w*0.3f, y);
+                break;
+            case '1':
+                line(x + w*0.3f, y + h*0.2f, x + w*0.5f, y);
+                line(x + w*0.5f, y, x + w*0.5f, y + h);
+                line(x + w*0.2f, y + h, x + w*0.8f, y + h);
+                break;
+            case '2':
+                line(x, y + h*0.2f, x + w*0.3f, y);
+                line(x + w*0.3f, y, x + w*0.7f, y);
+                line(x + w*0.7f, y, x + w, y + h*0.2f);
+                line(x + w, y + h*0.2f, x + w, y + h*0.4f);
+                line(x + w, y + h*0.4f, x, y + h);
+                line(x, y + h, x + w, y + h);
+                break;
+            case '3':
+                line(x, y + h*0.15f, x + w*0.3f, y);
+                line(x + w*0.3f, y, x + w*0.7f, y);
+                line(x + w*0.7f, y, x + w, y + h*0.15f);
+                line(x + w, y + h*0.15f, x + w, y + h*0.4f);
+                line(x + w, y + h*0.4f, x + w*0.5f, y + h*0.5f);
+                line(x + w*0.5f, y + h*0.5f, x + w, y + h*0.6f);
+                line(x + w, y + h*0.6f, x + w, y + h*0.85f);
+                line(x + w, y + h*0.85f, x + w*0.7f, y + h);
+                line(x + w*0.7f, y + h, x + w*0.3f, y + h);
+                line(x + w*0.3f, y + h, x, y + h*0.85f);
+                break;
+            case '4':
+                line(x + w*0.7f, y, x + w*0.7f, y + h);
+                line(x + w*0.7f, y, x, y + h*0.6f);
+                line(x, y + h*0.6f, x + w, y + h*0.6f);
+                break;
+            case '5':
+                line(x + w, y, x, y);
+                line(x, y, x, y + h*0.45f);
+                line(x, y + h*0.45f, x + w*0.7f, y + h*0.45f);
+                line(x + w*0.7f, y + h*0.45f, x + w, y + h*0.6f);
+                line(x + w, y + h*0.6f, x + w, y + h*0.85f);
+                line(x + w, y + h*0.85f, x + w*0.7f, y + h);
+                line(x + w*0.7f, y + h, x + w*0.3f, y + h);
+                line(x + w*0.3f, y + h, x, y + h*0.85f);
+                break;
+            case '6':
+                line(x + w*0.7f, y, x + w*0.3f, y);
+                line(x + w*0.3f, y, x, y + h*0.2f);
+                line(x, y + h*0.2f, x, y + h*0.8f);
+                line(x, y + h*0.8f, x + w*0.3f, y + h);
+                line(x + w*0.3f, y + h, x + w*0.7f, y + h);
+                line(x + w*0.7f, y + h, x + w, y + h*0.8f);
+                line(x + w, y + h*0.8f, x + w, y + h*0.6f);
+                line(x + w, y + h*0.6f, x + w*0.7f, y + h*0.5f);
+                line(x + w*0.7f, y + h*0.5f, x, y + h*0.5f);
+                break;
+            case '7':
+                line(x, y, x + w, y);
+                line(x + w, y, x + w*0.3f, y + h);
+                break;
+            case '8':
+                line(x + w*0.3f, y, x + w*0.7f, y);
+                line(x + w*0.7f, y, x + w, y + h*0.15f);
+                line(x + w, y + h*0.15f, x + w, y + h*0.35f);
+                line(x + w, y + h*0.35f, x + w*0.7f, y + h*0.5f);
+                line(x + w*0.7f, y + h*0.5f, x + w*0.3f, y + h*0.5f);
+                line(x + w*0.3f, y + h*0.5f, x, y + h*0.35f);
+                line(x, y + h*0.35f, x, y + h*0.15f);
+                line(x, y + h*0.15f, x + w*0.3f, y);
+                line(x + w*0.3f, y + h*0.5f, x, y + h*0.65f);
+                line(x, y + h*0.65f, x, y + h*0.85f);
+                line(x, y + h*0.85f, x + w*0.3f, y + h);
+                line(x + w*0.3f, y + h, x + w*0.7f, y + h);
+                line(x + w*0.7f, y + h, x + w, y + h*0.85f);
+                line(x + w, y + h*0.85f, x + w, y + h*0.65f);
+                line(x + w, y + h*0.65f, x + w*0.7f, y + h*0.5f);
+                break;
+            case '9':
+                line(x + w, y + h*0.5f, x + w*0.3f, y + h*0.5f);
+                line(x + w*0.3f, y + h*0.5f, x, y + h*0.35f);
+                line(x, y + h*0.35f, x, y + h*0.15f);
+                line(x, y + h*0.15f, x + w*0.3f, y);
+                line(x + w*0.3f, y, x + w*0.7f, y);
+                line(x + w*0.7f, y, x + w, y + h*0.15f);
+                line(x + w, y + h*0.15f, x + w, y + h*0.8f);
+                line(x + w, y + h*0.8f, x + w*0.7f, y + h);
+                line(x + w*0.7f, y + h, x + w*0.3f, y + h);
+                break;
+            case '.':
+                line(x + w*0.4f, y + h*0.9f, x + w*0.6f, y + h*0.9f);
+                line(x + w*0.6f, y + h*0.9f, x + w*0.6f, y + h);
+                line(x + w*0.6f, y + h, x + w*0.4f, y + h);
+                line(x + w*0.4f, y + h, x + w*0.4f, y + h*0.9f);
+                break;
+            case ':':
+                line(x + w*0.4f, y + h*0.25f, x + w*0.6f, y + h*0.25f);
+                line(x + w*0.6f, y + h*0.25f, x + w*0.6f, y + h*0.35f);
+                line(x + w*0.6f, y + h*0.35f, x + w*0.4f, y + h*0.35f);
+                line(x + w*0.4f, y + h*0.35f, x + w*0.4f, y + h*0.25f);
+                line(x + w*0.4f, y + h*0.65f, x + w*0.6f, y + h*0.65f);
+                line(x + w*0.6f, y + h*0.65f, x + w*0.6f, y + h*0.75f);
+                line(x + w*0.6f, y + h*0.75f, x + w*0.4f, y + h*0.75f);
+                line(x + w*0.4f, y + h*0.75f, x + w*0.4f, y + h*0.65f);
+                break;
+            case '-':
+                line(x + w*0.2f, y + h*0.5f, x + w*0.8f, y + h*0.5f);
+                break;
+            case '+':
+                line(x + w*0.2f, y + h*0.5f, x + w*0.8f, y + h*0.5f);
+                line(x + w*0.5f, y + h*0.25f, x + w*0.5f, y + h*0.75f);
+                break;
+            case '/':
+                line(x, y + h, x + w, y);
+                break;
+            case '%':
+                line(x, y + h, x + w, y);
+                line(x + w*0.2f, y + h*0.1f, x + w*0.3f, y + h*0.1f);
+                line(x + w*0.3f, y + h*0.1f, x + w*0.3f, y + h*0.25f);
+                line(x + w*0.3f, y + h*0.25f, x + w*0.2f, y + h*0.25f);
+                line(x + w*0.2f, y + h*0.25f, x + w*0.2f, y + h*0.1f);
+                line(x + w*0.7f, y + h*0.75f, x + w*0.8f, y + h*0.75f);
+                line(x + w*0.8f, y + h*0.75f, x + w*0.8f, y + h*0.9f);
+                line(x + w*0.8f, y + h*0.9f, x + w*0.7f, y + h*0.9f);
+                line(x + w*0.7f, y + h*0.9f, x + w*0.7f, y + h*0.75f);
+                break;
+            case ' ':
+                // Space - no lines
+                break;
+            default:
+                // Unknown character - draw a box
+                line(x, y, x + w, y);
+                line(x + w, y, x + w, y + h);
+                line(x + w, y + h, x, y + h);
+                line(x, y + h, x, y);
+                break;
+        }
+    }
+}
+
+size_t GlyphCache::LayoutKeyHash::operator()(const LayoutKey& key) const {
+    uint32_t scaleBits;
+    std::memcpy(&scaleBits, &key.scale, sizeof(scaleBits));
+    return std::hash<std::string>()(key.text) ^ (std::hash<uint32_t>()(scaleBits) * 31);
+}
+
+void GlyphCache::drawText(UIBatch& batch, const std::string& text, float x, float y, float scale, const Color& color) {
+    if (text.empty()) return;
+    
+    Layout& layout = findLayout(text, x, y, scale);
+    layout.lastUsedFrame = frame;
+    
+    if (layout.bakedX != x || layout.bakedY != y ||
+        layout.bakedColor.r != color.r || layout.bakedColor.g != color.g ||
+        layout.bakedColor.b != color.b || layout.bakedColor.a != color.a) {
+        layout.bakedPoints = 0;
+    }
+    if (layout.bakedPoints < layout.points.size()) {
+        bake(layout, x, y, color);
+    }
+    
+    batch.addLines(layout.vertices.data(), layout.vertices.size());
+}
+
+GlyphCache::Layout& GlyphCache::findLayout(const std::string& text, float x, float y, float scale) {
+    SlotKey slotKey{(int32_t)std::lround(x), (int32_t)std::lround(y)};
+    LayoutKey key{text, scale};
+    
+    auto it = layouts.find(key);
+    if (it != layouts.end()) {
+        hits++;
+        slots[slotKey] = &it->second;
+        return it->second;
+    }
+    
+    misses++;
+    
+    // Text drawn here last frame is usually the previous value of the same
+    // readout; retarget that layout so only the changed tail is rebuilt
+    auto slot = slots.find(slotKey);
+    if (slot != slots.end()) {
+        Layout* previous = slot->second;
+        if (previous->scale == scale && previous->lastUsedFrame != frame) {
+            auto node = layouts.extract(LayoutKey{previous->text, previous->scale});
+            node.key() = std::move(key);
+            layoutText(node.mapped(), text);
+            
+            Layout& layout = layouts.insert(std::move(node)).position->second;
+            slot->second = &layout;
+            return layout;
+        }
+    }
+    
+    Layout& layout = layouts.emplace(std::move(key), Layout()).first->second;
+    layout.scale = scale;
+    layoutText(layout, text);
+    slots[slotKey] = &layout;
+    return layout;
+}
+
+void GlyphCache::layoutText(Layout& layout, const std::string& text) const {
+    float charWidth = 10.0f * layout.scale;
+    float lineHeight = 16.0f * layout.scale * 1.2f;
+    
+    // Characters before the first difference keep their vertices
+    size_t start = 0;
+    size_t limit = std::min(text.size(), layout.text.size());
+    while (start < limit && text[start] == layout.text[start]) {
+        start++;
+    }
+    
+    if (start < layout.charOffsets.size()) {
+        layout.points.resize(layout.charOffsets[start]);
+        layout.charOffsets.resize(start);
+    }
+    layout.bakedPoints = std::min(layout.bakedPoints, layout.points.size());
+    
+    // A shorter text may need no new points, and so no bake, before it is
+    // drawn; the vertices of the dropped characters go now
+    if (layout.vertices.size() > layout.points.size()) {
+        layout.vertices.resize(layout.points.size());
+    }
+    layout.text = text;
+    
+    // Cursor position after the kept prefix
+    float cursorX = 0.0f;
+    float cursorY = 0.0f;
+    for (size_t i = 0; i < start; i++) {
+        if (text[i] == '\n') {
+            cursorX = 0.0f;
+            cursorY += lineHeight;
+        } else {
+            cursorX += charWidth;
+        }
+    }
+    
+    for (size_t i = start; i < text.size(); i++) {
+        char c = text[i];
+        layout.charOffsets.push_back((uint32_t)layout.points.size());
+        
+        if (c == '\n') {
+            cursorX = 0.0f;
+            cursorY += lineHeight;
+            continue;
+        }
+        
+        // Non-ASCII bytes get the unknown-character box, same as DEL
+        unsigned char index = (unsigned char)c;
+        if (index >= kGlyphCount) {
+            index = kGlyphCount - 1;
+        }
+        for (const Point& p : glyphs[index]) {
+            layout.points.push_back({cursorX + p.x * layout.scale, cursorY + p.y * layout.scale});
+        }
+        cursorX += charWidth;
+    }
+}
+
+void GlyphCache::bake(Layout& layout, float x, float y, const Color& color) const {
+    // Points before bakedPoints already hold this placement
+    layout.vertices.resize(layout.points.size());
+    for (size_t i = layout.bakedPoints; i < layout.points.size(); i++) {
+        layout.vertices[i] = UIBatch::makeVertex(x + layout.points[i].x, y + layout.points[i].y, color);
+    }
+    
+    layout.bakedX = x;
+    layout.bakedY = y;
+    layout.bakedColor = color;
+    layout.bakedPoints = layout.points.size();
+}
+
+void GlyphCache::endFrame() {
+    frame++;
+    if (frame % 60 != 0) return;
+    
+    for (auto it = slots.begin(); it != slots.end(); ) {
+        if (frame - it->second->lastUsedFrame > kEvictAfterFrames) {
+            it = slots.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
+    for (auto it = layouts.begin(); it != layouts.end(); ) {
+        if (frame - it->second.lastUsedFrame > kEvictAfterFrames) {
+            it = layouts.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
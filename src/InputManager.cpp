@@ -129,6 +129,13 @@ void InputManager::processEvent(const SDL_Event& event) {
     switch (event.type) {
         case SDL_CONTROLLERBUTTONDOWN:
         case SDL_CONTROLLERBUTTONUP:
+            if (event.type == SDL_CONTROLLERBUTTONDOWN) {
+                buttonsPressedThisFrame.insert({event.cbutton.which, event.cbutton.button});
+            }
+            
+            // Other controllers belong to other players
+            if (!isActiveController(event.cbutton.which)) break;
+            
             // Update button states
             for (const auto& mapping : controllerMapping.buttonMappings) {
                 if (mapping.second == event.cbutton.button) {
@@ -138,6 +145,8 @@ void InputManager::processEvent(const SDL_Event& event) {
             break;
             
         case SDL_CONTROLLERAXISMOTION:
+            if (!isActiveController(event.caxis.which)) break;
+            
             // Update axis values
             for (const auto& mapping : controllerMapping.axisMappings) {
                 if (mapping.second == event.caxis.axis) {
@@ -404,6 +413,52 @@ bool InputManager::wasKeyPressedThisFrame(SDL_Scancode key) const {
 
 void InputManager::clearKeyPressesThisFrame() {
     keysPressedThisFrame.clear();
+    buttonsPressedThisFrame.clear();
+}
+
+SDL_GameController* InputManager::getPlayerController(int player) const {
+    // The active controller is always the first connected one
+    if (player < 0 || player >= (int)connectedControllers.size()) {
+        return nullptr;
+    }
+    return connectedControllers[player];
+}
+
+bool InputManager::isActiveController(SDL_JoystickID id) const {
+    return activeController && SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(activeController)) == id;
+}
+
+float InputManager::getPlayerAxis(int player, InputAction action) const {
+    SDL_GameController* controller = getPlayerController(player);
+    auto it = controllerMapping.axisMappings.find(action);
+    if (!controller || it == controllerMapping.axisMappings.end()) {
+        return 0.0f;
+    }
+    
+    float value = SDL_GameControllerGetAxis(controller, (SDL_GameControllerAxis)it->second) / 32767.0f;
+    if (action == InputAction::PITCH_UP && invertY) value = -value;
+    return applyDeadzone(value);
+}
+
+bool InputManager::isPlayerButtonDown(int player, InputAction action) const {
+    SDL_GameController* controller = getPlayerController(player);
+    auto it = controllerMapping.buttonMappings.find(action);
+    if (!controller || it == controllerMapping.buttonMappings.end()) {
+        return false;
+    }
+    
+    return SDL_GameControllerGetButton(controller, (SDL_GameControllerButton)it->second) != 0;
+}
+
+bool InputManager::wasPlayerButtonPressedThisFrame(int player, InputAction action) const {
+    SDL_GameController* controller = getPlayerController(player);
+    auto it = controllerMapping.buttonMappings.find(action);
+    if (!controller || it == controllerMapping.buttonMappings.end()) {
+        return false;
+    }
+    
+    SDL_JoystickID id = SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(controller));
+    return buttonsPressedThisFrame.count({id, it->second}) != 0;
 }
 
 bool InputManager::isMouseButtonDown(int button) const {
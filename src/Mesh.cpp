@@ -0,0 +1,152 @@
+#include "Mesh.h"
+#include "GLExtensions.h"
+#include <algorithm>
+#include <cstddef>
+
+namespace {
+    uint8_t toByte(float value) {
+        return (uint8_t)(std::max(0.0f, std::min(1.0f, value)) * 255.0f + 0.5f);
+    }
+}
+
+Mesh::Mesh() {
+    current.position[0] = current.position[1] = current.position[2] = 0.0f;
+    current.normal[0] = 0.0f;
+    current.normal[1] = 0.0f;
+    current.normal[2] = 1.0f;
+    current.color[0] = current.color[1] = current.color[2] = current.color[3] = 255;
+}
+
+Mesh::~Mesh() {
+    release();
+}
+
+void Mesh::begin(Primitive newPrimitive) {
+    primitive = newPrimitive;
+    pendingCount = 0;
+}
+
+void Mesh::end() {
+    // Incomplete primitives are dropped, as glEnd does
+    pendingCount = 0;
+}
+
+void Mesh::normal(float x, float y, float z) {
+    current.normal[0] = x;
+    current.normal[1] = y;
+    current.normal[2] = z;
+}
+
+void Mesh::color(const Color& c) {
+    current.color[0] = toByte(c.r);
+    current.color[1] = toByte(c.g);
+    current.color[2] = toByte(c.b);
+    current.color[3] = toByte(c.a);
+}
+
+void Mesh::vertex(float x, float y, float z) {
+    Vertex& v = pending[pendingCount++];
+    v = current;
+    v.position[0] = x;
+    v.position[1] = y;
+    v.position[2] = z;
+    
+    if (primitive == Primitive::TRIANGLES && pendingCount == 3) {
+        vertices.insert(vertices.end(), pending, pending + 3);
+        pendingCount = 0;
+    } else if (primitive == Primitive::QUADS && pendingCount == 4) {
+        // Split along the 0-2 diagonal
+        vertices.push_back(pending[0]);
+        vertices.push_back(pending[1]);
+        vertices.push_back(pending[2]);
+        vertices.push_back(pending[0]);
+        vertices.push_back(pending[2]);
+        vertices.push_back(pending[3]);
+        pendingCount = 0;
+    }
+}
+
+bool Mesh::upload(GLStateCache& cache) {
+    release();
+    if (vertices.empty()) return false;
+    
+    state = &cache;
+    glGenBuffers(1, &vertexBuffer);
+    state->bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+    
+    vertexCount = (int)vertices.size();
+    std::vector<Vertex>().swap(vertices);
+    return true;
+}
+
+bool Mesh::uploadQuantized(GLStateCache& cache, const QuantizedVertex* quantized, int quantizedCount,
+                           const void* indices, int count, int indexSize, const Vector3& positionOffset,
+                           float positionScale) {
+    release();
+    std::vector<Vertex>().swap(vertices);
+    if (quantizedCount <= 0 || count <= 0) return false;
+    
+    state = &cache;
+    glGenBuffers(1, &vertexBuffer);
+    state->bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, quantizedCount * sizeof(QuantizedVertex), quantized, GL_STATIC_DRAW);
+    
+    glGenBuffers(1, &indexBuffer);
+    state->bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (size_t)count * indexSize, indices, GL_STATIC_DRAW);
+    
+    vertexCount = quantizedCount;
+    indexCount = count;
+    indexType = indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    offset = positionOffset;
+    scale = positionScale;
+    return true;
+}
+
+void Mesh::release() {
+    if (vertexBuffer) {
+        state->deleteBuffer(vertexBuffer);
+        vertexBuffer = 0;
+    }
+    if (indexBuffer) {
+        state->deleteBuffer(indexBuffer);
+        indexBuffer = 0;
+    }
+    vertexCount = 0;
+    indexCount = 0;
+}
+
+void Mesh::draw(GLStateCache& state) const {
+    if (!vertexBuffer) return;
+    
+    state.bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    
+    state.enableClientState(GL_VERTEX_ARRAY);
+    state.enableClientState(GL_NORMAL_ARRAY);
+    state.enableClientState(GL_COLOR_ARRAY);
+    state.disableClientState(GL_TEXTURE_COORD_ARRAY);
+    
+    if (indexBuffer) {
+        state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glVertexPointer(3, GL_SHORT, sizeof(QuantizedVertex), (const void*)offsetof(QuantizedVertex, position));
+        glNormalPointer(GL_BYTE, sizeof(QuantizedVertex), (const void*)offsetof(QuantizedVertex, normal));
+        glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(QuantizedVertex), (const void*)offsetof(QuantizedVertex, color));
+        
+        // Dequantized by the modelview matrix; the scale shrinks the
+        // transformed normals, so they need renormalizing
+        glPushMatrix();
+        glTranslatef(offset.x, offset.y, offset.z);
+        glScalef(scale, scale, scale);
+        state.enable(GL_NORMALIZE);
+        glDrawElements(GL_TRIANGLES, indexCount, indexType, nullptr);
+        glPopMatrix();
+        return;
+    }
+    
+    glVertexPointer(3, GL_FLOAT, sizeof(Vertex), (const void*)offsetof(Vertex, position));
+    glNormalPointer(GL_FLOAT, sizeof(Vertex), (const void*)offsetof(Vertex, normal));
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), (const void*)offsetof(Vertex, color));
+    
+    glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+}
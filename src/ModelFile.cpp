@@ -0,0 +1,641 @@
+#include "ModelFile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    const char kMagic[4] = {'F', 'S', 'M', 'C'};
+    const uint32_t kVersion = 2;
+    const int kVertexCacheSize = 32;        // Modelled post-transform cache entries
+    
+    uint32_t packColor(const Color& color) {
+        auto channel = [](float value) {
+            return (uint32_t)std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f);
+        };
+        return channel(color.r) | channel(color.g) << 8 | channel(color.b) << 16 | channel(color.a) << 24;
+    }
+    
+    // Welds vertices that quantized to the same bytes
+    struct VertexHash {
+        size_t operator()(const Mesh::QuantizedVertex& vertex) const {
+            uint64_t words[2];
+            std::memcpy(words, &vertex, sizeof(words));
+            return (size_t)((words[0] * 0x9E3779B97F4A7C15ull) ^ (words[1] + (words[0] >> 29)));
+        }
+    };
+    
+    struct VertexEqual {
+        bool operator()(const Mesh::QuantizedVertex& a, const Mesh::QuantizedVertex& b) const {
+            return std::memcmp(&a, &b, sizeof(a)) == 0;
+        }
+    };
+    
+    // Parses the next number in an OBJ line, advancing the cursor past it
+    bool parseFloat(const char*& cursor, float& value) {
+        char* end;
+        value = std::strtof(cursor, &end);
+        if (end == cursor) return false;
+        cursor = end;
+        return true;
+    }
+    
+    // Resolves a 1-based or negative (relative to the end) OBJ index
+    int resolveIndex(long index, size_t count) {
+        if (index > 0) return index <= (long)count ? (int)index - 1 : -1;
+        if (index < 0) return -index <= (long)count ? (int)(count + index) : -1;
+        return -1;
+    }
+    
+    // In nanoseconds, so an edit within the second the cache was built in
+    // still shows
+    int64_t modificationTime(const struct stat& file) {
+#ifdef __APPLE__
+        const struct timespec& time = file.st_mtimespec;
+#else
+        const struct timespec& time = file.st_mtim;
+#endif
+        return (int64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+    }
+    
+    std::string directoryOf(const std::string& path) {
+        size_t slash = path.find_last_of('/');
+        return slash != std::string::npos ? path.substr(0, slash + 1) : std::string();
+    }
+    
+    // A material library's identity; one that does not exist stamps as 0, so
+    // creating it later also invalidates the cache
+    void stampLibrary(const std::string& path, uint64_t& size, int64_t& time) {
+        struct stat library;
+        if (stat(path.c_str(), &library) == 0) {
+            size = (uint64_t)library.st_size;
+            time = modificationTime(library);
+        } else {
+            size = 0;
+            time = 0;
+        }
+    }
+    
+    // Library stamps follow the indices in the cache, unaligned: size, time,
+    // name length and the name as given to mtllib
+    const size_t kStampFixedBytes = sizeof(uint64_t) + sizeof(int64_t) + sizeof(uint32_t);
+    
+    void appendLibraryStamp(std::vector<uint8_t>& stamps, const std::string& directory, const std::string& name) {
+        uint64_t size;
+        int64_t time;
+        stampLibrary(directory + name, size, time);
+        uint32_t nameLength = (uint32_t)name.size();
+        
+        size_t start = stamps.size();
+        stamps.resize(start + kStampFixedBytes + name.size());
+        uint8_t* out = stamps.data() + start;
+        std::memcpy(out, &size, sizeof(size));
+        std::memcpy(out + 8, &time, sizeof(time));
+        std::memcpy(out + 16, &nameLength, sizeof(nameLength));
+        std::memcpy(out + kStampFixedBytes, name.data(), name.size());
+    }
+    
+    // True if every library in the stamps still has the recorded identity
+    bool librariesUnchanged(const uint8_t* stamps, size_t length, const std::string& directory) {
+        while (length > 0) {
+            if (length < kStampFixedBytes) return false;
+            uint64_t size;
+            int64_t time;
+            uint32_t nameLength;
+            std::memcpy(&size, stamps, sizeof(size));
+            std::memcpy(&time, stamps + 8, sizeof(time));
+            std::memcpy(&nameLength, stamps + 16, sizeof(nameLength));
+            stamps += kStampFixedBytes;
+            length -= kStampFixedBytes;
+            if (nameLength > length) return false;
+            
+            std::string name((const char*)stamps, nameLength);
+            stamps += nameLength;
+            length -= nameLength;
+            uint64_t currentSize;
+            int64_t currentTime;
+            stampLibrary(directory + name, currentSize, currentTime);
+            if (currentSize != size || currentTime != time) return false;
+        }
+        return true;
+    }
+    
+    // True if every index refers to one of the vertices
+    bool indicesInRange(const void* indices, size_t count, size_t indexSize, uint32_t vertexCount) {
+        if (indexSize == 2) {
+            const uint16_t* narrow = (const uint16_t*)indices;
+            return std::all_of(narrow, narrow + count, [vertexCount](uint16_t index) { return index < vertexCount; });
+        }
+        const uint32_t* wide = (const uint32_t*)indices;
+        return std::all_of(wide, wide + count, [vertexCount](uint32_t index) { return index < vertexCount; });
+    }
+    
+    // Reads the Kd colors of every material in an MTL file
+    void loadMaterials(const std::string& path, std::unordered_map<std::string, Color>& materials) {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            std::cerr << "Model: material library " << path << " not found" << std::endl;
+            return;
+        }
+        
+        std::string line;
+        Color* current = nullptr;
+        while (std::getline(file, line)) {
+            std::istringstream iss(line);
+            std::string keyword;
+            iss >> keyword;
+            if (keyword == "newmtl") {
+                std::string name;
+                iss >> name;
+                current = &materials[name];
+            } else if (keyword == "Kd" && current) {
+                iss >> current->r >> current->g >> current->b;
+            } else if (keyword == "d" && current) {
+                iss >> current->a;
+            }
+        }
+    }
+    
+    // Tom Forsyth's linear-speed vertex cache optimization: triangles are
+    // emitted greedily by a score that favours vertices still in a modelled
+    // LRU cache and vertices with few triangles left
+    float vertexScore(int cachePosition, int remaining) {
+        if (remaining == 0) return -1.0f;
+        
+        float score = 0.0f;
+        if (cachePosition >= 0) {
+            if (cachePosition < 3) {
+                // The triangle just emitted: no gain from using it again at once
+                score = 0.75f;
+            } else {
+                float fraction = 1.0f - (float)(cachePosition - 3) / (kVertexCacheSize - 3);
+                score = std::pow(fraction, 1.5f);
+            }
+        }
+        return score + 2.0f / std::sqrt((float)remaining);
+    }
+    
+    void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount < 2) return;
+        
+        // Triangles using each vertex. None repeats a vertex, welding drops those.
+        std::vector<int> remaining(vertexCount, 0);
+        for (uint32_t index : indices) {
+            remaining[index]++;
+        }
+        std::vector<size_t> firstTriangle(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; v++) {
+            firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+        }
+        std::vector<uint32_t> vertexTriangles(indices.size());
+        std::vector<size_t> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++) {
+            vertexTriangles[fill[indices[i]]++] = (uint32_t)(i / 3);
+        }
+        
+        std::vector<float> scores(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++) {
+            scores[v] = vertexScore(-1, remaining[v]);
+        }
+        
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> ordered;
+        ordered.reserve(indices.size());
+        std::vector<uint32_t> cache;
+        std::vector<uint32_t> nextCache;
+        size_t scanStart = 0;
+        long best = -1;
+        
+        while (ordered.size() < indices.size()) {
+            if (best < 0) {
+                // Nothing adjacent to the cache left: start again with the
+                // first triangle not yet emitted
+                while (emitted[scanStart]) scanStart++;
+                best = (long)scanStart;
+            }
+            
+            const uint32_t* corners = &indices[best * 3];
+            ordered.insert(ordered.end(), corners, corners + 3);
+            emitted[best] = true;
+            
+            // The triangle's vertices move to the front of the cache
+            nextCache.assign(corners, corners + 3);
+            for (int c = 0; c < 3; c++) {
+                uint32_t v = corners[c];
+                // The vertex's triangles not yet emitted stay first in its list
+                uint32_t* triangles = &vertexTriangles[firstTriangle[v]];
+                for (int i = 0; i < remaining[v]; i++) {
+                    if (triangles[i] == (uint32_t)best) {
+                        std::swap(triangles[i], triangles[remaining[v] - 1]);
+                        break;
+                    }
+                }
+                remaining[v]--;
+            }
+            for (uint32_t v : cache) {
+                if (v != corners[0] && v != corners[1] && v != corners[2]) {
+                    nextCache.push_back(v);
+                }
+            }
+            for (size_t i = kVertexCacheSize; i < nextCache.size(); i++) {
+                scores[nextCache[i]] = vertexScore(-1, remaining[nextCache[i]]);
+            }
+            if (nextCache.size() > (size_t)kVertexCacheSize) nextCache.resize(kVertexCacheSize);
+            cache.swap(nextCache);
+            
+            for (size_t i = 0; i < cache.size(); i++) {
+                scores[cache[i]] = vertexScore((int)i, remaining[cache[i]]);
+            }
+            
+            // Only triangles touching the cache changed score
+            best = -1;
+            float bestScore = -1.0f;
+            for (uint32_t v : cache) {
+                for (int i = 0; i < remaining[v]; i++) {
+                    uint32_t t = vertexTriangles[firstTriangle[v] + i];
+                    float score = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+                    if (score > bestScore) {
+                        bestScore = score;
+                        best = t;
+                    }
+                }
+            }
+        }
+        
+        indices.swap(ordered);
+    }
+}
+
+ModelFile::ModelFile() {
+}
+
+ModelFile::~ModelFile() {
+    release();
+}
+
+void ModelFile::release() {
+    if (mapping) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        mappingSize = 0;
+    }
+    std::vector<uint8_t>().swap(owned);
+    data = nullptr;
+    header = nullptr;
+}
+
+bool ModelFile::load(const std::string& path, const Color& defaultColor) {
+    release();
+    
+    struct stat source;
+    if (stat(path.c_str(), &source) != 0) return false;
+    
+    // What a cache must have been built from to still be valid
+    Header identity = {};
+    std::memcpy(identity.magic, kMagic, sizeof(kMagic));
+    identity.version = kVersion;
+    identity.sourceSize = (uint64_t)source.st_size;
+    identity.sourceTime = modificationTime(source);
+    identity.defaultColor = packColor(defaultColor);
+    
+    std::string cachePath = path + ".mesh";
+    if (mapCache(cachePath, identity)) return true;
+    
+    if (!convert(path, identity)) {
+        release();
+        return false;
+    }
+    writeCache(cachePath);
+    return true;
+}
+
+bool ModelFile::mapCache(const std::string& cachePath, const Header& expected) {
+    int fd = open(cachePath.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    
+    struct stat cache;
+    if (fstat(fd, &cache) != 0 || (size_t)cache.st_size < sizeof(Header)) {
+        close(fd);
+        return false;
+    }
+    
+    void* mapped = mmap(nullptr, (size_t)cache.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+    
+    const Header* candidate = (const Header*)mapped;
+    size_t geometrySize = sizeof(Header) + (size_t)candidate->vertexCount * sizeof(Mesh::QuantizedVertex) +
+                          (size_t)candidate->indexCount * candidate->indexSize;
+    size_t expectedSize = geometrySize + candidate->libraryBytes;
+    bool valid = std::memcmp(candidate->magic, expected.magic, sizeof(kMagic)) == 0 &&
+                 candidate->version == expected.version &&
+                 candidate->sourceSize == expected.sourceSize &&
+                 candidate->sourceTime == expected.sourceTime &&
+                 candidate->defaultColor == expected.defaultColor &&
+                 (candidate->indexSize == 2 || candidate->indexSize == 4) &&
+                 expectedSize == (size_t)cache.st_size &&
+                 librariesUnchanged((const uint8_t*)mapped + geometrySize, candidate->libraryBytes,
+                                    directoryOf(cachePath));
+    
+    // The indices go to the GPU unchecked, where a damaged one reads past
+    // the vertex buffer; one pass here is cheap next to converting
+    if (valid && !indicesInRange((const uint8_t*)mapped + sizeof(Header) +
+                                     (size_t)candidate->vertexCount * sizeof(Mesh::QuantizedVertex),
+                                 candidate->indexCount, candidate->indexSize, candidate->vertexCount)) {
+        std::cerr << "Model: cache " << cachePath << " has indices out of range, converting again" << std::endl;
+        valid = false;
+    }
+    if (!valid) {
+        munmap(mapped, (size_t)cache.st_size);
+        return false;
+    }
+    
+    mapping = mapped;
+    mappingSize = (size_t)cache.st_size;
+    data = (const uint8_t*)mapped;
+    header = candidate;
+    return true;
+}
+
+bool ModelFile::convert(const std::string& path, const Header& identity) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    
+    std::string directory = directoryOf(path);
+    
+    Color defaultColor((identity.defaultColor & 0xFF) / 255.0f, (identity.defaultColor >> 8 & 0xFF) / 255.0f,
+                       (identity.defaultColor >> 16 & 0xFF) / 255.0f, (identity.defaultColor >> 24) / 255.0f);
+    
+    // Flat list of triangle corners, welded after quantization
+    struct Corner {
+        Vector3 position;
+        Vector3 normal;
+        Color color;
+    };
+    std::vector<Vector3> positions;
+    std::vector<Color> positionColors;
+    std::vector<bool> hasPositionColor;
+    std::vector<Vector3> normals;
+    std::vector<Corner> corners;
+    std::unordered_map<std::string, Color> materials;
+    std::vector<uint8_t> libraryStamps;
+    const Color* material = nullptr;
+    
+    std::vector<int> facePositions;
+    std::vector<int> faceNormals;
+    size_t lineStart = 0;
+    while (lineStart < text.size()) {
+        size_t lineEnd = text.find('\n', lineStart);
+        if (lineEnd == std::string::npos) lineEnd = text.size();
+        std::string line = text.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+        
+        const char* cursor = line.c_str();
+        while (*cursor == ' ' || *cursor == '\t') cursor++;
+        
+        if (cursor[0] == 'v' && (cursor[1] == ' ' || cursor[1] == '\t')) {
+            cursor += 2;
+            Vector3 p;
+            if (!parseFloat(cursor, p.x) || !parseFloat(cursor, p.y) || !parseFloat(cursor, p.z)) continue;
+            positions.push_back(p);
+            Color c;
+            bool colored = parseFloat(cursor, c.r) && parseFloat(cursor, c.g) && parseFloat(cursor, c.b);
+            positionColors.push_back(colored ? c : Color());
+            hasPositionColor.push_back(colored);
+        } else if (cursor[0] == 'v' && cursor[1] == 'n') {
+            cursor += 2;
+            Vector3 n;
+            if (!parseFloat(cursor, n.x) || !parseFloat(cursor, n.y) || !parseFloat(cursor, n.z)) continue;
+            normals.push_back(n);
+        } else if (cursor[0] == 'f' && (cursor[1] == ' ' || cursor[1] == '\t')) {
+            cursor += 2;
+            facePositions.clear();
+            faceNormals.clear();
+            bool valid = true;
+            while (*cursor) {
+                char* end;
+                long index = std::strtol(cursor, &end, 10);
+                if (end == cursor) break;
+                cursor = end;
+                long normalIndex = 0;
+                if (*cursor == '/') {
+                    cursor++;
+                    std::strtol(cursor, &end, 10);      // Texture coordinate, unused
+                    cursor = end;
+                    if (*cursor == '/') {
+                        cursor++;
+                        normalIndex = std::strtol(cursor, &end, 10);
+                        cursor = end;
+                    }
+                }
+                int p = resolveIndex(index, positions.size());
+                int n = normalIndex ? resolveIndex(normalIndex, normals.size()) : -1;
+                if (p < 0) valid = false;
+                facePositions.push_back(p);
+                faceNormals.push_back(n);
+            }
+            if (!valid || facePositions.size() < 3) continue;
+            
+            // Fan triangulation; polygons from modelling tools are convex
+            for (size_t i = 1; i + 1 < facePositions.size(); i++) {
+                size_t triangle[3] = {0, i, i + 1};
+                const Vector3& a = positions[facePositions[triangle[0]]];
+                const Vector3& b = positions[facePositions[triangle[1]]];
+                const Vector3& c = positions[facePositions[triangle[2]]];
+                Vector3 flat = Vector3::cross(b - a, c - a).normalized();
+                
+                for (size_t k : triangle) {
+                    int p = facePositions[k];
+                    Corner corner;
+                    corner.position = positions[p];
+                    corner.normal = faceNormals[k] >= 0 ? normals[faceNormals[k]].normalized() : flat;
+                    corner.color = hasPositionColor[p] ? positionColors[p] : material ? *material : defaultColor;
+                    corners.push_back(corner);
+                }
+            }
+        } else if (line.compare(cursor - line.c_str(), 6, "usemtl") == 0) {
+            std::istringstream iss(cursor + 6);
+            std::string name;
+            iss >> name;
+            auto found = materials.find(name);
+            material = found != materials.end() ? &found->second : nullptr;
+        } else if (line.compare(cursor - line.c_str(), 6, "mtllib") == 0) {
+            std::istringstream iss(cursor + 6);
+            std::string name;
+            while (iss >> name) {
+                appendLibraryStamp(libraryStamps, directory, name);
+                loadMaterials(directory + name, materials);
+            }
+        }
+    }
+    
+    if (corners.empty()) {
+        std::cerr << "Model: " << path << " has no faces" << std::endl;
+        return false;
+    }
+    
+    // Positions quantize around the bounds center with one scale for all
+    // axes, so the dequantization is a translate and a uniform scale
+    Vector3 boundsMin = corners[0].position;
+    Vector3 boundsMax = corners[0].position;
+    for (const Corner& corner : corners) {
+        boundsMin = Vector3(std::min(boundsMin.x, corner.position.x), std::min(boundsMin.y, corner.position.y),
+                            std::min(boundsMin.z, corner.position.z));
+        boundsMax = Vector3(std::max(boundsMax.x, corner.position.x), std::max(boundsMax.y, corner.position.y),
+                            std::max(boundsMax.z, corner.position.z));
+    }
+    Vector3 center = (boundsMin + boundsMax) * 0.5f;
+    float halfExtent = std::max(std::max(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y),
+                                boundsMax.z - boundsMin.z) * 0.5f;
+    float scale = halfExtent > 0.0f ? halfExtent / 32767.0f : 1.0f;
+    
+    std::vector<Mesh::QuantizedVertex> vertices;
+    std::vector<uint32_t> indices;
+    indices.reserve(corners.size());
+    std::unordered_map<Mesh::QuantizedVertex, uint32_t, VertexHash, VertexEqual> welded;
+    for (size_t i = 0; i < corners.size(); i++) {
+        const Corner& corner = corners[i];
+        Mesh::QuantizedVertex vertex = {};
+        Vector3 local = (corner.position - center) * (1.0f / scale);
+        vertex.position[0] = (int16_t)std::lround(local.x);
+        vertex.position[1] = (int16_t)std::lround(local.y);
+        vertex.position[2] = (int16_t)std::lround(local.z);
+        vertex.normal[0] = (int8_t)std::lround(corner.normal.x * 127.0f);
+        vertex.normal[1] = (int8_t)std::lround(corner.normal.y * 127.0f);
+        vertex.normal[2] = (int8_t)std::lround(corner.normal.z * 127.0f);
+        uint32_t color = packColor(corner.color);
+        std::memcpy(vertex.color, &color, sizeof(color));
+        
+        auto inserted = welded.emplace(vertex, (uint32_t)vertices.size());
+        if (inserted.second) vertices.push_back(vertex);
+        indices.push_back(inserted.first->second);
+        
+        // Triangles too small to survive quantization
+        if (i % 3 == 2) {
+            size_t first = indices.size() - 3;
+            if (indices[first] == indices[first + 1] || indices[first + 1] == indices[first + 2] ||
+                indices[first] == indices[first + 2]) {
+                indices.resize(first);
+            }
+        }
+    }
+    if (indices.empty()) {
+        std::cerr << "Model: " << path << " has no faces" << std::endl;
+        return false;
+    }
+    
+    optimizeVertexCache(indices, vertices.size());
+    
+    // Vertices in the order the triangles first use them, so the fetches
+    // walk the vertex buffer forwards
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    std::vector<Mesh::QuantizedVertex> ordered;
+    ordered.reserve(vertices.size());
+    for (uint32_t& index : indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = (uint32_t)ordered.size();
+            ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    
+    Header converted = identity;
+    converted.vertexCount = (uint32_t)ordered.size();
+    converted.indexCount = (uint32_t)indices.size();
+    converted.indexSize = ordered.size() <= 0xFFFF ? 2 : 4;
+    converted.offset[0] = center.x;
+    converted.offset[1] = center.y;
+    converted.offset[2] = center.z;
+    converted.scale = scale;
+    converted.boundsMin[0] = boundsMin.x;
+    converted.boundsMin[1] = boundsMin.y;
+    converted.boundsMin[2] = boundsMin.z;
+    converted.boundsMax[0] = boundsMax.x;
+    converted.boundsMax[1] = boundsMax.y;
+    converted.boundsMax[2] = boundsMax.z;
+    converted.libraryBytes = (uint32_t)libraryStamps.size();
+    
+    size_t vertexBytes = ordered.size() * sizeof(Mesh::QuantizedVertex);
+    size_t indexBytes = indices.size() * converted.indexSize;
+    owned.resize(sizeof(Header) + vertexBytes + indexBytes + libraryStamps.size());
+    std::memcpy(owned.data(), &converted, sizeof(Header));
+    std::memcpy(owned.data() + sizeof(Header), ordered.data(), vertexBytes);
+    uint8_t* indexData = owned.data() + sizeof(Header) + vertexBytes;
+    if (converted.indexSize == 2) {
+        for (size_t i = 0; i < indices.size(); i++) {
+            uint16_t index = (uint16_t)indices[i];
+            std::memcpy(indexData + i * 2, &index, 2);
+        }
+    } else {
+        std::memcpy(indexData, indices.data(), indices.size() * 4);
+    }
+    std::memcpy(indexData + indexBytes, libraryStamps.data(), libraryStamps.size());
+    
+    data = owned.data();
+    header = (const Header*)data;
+    return true;
+}
+
+void ModelFile::writeCache(const std::string& cachePath) const {
+    // Written aside and renamed into place, so a concurrent or interrupted
+    // run never maps a partial file
+    std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file.is_open() || !file.write((const char*)owned.data(), owned.size())) {
+            std::cerr << "Model: failed to write cache " << cachePath << std::endl;
+            return;
+        }
+    }
+    if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+        std::cerr << "Model: failed to write cache " << cachePath << std::endl;
+        std::remove(tempPath.c_str());
+    }
+}
+
+const Mesh::QuantizedVertex* ModelFile::getVertices() const {
+    return (const Mesh::QuantizedVertex*)(data + sizeof(Header));
+}
+
+int ModelFile::getVertexCount() const {
+    return (int)header->vertexCount;
+}
+
+const void* ModelFile::getIndices() const {
+    return data + sizeof(Header) + header->vertexCount * sizeof(Mesh::QuantizedVertex);
+}
+
+int ModelFile::getIndexCount() const {
+    return (int)header->indexCount;
+}
+
+int ModelFile::getIndexSize() const {
+    return (int)header->indexSize;
+}
+
+Vector3 ModelFile::getOffset() const {
+    return Vector3(header->offset[0], header->offset[1], header->offset[2]);
+}
+
+float ModelFile::getScale() const {
+    return header->scale;
+}
+
+Vector3 ModelFile::getBoundsMin() const {
+    return Vector3(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]);
+}
+
+Vector3 ModelFile::getBoundsMax() const {
+    return Vector3(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]);
+}
@@ -0,0 +1,167 @@
+#include "OverlayLayer.h"
+#include "GLExtensions.h"
+#include "GLStateCache.h"
+#include <iostream>
+
+OverlayLayer::OverlayLayer() {
+}
+
+OverlayLayer::~OverlayLayer() {
+    release();
+}
+
+bool OverlayLayer::isSupported() {
+    return GLExt::hasFramebuffer;
+}
+
+void OverlayLayer::release() {
+    if (framebuffer) glDeleteFramebuffers(1, &framebuffer);
+    if (multisampleFramebuffer) glDeleteFramebuffers(1, &multisampleFramebuffer);
+    if (multisampleBuffer) glDeleteRenderbuffers(1, &multisampleBuffer);
+    if (texture) glDeleteTextures(1, &texture);
+    framebuffer = 0;
+    multisampleFramebuffer = 0;
+    multisampleBuffer = 0;
+    texture = 0;
+    textureWidth = 0;
+    textureHeight = 0;
+    textureSamples = 0;
+    drawn = false;
+}
+
+void OverlayLayer::begin(int newWidth, int newHeight) {
+    width = newWidth;
+    height = newHeight;
+    regions.clear();
+    batch.clear();
+    pending = true;
+}
+
+void OverlayLayer::addRegion(const Region& region) {
+    regions.push_back(region);
+}
+
+bool OverlayLayer::createTargets(int newWidth, int newHeight, int samples) {
+    release();
+    
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, newWidth, newHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    
+    if (status == GL_FRAMEBUFFER_COMPLETE && samples > 1) {
+        glGenRenderbuffers(1, &multisampleBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, multisampleBuffer);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, newWidth, newHeight);
+        
+        glGenFramebuffers(1, &multisampleFramebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, multisampleFramebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, multisampleBuffer);
+        status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    }
+    
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Overlay framebuffer incomplete: 0x" << std::hex << status << std::dec << std::endl;
+        release();
+        return false;
+    }
+    
+    textureWidth = newWidth;
+    textureHeight = newHeight;
+    textureSamples = samples;
+    return true;
+}
+
+bool OverlayLayer::update(GLStateCache& state, unsigned int target, int samples) {
+    if (!pending) return true;
+    pending = false;
+    drawn = false;
+    if (width <= 0 || height <= 0) return true;
+    
+    if (width != textureWidth || height != textureHeight || samples != textureSamples) {
+        if (!createTargets(width, height, samples)) {
+            glBindFramebuffer(GL_FRAMEBUFFER, target);
+            return false;
+        }
+    }
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, multisampleFramebuffer ? multisampleFramebuffer : framebuffer);
+    glViewport(0, 0, width, height);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    
+    // Color is blended as usual, coverage accumulates in alpha: the result is
+    // premultiplied
+    state.blendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    batch.flush(state, width, height);
+    state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    
+    if (multisampleFramebuffer) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, multisampleFramebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    drawn = true;
+    return true;
+}
+
+void OverlayLayer::composite(GLStateCache& state, int screenWidth, int screenHeight) {
+    if (!drawn || regions.empty()) return;
+    
+    state.matrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0, screenWidth, screenHeight, 0, -1, 1);
+    
+    state.matrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    
+    state.useProgram(0);
+    state.disable(GL_LIGHTING);
+    state.disable(GL_FOG);
+    state.disable(GL_DEPTH_TEST);
+    state.enable(GL_TEXTURE_2D);
+    state.blendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    
+    // Texture rows run bottom up, regions top down
+    float invWidth = 1.0f / textureWidth;
+    float invHeight = 1.0f / textureHeight;
+    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+    glBegin(GL_QUADS);
+    for (const Region& region : regions) {
+        float s0 = region.x * invWidth;
+        float s1 = (region.x + region.width) * invWidth;
+        float t0 = (textureHeight - region.y) * invHeight;
+        float t1 = (textureHeight - region.y - region.height) * invHeight;
+        float x0 = (float)region.screenX;
+        float y0 = (float)region.screenY;
+        float x1 = x0 + region.width;
+        float y1 = y0 + region.height;
+        
+        glTexCoord2f(s0, t0); glVertex2f(x0, y0);
+        glTexCoord2f(s1, t0); glVertex2f(x1, y0);
+        glTexCoord2f(s1, t1); glVertex2f(x1, y1);
+        glTexCoord2f(s0, t1); glVertex2f(x0, y1);
+    }
+    glEnd();
+    
+    state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    state.disable(GL_TEXTURE_2D);
+    
+    state.matrixMode(GL_PROJECTION);
+    glPopMatrix();
+    state.matrixMode(GL_MODELVIEW);
+    glPopMatrix();
+}
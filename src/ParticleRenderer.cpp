@@ -0,0 +1,306 @@
+#include "ParticleRenderer.h"
+#include "GLStateCache.h"
+#include "GLExtensions.h"
+#include "StreamBuffer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    constexpr int kTextureSize = 32;
+    
+    // Look of each type over its life: billboard half-extents in meters and
+    // colors at emission and expiry. Additive types glow and ignore the light.
+    struct Appearance {
+        float startSize;
+        float endSize;
+        float startColor[4];
+        float endColor[4];
+        bool additive;
+    };
+    
+    const Appearance kAppearances[ParticleSystem::kTypeCount] = {
+        { 1.5f, 14.0f, { 0.97f, 0.97f, 1.0f, 0.75f }, { 0.92f, 0.93f, 0.97f, 0.0f }, false },   // CONTRAIL
+        { 0.8f, 5.0f,  { 0.35f, 0.34f, 0.33f, 0.25f }, { 0.55f, 0.55f, 0.55f, 0.0f }, false },  // EXHAUST
+        { 1.0f, 7.0f,  { 0.62f, 0.52f, 0.38f, 0.6f }, { 0.68f, 0.6f, 0.47f, 0.0f }, false },    // DUST
+        { 0.3f, 0.1f,  { 1.0f, 0.85f, 0.45f, 1.0f }, { 1.0f, 0.35f, 0.1f, 0.0f }, true }        // SPARK
+    };
+    
+    const char* kParticleVertexShader =
+        "#version 330 compatibility\n"
+        "layout(location = 0) in vec2 corner;\n"
+        "layout(location = 1) in float positionX;\n"
+        "layout(location = 2) in float positionY;\n"
+        "layout(location = 3) in float positionZ;\n"
+        "layout(location = 4) in float age;\n"
+        "uniform vec4 startColor;\n"
+        "uniform vec4 endColor;\n"
+        "uniform vec2 size;\n"                          // Half-extent at emission and expiry
+        "out vec2 texCoord;\n"
+        "out vec4 color;\n"
+        "void main() {\n"
+        "    vec4 eyeCenter = gl_ModelViewMatrix * vec4(positionX, positionY, positionZ, 1.0);\n"
+        "    gl_Position = gl_ProjectionMatrix * (eyeCenter + vec4(corner * mix(size.x, size.y, age), 0.0, 0.0));\n"
+        "    texCoord = corner * 0.5 + 0.5;\n"
+        // Faded in over the first tenth of the life, and faded out by the fog,
+        // which suits blended and additive particles alike
+        "    float fog = clamp((gl_Fog.end - length(eyeCenter.xyz)) * gl_Fog.scale, 0.0, 1.0);\n"
+        "    color = mix(startColor, endColor, age);\n"
+        "    color.a *= min(age * 10.0, 1.0) * fog;\n"
+        "}\n";
+    
+    const char* kParticleFragmentShader =
+        "#version 330 compatibility\n"
+        "uniform sampler2D particleTexture;\n"
+        "in vec2 texCoord;\n"
+        "in vec4 color;\n"
+        "out vec4 fragColor;\n"
+        "void main() {\n"
+        "    fragColor = color * texture(particleTexture, texCoord);\n"
+        "}\n";
+    
+    uint8_t toByte(float value) {
+        return (uint8_t)(std::max(0.0f, std::min(1.0f, value)) * 255.0f + 0.5f);
+    }
+    
+    // Color of a type at emission or expiry, with the light on blended types
+    void litColor(const Appearance& appearance, const Color& light, bool end, float* color) {
+        const float* base = end ? appearance.endColor : appearance.startColor;
+        const float lit[] = { light.r, light.g, light.b };
+        for (int c = 0; c < 3; c++) {
+            color[c] = appearance.additive ? base[c] : base[c] * lit[c];
+        }
+        color[3] = base[3];
+    }
+}
+
+ParticleRenderer::ParticleRenderer() {
+}
+
+ParticleRenderer::~ParticleRenderer() {
+    release();
+}
+
+void ParticleRenderer::initialize(GLStateCache& cache) {
+    release();
+    state = &cache;
+    
+    createTexture();
+    
+    if (GLExt::hasInstancing &&
+        program.compile("particles", kParticleVertexShader, kParticleFragmentShader)) {
+        state->useProgram(program.getId());
+        glUniform1i(program.getUniformLocation("particleTexture"), 0);
+        colorLocations[0] = program.getUniformLocation("startColor");
+        colorLocations[1] = program.getUniformLocation("endColor");
+        sizeLocation = program.getUniformLocation("size");
+        
+        // Triangle strip order
+        const float corners[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+        glGenBuffers(1, &cornerBuffer);
+        state->bindBuffer(GL_ARRAY_BUFFER, cornerBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        
+        glGenBuffers(1, &particleBuffer);
+    }
+    
+    std::cout << "Particles: " << (program.isValid() ? "instanced billboards" : "CPU billboards") << std::endl;
+}
+
+void ParticleRenderer::release() {
+    program.release();
+    if (state) {
+        state->deleteBuffer(cornerBuffer);
+        state->deleteBuffer(particleBuffer);
+    }
+    cornerBuffer = 0;
+    particleBuffer = 0;
+    
+    if (texture) {
+        glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+}
+
+void ParticleRenderer::createTexture() {
+    // White with a round alpha falloff, denser in the middle than a cloud puff
+    std::vector<uint8_t> pixels(kTextureSize * kTextureSize * 4);
+    for (int y = 0; y < kTextureSize; y++) {
+        for (int x = 0; x < kTextureSize; x++) {
+            float dx = (x + 0.5f) / kTextureSize * 2.0f - 1.0f;
+            float dy = (y + 0.5f) / kTextureSize * 2.0f - 1.0f;
+            float falloff = std::max(0.0f, 1.0f - std::sqrt(dx * dx + dy * dy));
+            
+            uint8_t* pixel = &pixels[(y * kTextureSize + x) * 4];
+            pixel[0] = pixel[1] = pixel[2] = 255;
+            pixel[3] = toByte(falloff * 1.5f);
+        }
+    }
+    
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, kTextureSize, kTextureSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+}
+
+void ParticleRenderer::prepare(const ParticleSystem* particles) {
+    for (int type = 0; type < ParticleSystem::kTypeCount; type++) {
+        PoolBatch& batch = pools[type];
+        batch.pool = particles ? &particles->getPool((Type)type) : nullptr;
+        batch.count = (batch.pool && texture) ? batch.pool->count : 0;
+        batch.streamed = false;
+        if (batch.count == 0 || !stream || !program.isValid()) continue;
+        
+        // The arrays the instanced path reads, one after another
+        size_t bytes = batch.count * sizeof(float);
+        uint8_t* out = (uint8_t*)stream->allocate(bytes * 4, batch.streamOffset);
+        if (!out) continue;
+        std::memcpy(out, batch.pool->x, bytes);
+        std::memcpy(out + bytes, batch.pool->y, bytes);
+        std::memcpy(out + bytes * 2, batch.pool->z, bytes);
+        std::memcpy(out + bytes * 3, batch.pool->age, bytes);
+        batch.streamed = true;
+    }
+}
+
+AABB ParticleRenderer::getBounds(const ParticleSystem::Pool& pool, Type type) {
+    // Billboards reach past their centers by up to the largest half-extent
+    const Appearance& appearance = kAppearances[(int)type];
+    float reach = std::max(appearance.startSize, appearance.endSize);
+    Vector3 margin(reach, reach, reach);
+    return AABB(pool.boundsMin - margin, pool.boundsMax + margin);
+}
+
+void ParticleRenderer::draw(Type type, const Matrix4& viewMatrix, const Color& light, GLStateCache& state) {
+    const PoolBatch& batch = pools[(int)type];
+    if (batch.count == 0) return;
+    
+    // Blended over the scene: depth tested, but no depth writes
+    state.disable(GL_LIGHTING);
+    state.disable(GL_ALPHA_TEST);
+    state.enable(GL_DEPTH_TEST);
+    state.depthMask(false);
+    if (kAppearances[(int)type].additive) {
+        state.blendFunc(GL_SRC_ALPHA, GL_ONE);
+    } else {
+        state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    
+    if (program.isValid()) {
+        state.disable(GL_FOG);
+        drawInstanced(batch, type, light, state);
+    } else {
+        state.enable(GL_FOG);
+        buildQuads(batch, type, viewMatrix, light);
+        drawQuads(state);
+    }
+    
+    state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void ParticleRenderer::drawInstanced(const PoolBatch& batch, Type type, const Color& light, GLStateCache& state) {
+    const Appearance& appearance = kAppearances[(int)type];
+    state.useProgram(program.getId());
+    float color[4];
+    litColor(appearance, light, false, color);
+    glUniform4fv(colorLocations[0], 1, color);
+    litColor(appearance, light, true, color);
+    glUniform4fv(colorLocations[1], 1, color);
+    glUniform2f(sizeLocation, appearance.startSize, appearance.endSize);
+    
+    size_t bytes = batch.count * sizeof(float);
+    size_t base = 0;
+    if (batch.streamed) {
+        stream->flush();
+        state.bindBuffer(GL_ARRAY_BUFFER, stream->getBuffer());
+        base = batch.streamOffset;
+    } else {
+        const ParticleSystem::Pool& pool = *batch.pool;
+        state.bindBuffer(GL_ARRAY_BUFFER, particleBuffer);
+        glBufferData(GL_ARRAY_BUFFER, bytes * 4, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, pool.x);
+        glBufferSubData(GL_ARRAY_BUFFER, bytes, bytes, pool.y);
+        glBufferSubData(GL_ARRAY_BUFFER, bytes * 2, bytes, pool.z);
+        glBufferSubData(GL_ARRAY_BUFFER, bytes * 3, bytes, pool.age);
+    }
+    
+    // Generic attribute 0 overrides gl_Vertex in the compatibility profile, so
+    // these arrays are switched off again before any fixed-function draw
+    for (int attribute = 0; attribute <= 4; attribute++) {
+        glEnableVertexAttribArray(attribute);
+    }
+    for (int array = 0; array < 4; array++) {
+        glVertexAttribPointer(1 + array, 1, GL_FLOAT, GL_FALSE, 0, (const void*)(base + bytes * array));
+        GLExt::VertexAttribDivisor(1 + array, 1);
+    }
+    
+    state.bindBuffer(GL_ARRAY_BUFFER, cornerBuffer);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    
+    GLExt::DrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)batch.count);
+    
+    for (int attribute = 0; attribute <= 4; attribute++) {
+        glDisableVertexAttribArray(attribute);
+    }
+}
+
+void ParticleRenderer::buildQuads(const PoolBatch& batch, Type type, const Matrix4& viewMatrix, const Color& light) {
+    const Appearance& appearance = kAppearances[(int)type];
+    const ParticleSystem::Pool& pool = *batch.pool;
+    float startColor[4];
+    float endColor[4];
+    litColor(appearance, light, false, startColor);
+    litColor(appearance, light, true, endColor);
+    
+    // Camera right and up axes are the first two rows of the view rotation
+    const float* v = viewMatrix.m;
+    Vector3 right(v[0], v[4], v[8]);
+    Vector3 up(v[1], v[5], v[9]);
+    
+    const float corners[4][2] = { {-1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 1.0f} };
+    
+    quads.resize(batch.count * 4);
+    QuadVertex* out = quads.data();
+    for (int i = 0; i < batch.count; i++) {
+        float age = pool.age[i];
+        float size = appearance.startSize + (appearance.endSize - appearance.startSize) * age;
+        uint8_t color[4];
+        for (int c = 0; c < 3; c++) {
+            color[c] = toByte(startColor[c] + (endColor[c] - startColor[c]) * age);
+        }
+        color[3] = toByte((startColor[3] + (endColor[3] - startColor[3]) * age) * std::min(age * 10.0f, 1.0f));
+        
+        for (const auto& corner : corners) {
+            Vector3 offset = (right * corner[0] + up * corner[1]) * size;
+            out->position[0] = pool.x[i] + offset.x;
+            out->position[1] = pool.y[i] + offset.y;
+            out->position[2] = pool.z[i] + offset.z;
+            out->texCoord[0] = corner[0] * 0.5f + 0.5f;
+            out->texCoord[1] = corner[1] * 0.5f + 0.5f;
+            std::copy(color, color + 4, out->color);
+            out++;
+        }
+    }
+}
+
+void ParticleRenderer::drawQuads(GLStateCache& state) {
+    state.useProgram(0);
+    state.enable(GL_TEXTURE_2D);
+    
+    // Vertices come from client memory
+    state.bindBuffer(GL_ARRAY_BUFFER, 0);
+    state.enableClientState(GL_VERTEX_ARRAY);
+    state.enableClientState(GL_COLOR_ARRAY);
+    state.enableClientState(GL_TEXTURE_COORD_ARRAY);
+    state.disableClientState(GL_NORMAL_ARRAY);
+    
+    glVertexPointer(3, GL_FLOAT, sizeof(QuadVertex), quads[0].position);
+    glTexCoordPointer(2, GL_FLOAT, sizeof(QuadVertex), quads[0].texCoord);
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(QuadVertex), quads[0].color);
+    glDrawArrays(GL_QUADS, 0, (GLsizei)quads.size());
+}
@@ -0,0 +1,268 @@
+#include "ParticleSystem.h"
+#include "Aircraft.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define PARTICLES_SSE 1
+#endif
+
+namespace {
+    constexpr int kComponents = 8;      // x, y, z, vx, vy, vz, age, ageRate
+    constexpr int kAlignment = 16;
+    
+    // How each type moves and how long it lasts. lift is the vertical
+    // acceleration (buoyancy against gravity), drag the fraction of velocity
+    // lost per second relative to still air; spread is the random speed each
+    // particle gets on top of its emission velocity.
+    struct Behavior {
+        int capacity;
+        float lift;
+        float drag;
+        float lifetime;
+        float spread;
+    };
+    
+    const Behavior kBehaviors[ParticleSystem::kTypeCount] = {
+        { 65536,  0.0f, 0.3f, 20.0f, 0.6f },    // CONTRAIL
+        { 131072, 0.8f, 1.0f,  2.5f, 1.0f },    // EXHAUST
+        { 16384, -0.4f, 1.5f,  3.0f, 3.0f },    // DUST
+        { 4096,  -9.81f, 0.2f, 0.6f, 6.0f }     // SPARK
+    };
+    
+    // Engine exhaust per second at full throttle, and the share left at idle
+    constexpr float kExhaustRate = 40.0f;
+    constexpr float kIdleExhaust = 0.25f;
+    constexpr float kContrailRate = 30.0f;
+    
+    // Exhaust speed relative to the engine; it slows to the air's within a second
+    constexpr float kExhaustSpeed = 20.0f;
+    
+    // Nozzle positions: wingspans to the right, lengths up and forward of the
+    // aircraft origin
+    struct EngineLayout {
+        int count;
+        float offsets[2][3];
+    };
+    
+    EngineLayout engineLayout(AircraftType type) {
+        switch (type) {
+            case AircraftType::BOEING_737:
+            case AircraftType::A320_AIRBUS:
+                return { 2, { { -0.17f, -0.04f, -0.05f }, { 0.17f, -0.04f, -0.05f } } };
+            case AircraftType::F16_FIGHTER:
+                return { 1, { { 0.0f, 0.0f, -0.5f } } };
+            case AircraftType::F22_RAPTOR:
+                return { 2, { { -0.04f, 0.0f, -0.5f }, { 0.04f, 0.0f, -0.5f } } };
+            case AircraftType::CESSNA_172:
+                return { 1, { { 0.0f, -0.06f, 0.35f } } };
+        }
+        return { 0, {} };
+    }
+}
+
+ParticleSystem::ParticleSystem() : random(7) {
+    for (int type = 0; type < kTypeCount; type++) {
+        Pool& pool = pools[type];
+        pool.capacity = kBehaviors[type].capacity;     // Multiples of 4, so every array stays aligned
+        pool.storage.assign((size_t)pool.capacity * kComponents + kAlignment / sizeof(float), 0.0f);
+        pool.expired.reserve(pool.capacity);
+        
+        uintptr_t address = (uintptr_t)pool.storage.data();
+        float* base = (float*)((address + kAlignment - 1) & ~(uintptr_t)(kAlignment - 1));
+        float** arrays[kComponents] = { &pool.x, &pool.y, &pool.z, &pool.vx, &pool.vy, &pool.vz,
+                                        &pool.age, &pool.ageRate };
+        for (int component = 0; component < kComponents; component++) {
+            *arrays[component] = base + (size_t)component * pool.capacity;
+        }
+    }
+}
+
+ParticleSystem::~ParticleSystem() {}
+
+void ParticleSystem::emit(Type type, const Vector3& position, const Vector3& velocity) {
+    Pool& pool = pools[(int)type];
+    if (pool.count == pool.capacity) return;
+    
+    const Behavior& behavior = kBehaviors[(int)type];
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    float lifetime = behavior.lifetime * (1.0f + 0.25f * unit(random));
+    
+    int i = pool.count++;
+    pool.x[i] = position.x;
+    pool.y[i] = position.y;
+    pool.z[i] = position.z;
+    pool.vx[i] = velocity.x + unit(random) * behavior.spread;
+    pool.vy[i] = velocity.y + unit(random) * behavior.spread;
+    pool.vz[i] = velocity.z + unit(random) * behavior.spread;
+    pool.age[i] = 0.0f;
+    pool.ageRate[i] = 1.0f / lifetime;
+}
+
+void ParticleSystem::emitAlong(Type type, const Vector3& position, const Vector3& emitterVelocity,
+                               const Vector3& velocity, float rate, float deltaTime) {
+    // Whole particles, carrying the fraction over at random
+    std::uniform_real_distribution<float> fraction(0.0f, 1.0f);
+    int count = (int)(rate * deltaTime + fraction(random));
+    
+    for (int i = 0; i < count; i++) {
+        float back = (i + fraction(random)) / count;
+        emit(type, position - emitterVelocity * (deltaTime * back), velocity);
+    }
+}
+
+void ParticleSystem::emitTrails(const Aircraft& aircraft, float deltaTime) {
+    EngineLayout layout = engineLayout(aircraft.getType());
+    if (layout.count == 0 || deltaTime <= 0.0f) return;
+    
+    const AircraftSpecs& specs = aircraft.getSpecs();
+    Vector3 position = aircraft.getPosition();
+    Vector3 velocity = aircraft.getVelocity();
+    Vector3 forward = aircraft.getForwardVector();
+    Vector3 right = aircraft.getRightVector();
+    Vector3 up = aircraft.getUpVector();
+    
+    bool contrail = position.y > kContrailAltitude;
+    Type type = contrail ? Type::CONTRAIL : Type::EXHAUST;
+    float rate = contrail ? kContrailRate : kExhaustRate * (kIdleExhaust + (1.0f - kIdleExhaust) * aircraft.getThrottle());
+    Vector3 exhaust = contrail ? velocity * 0.1f : velocity - forward * kExhaustSpeed;
+    
+    for (int engine = 0; engine < layout.count; engine++) {
+        const float* offset = layout.offsets[engine];
+        Vector3 nozzle = position + right * (offset[0] * specs.wingSpan) + up * (offset[1] * specs.length) +
+                         forward * (offset[2] * specs.length);
+        emitAlong(type, nozzle, velocity, exhaust, rate, deltaTime);
+    }
+}
+
+void ParticleSystem::update(float deltaTime) {
+    for (int type = 0; type < kTypeCount; type++) {
+        Pool& pool = pools[type];
+        if (pool.count == 0) continue;
+        
+        const Behavior& behavior = kBehaviors[type];
+        integrate(pool, behavior.lift, std::exp(-behavior.drag * deltaTime), deltaTime);
+        removeExpired(pool);
+    }
+}
+
+void ParticleSystem::integrate(Pool& pool, float lift, float damping, float deltaTime) {
+    // Semi-implicit Euler: damp and accelerate the velocity, then move by it.
+    // Indices of particles that reach the end of their life are collected for
+    // removeExpired, in ascending order.
+    pool.expired.clear();
+    float liftStep = lift * deltaTime;
+    float minX = pool.x[0], minY = pool.y[0], minZ = pool.z[0];
+    float maxX = minX, maxY = minY, maxZ = minZ;
+    
+    int i = 0;
+#ifdef PARTICLES_SSE
+    __m128 step = _mm_set1_ps(deltaTime);
+    __m128 damp = _mm_set1_ps(damping);
+    __m128 rise = _mm_set1_ps(liftStep);
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 lowX = _mm_set1_ps(minX), lowY = _mm_set1_ps(minY), lowZ = _mm_set1_ps(minZ);
+    __m128 highX = lowX, highY = lowY, highZ = lowZ;
+    
+    for (; i + 4 <= pool.count; i += 4) {
+        __m128 vx = _mm_mul_ps(_mm_load_ps(pool.vx + i), damp);
+        __m128 vy = _mm_add_ps(_mm_mul_ps(_mm_load_ps(pool.vy + i), damp), rise);
+        __m128 vz = _mm_mul_ps(_mm_load_ps(pool.vz + i), damp);
+        _mm_store_ps(pool.vx + i, vx);
+        _mm_store_ps(pool.vy + i, vy);
+        _mm_store_ps(pool.vz + i, vz);
+        
+        __m128 x = _mm_add_ps(_mm_load_ps(pool.x + i), _mm_mul_ps(vx, step));
+        __m128 y = _mm_add_ps(_mm_load_ps(pool.y + i), _mm_mul_ps(vy, step));
+        __m128 z = _mm_add_ps(_mm_load_ps(pool.z + i), _mm_mul_ps(vz, step));
+        _mm_store_ps(pool.x + i, x);
+        _mm_store_ps(pool.y + i, y);
+        _mm_store_ps(pool.z + i, z);
+        
+        lowX = _mm_min_ps(lowX, x);
+        lowY = _mm_min_ps(lowY, y);
+        lowZ = _mm_min_ps(lowZ, z);
+        highX = _mm_max_ps(highX, x);
+        highY = _mm_max_ps(highY, y);
+        highZ = _mm_max_ps(highZ, z);
+        
+        __m128 age = _mm_add_ps(_mm_load_ps(pool.age + i), _mm_mul_ps(_mm_load_ps(pool.ageRate + i), step));
+        _mm_store_ps(pool.age + i, age);
+        
+        int mask = _mm_movemask_ps(_mm_cmpge_ps(age, one));
+        if (mask) {
+            for (int lane = 0; lane < 4; lane++) {
+                if (mask & (1 << lane)) pool.expired.push_back(i + lane);
+            }
+        }
+    }
+    
+    float lanes[4];
+    _mm_storeu_ps(lanes, lowX);
+    minX = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+    _mm_storeu_ps(lanes, lowY);
+    minY = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+    _mm_storeu_ps(lanes, lowZ);
+    minZ = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+    _mm_storeu_ps(lanes, highX);
+    maxX = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+    _mm_storeu_ps(lanes, highY);
+    maxY = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+    _mm_storeu_ps(lanes, highZ);
+    maxZ = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+
+    // The rest, or everything without SSE
+    for (; i < pool.count; i++) {
+        pool.vx[i] *= damping;
+        pool.vy[i] = pool.vy[i] * damping + liftStep;
+        pool.vz[i] *= damping;
+        pool.x[i] += pool.vx[i] * deltaTime;
+        pool.y[i] += pool.vy[i] * deltaTime;
+        pool.z[i] += pool.vz[i] * deltaTime;
+        
+        minX = std::min(minX, pool.x[i]);
+        minY = std::min(minY, pool.y[i]);
+        minZ = std::min(minZ, pool.z[i]);
+        maxX = std::max(maxX, pool.x[i]);
+        maxY = std::max(maxY, pool.y[i]);
+        maxZ = std::max(maxZ, pool.z[i]);
+        
+        pool.age[i] += pool.ageRate[i] * deltaTime;
+        if (pool.age[i] >= 1.0f) {
+            pool.expired.push_back(i);
+        }
+    }
+    
+    pool.boundsMin = Vector3(minX, minY, minZ);
+    pool.boundsMax = Vector3(maxX, maxY, maxZ);
+}
+
+void ParticleSystem::removeExpired(Pool& pool) {
+    // Highest index first: everything above the one being removed is then
+    // alive, so the last particle moved into its place is too
+    float* arrays[kComponents] = { pool.x, pool.y, pool.z, pool.vx, pool.vy, pool.vz, pool.age, pool.ageRate };
+    for (auto it = pool.expired.rbegin(); it != pool.expired.rend(); ++it) {
+        int last = --pool.count;
+        if (*it == last) continue;
+        for (float* array : arrays) {
+            array[*it] = array[last];
+        }
+    }
+}
+
+void ParticleSystem::clear() {
+    for (Pool& pool : pools) {
+        pool.count = 0;
+    }
+}
+
+int ParticleSystem::getLiveCount() const {
+    int count = 0;
+    for (const Pool& pool : pools) {
+        count += pool.count;
+    }
+    return count;
+}
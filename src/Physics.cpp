@@ -1,6 +1,7 @@
 #include "Physics.h"
 #include "Aircraft.h"
 #include "Terrain.h"
+#include "ParticleSystem.h"
 #include <cmath>
 #include <algorithm>
 
@@ -16,7 +17,7 @@ void Physics::update(float deltaTime, Aircraft* aircraft, const Terrain* terrain
     
     // Check ground collision
     if (terrain) {
-        handleGroundContact(aircraft, terrain);
+        handleGroundContact(aircraft, terrain, deltaTime);
         handleCollision(aircraft, terrain);
     }
 }
@@ -156,22 +157,50 @@ bool Physics::isStalling(const Aircraft* aircraft) const {
     return speedKmh < stallSpeed;
 }
 
-void Physics::handleGroundContact(Aircraft* aircraft, const Terrain* terrain) {
-    Vector3 pos = aircraft->getPosition();
-    
-    // Get terrain height at aircraft position
-    float terrainHeight = terrain->getHeightAt(pos.x, pos.z);
+void Physics::handleGroundContact(Aircraft* aircraft, const Terrain* terrain, float deltaTime) {
+    // Ground contact is handled by Aircraft class; this adds its effects.
+    // Runs before the aircraft's own update, so a touchdown shows as the
+    // wheels about to reach the ground during this step.
+    if (!particles || deltaTime <= 0.0f) return;
     
-    // Check if on runway (flat surface)
-    if (terrain->isOnRunway(pos)) {
-        terrainHeight = 0.0f;  // Runway is at sea level
+    Vector3 pos = aircraft->getPosition();
+    Vector3 velocity = aircraft->getVelocity();
+    float wheelHeight = pos.y - aircraft->getGearHeight();
+    bool onRunway = terrain->isOnRunway(pos);
+    
+    float sinkRate = -aircraft->getVerticalSpeed();
+    bool touchingDown = !aircraft->isOnGround() && wheelHeight - sinkRate * deltaTime <= 0.0f;
+    bool rolling = aircraft->isOnGround() && aircraft->getSpeed() > MIN_EFFECT_SPEED;
+    if (!touchingDown && !rolling) return;
+    
+    // Where the wheels (or the belly, gear up) meet the flat ground the
+    // aircraft lands on; particles trail behind it
+    Vector3 contact(pos.x, 0.0f, pos.z);
+    Vector3 trailing = velocity * 0.3f;
+    
+    // Sparks from a hard touchdown, and from a belly slide the whole way
+    if (touchingDown && sinkRate > HARD_LANDING_SINK_RATE) {
+        for (int i = 0; i < SPARK_BURST; i++) {
+            particles->emit(ParticleSystem::Type::SPARK, contact, trailing + Vector3(0, sinkRate * 0.5f, 0));
+        }
+    }
+    if (rolling && !aircraft->isLandingGearDown()) {
+        particles->emitAlong(ParticleSystem::Type::SPARK, contact, velocity, trailing + Vector3(0, 2.0f, 0),
+                             SPARK_RATE, deltaTime);
     }
     
-    // Ground contact is handled by Aircraft class
-    // This could add additional effects like:
-    // - Dust particles on dirt
-    // - Sparks on hard landing
-    // - Different friction on runway vs grass
+    // Dust kicked up off the paved runway, more of it the faster the wheels turn
+    if (!onRunway) {
+        if (touchingDown) {
+            for (int i = 0; i < DUST_BURST; i++) {
+                particles->emit(ParticleSystem::Type::DUST, contact, trailing + Vector3(0, 1.0f, 0));
+            }
+        } else {
+            float rate = DUST_RATE * std::min(aircraft->getSpeed() / 50.0f, 1.0f);
+            particles->emitAlong(ParticleSystem::Type::DUST, contact, velocity, trailing + Vector3(0, 1.5f, 0),
+                                 rate, deltaTime);
+        }
+    }
 }
 
 void Physics::handleCollision(Aircraft* aircraft, const Terrain* terrain) {
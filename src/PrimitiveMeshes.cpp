@@ -0,0 +1,303 @@
+#include "PrimitiveMeshes.h"
+#include "GLStateCache.h"
+#include "GLExtensions.h"
+#include "StreamBuffer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+namespace {
+    uint8_t toByte(float value) {
+        return (uint8_t)(std::max(0.0f, std::min(1.0f, value)) * 255.0f + 0.5f);
+    }
+    
+    // Tessellation per detail level: sphere slices and stacks, cylinder slices
+    const int kSphereSlices[] = { 8, 16, 32 };
+    const int kSphereStacks[] = { 6, 12, 24 };
+    const int kCylinderSlices[] = { 8, 20, 40 };
+}
+
+PrimitiveMeshes::PrimitiveMeshes() {}
+
+PrimitiveMeshes::~PrimitiveMeshes() {
+    release();
+}
+
+bool PrimitiveMeshes::initialize(GLStateCache& cache) {
+    release();
+    state = &cache;
+    
+    for (int detail = 0; detail < kDetailCount; detail++) {
+        addSphere(ranges[(int)Shape::SPHERE][detail], kSphereSlices[detail], kSphereStacks[detail]);
+        addCylinder(ranges[(int)Shape::CYLINDER][detail], kCylinderSlices[detail]);
+    }
+    
+    // Flat faces gain nothing from more triangles
+    addCube(ranges[(int)Shape::CUBE][0]);
+    for (int detail = 1; detail < kDetailCount; detail++) {
+        ranges[(int)Shape::CUBE][detail] = ranges[(int)Shape::CUBE][0];
+    }
+    
+    glGenBuffers(1, &vertexBuffer);
+    state->bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+    
+    glGenBuffers(1, &indexBuffer);
+    state->bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
+    
+    if (GLExt::hasInstancing) {
+        glGenBuffers(1, &instanceBuffer);
+    }
+    
+    std::cout << "Primitive meshes: " << vertices.size() << " vertices, "
+              << indices.size() / 3 << " triangles" << std::endl;
+    
+    std::vector<Vertex>().swap(vertices);
+    std::vector<uint16_t>().swap(indices);
+    return true;
+}
+
+void PrimitiveMeshes::release() {
+    if (!state) return;
+    
+    state->deleteBuffer(vertexBuffer);
+    state->deleteBuffer(indexBuffer);
+    state->deleteBuffer(instanceBuffer);
+    vertexBuffer = 0;
+    indexBuffer = 0;
+    instanceBuffer = 0;
+    
+    for (auto& shape : ranges) {
+        for (Range& range : shape) {
+            range = Range();
+        }
+    }
+}
+
+void PrimitiveMeshes::addVertex(float px, float py, float pz, float nx, float ny, float nz) {
+    Vertex v;
+    v.position[0] = px;
+    v.position[1] = py;
+    v.position[2] = pz;
+    v.normal[0] = nx;
+    v.normal[1] = ny;
+    v.normal[2] = nz;
+    vertices.push_back(v);
+}
+
+void PrimitiveMeshes::addSphere(Range& range, int slices, int stacks) {
+    range.firstIndex = (int)indices.size();
+    uint16_t base = (uint16_t)vertices.size();
+    
+    // Latitude rings from the south pole up; the seam column is duplicated
+    for (int i = 0; i <= stacks; i++) {
+        float lat = PI * (-0.5f + (float)i / stacks);
+        float y = std::sin(lat);
+        float r = std::cos(lat);
+        
+        for (int j = 0; j <= slices; j++) {
+            float lng = 2.0f * PI * (float)j / slices;
+            float x = std::cos(lng) * r;
+            float z = std::sin(lng) * r;
+            addVertex(x, y, z, x, y, z);
+        }
+    }
+    
+    // Counter-clockwise seen from outside
+    int row = slices + 1;
+    for (int i = 0; i < stacks; i++) {
+        for (int j = 0; j < slices; j++) {
+            uint16_t a = (uint16_t)(base + i * row + j);
+            uint16_t b = (uint16_t)(a + 1);
+            uint16_t c = (uint16_t)(a + row);
+            uint16_t d = (uint16_t)(c + 1);
+            indices.insert(indices.end(), { a, c, d, a, d, b });
+        }
+    }
+    
+    range.indexCount = (int)indices.size() - range.firstIndex;
+}
+
+void PrimitiveMeshes::addCylinder(Range& range, int slices) {
+    range.firstIndex = (int)indices.size();
+    
+    // Side: bottom and top vertex per slice, normals pointing outward
+    uint16_t side = (uint16_t)vertices.size();
+    for (int i = 0; i <= slices; i++) {
+        float angle = 2.0f * PI * i / slices;
+        float x = std::cos(angle);
+        float z = std::sin(angle);
+        addVertex(x, 0.0f, z, x, 0.0f, z);
+        addVertex(x, 1.0f, z, x, 0.0f, z);
+    }
+    for (int i = 0; i < slices; i++) {
+        uint16_t bottom0 = (uint16_t)(side + i * 2);
+        uint16_t top0 = (uint16_t)(bottom0 + 1);
+        uint16_t bottom1 = (uint16_t)(bottom0 + 2);
+        uint16_t top1 = (uint16_t)(bottom0 + 3);
+        indices.insert(indices.end(), { bottom0, top0, top1, bottom0, top1, bottom1 });
+    }
+    
+    // Caps: a center vertex and a flat-shaded rim each
+    for (int cap = 0; cap < 2; cap++) {
+        float y = (float)cap;
+        float ny = cap ? 1.0f : -1.0f;
+        
+        uint16_t center = (uint16_t)vertices.size();
+        addVertex(0.0f, y, 0.0f, 0.0f, ny, 0.0f);
+        for (int i = 0; i <= slices; i++) {
+            float angle = 2.0f * PI * i / slices;
+            addVertex(std::cos(angle), y, std::sin(angle), 0.0f, ny, 0.0f);
+        }
+        
+        for (int i = 0; i < slices; i++) {
+            uint16_t rim0 = (uint16_t)(center + 1 + i);
+            uint16_t rim1 = (uint16_t)(rim0 + 1);
+            if (cap) {
+                indices.insert(indices.end(), { center, rim1, rim0 });
+            } else {
+                indices.insert(indices.end(), { center, rim0, rim1 });
+            }
+        }
+    }
+    
+    range.indexCount = (int)indices.size() - range.firstIndex;
+}
+
+void PrimitiveMeshes::addCube(Range& range) {
+    range.firstIndex = (int)indices.size();
+    
+    // Per face: outward normal n and edge directions u, v with u x v = n
+    const float faces[6][3][3] = {
+        { { 1, 0, 0}, {0, 1, 0}, {0, 0, 1} },
+        { {-1, 0, 0}, {0, 0, 1}, {0, 1, 0} },
+        { { 0, 1, 0}, {0, 0, 1}, {1, 0, 0} },
+        { { 0,-1, 0}, {1, 0, 0}, {0, 0, 1} },
+        { { 0, 0, 1}, {1, 0, 0}, {0, 1, 0} },
+        { { 0, 0,-1}, {0, 1, 0}, {1, 0, 0} }
+    };
+    const float corners[4][2] = { {-1, -1}, {1, -1}, {1, 1}, {-1, 1} };
+    
+    for (const auto& face : faces) {
+        const float* n = face[0];
+        const float* u = face[1];
+        const float* v = face[2];
+        
+        uint16_t first = (uint16_t)vertices.size();
+        for (const auto& corner : corners) {
+            float p[3];
+            for (int k = 0; k < 3; k++) {
+                p[k] = 0.5f * (n[k] + corner[0] * u[k] + corner[1] * v[k]);
+            }
+            addVertex(p[0], p[1], p[2], n[0], n[1], n[2]);
+        }
+        indices.insert(indices.end(), { first, (uint16_t)(first + 1), (uint16_t)(first + 2),
+                                        first, (uint16_t)(first + 2), (uint16_t)(first + 3) });
+    }
+    
+    range.indexCount = (int)indices.size() - range.firstIndex;
+}
+
+float PrimitiveMeshes::getBoundingRadius(Shape shape) {
+    switch (shape) {
+        case Shape::SPHERE:   return 1.0f;
+        case Shape::CYLINDER: return 1.42f;     // Rim of the top cap, sqrt(2)
+        case Shape::CUBE:     return 0.87f;     // sqrt(3) / 2
+    }
+    return 1.0f;
+}
+
+int PrimitiveMeshes::getTriangleCount(Shape shape, Detail detail) const {
+    return ranges[(int)shape][(int)detail].indexCount / 3;
+}
+
+void PrimitiveMeshes::bindGeometry() {
+    state->bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    state->bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+}
+
+void PrimitiveMeshes::drawInstanced(Shape shape, Detail detail, const Instance* instances, size_t count) {
+    const Range& range = ranges[(int)shape][(int)detail];
+    if (!count || !range.indexCount || !instanceBuffer) return;
+    
+    // Converted straight into the stream buffer when there is room
+    size_t base = 0;
+    GPUInstance* out = stream ? (GPUInstance*)stream->allocate(count * sizeof(GPUInstance), base) : nullptr;
+    bool streamed = (out != nullptr);
+    if (!streamed) {
+        uploads.resize(count);
+        out = uploads.data();
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        std::copy(instances[i].transform.m, instances[i].transform.m + 16, out[i].transform);
+        out[i].color[0] = toByte(instances[i].color.r);
+        out[i].color[1] = toByte(instances[i].color.g);
+        out[i].color[2] = toByte(instances[i].color.b);
+        out[i].color[3] = toByte(instances[i].color.a);
+    }
+    
+    if (streamed) {
+        stream->flush();
+        state->bindBuffer(GL_ARRAY_BUFFER, stream->getBuffer());
+    } else {
+        state->bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, count * sizeof(GPUInstance), uploads.data(), GL_STREAM_DRAW);
+    }
+    
+    for (unsigned int column = 0; column < 4; column++) {
+        unsigned int location = kTransformAttribute + column;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(GPUInstance),
+                              (const void*)(base + offsetof(GPUInstance, transform) + column * 4 * sizeof(float)));
+        GLExt::VertexAttribDivisor(location, 1);
+    }
+    glEnableVertexAttribArray(kColorAttribute);
+    glVertexAttribPointer(kColorAttribute, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GPUInstance),
+                          (const void*)(base + offsetof(GPUInstance, color)));
+    GLExt::VertexAttribDivisor(kColorAttribute, 1);
+    
+    // Per-vertex attributes; other instanced draws may have left divisors on these locations
+    bindGeometry();
+    glEnableVertexAttribArray(kPositionAttribute);
+    glEnableVertexAttribArray(kNormalAttribute);
+    glVertexAttribPointer(kPositionAttribute, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, position));
+    glVertexAttribPointer(kNormalAttribute, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, normal));
+    GLExt::VertexAttribDivisor(kPositionAttribute, 0);
+    GLExt::VertexAttribDivisor(kNormalAttribute, 0);
+    
+    GLExt::DrawElementsInstanced(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_SHORT,
+                                 (const void*)(range.firstIndex * sizeof(uint16_t)), (GLsizei)count);
+    
+    // Generic attribute 0 overrides gl_Vertex in the compatibility profile
+    for (unsigned int location = 0; location <= kColorAttribute; location++) {
+        glDisableVertexAttribArray(location);
+    }
+}
+
+void PrimitiveMeshes::drawEach(Shape shape, Detail detail, const Instance* instances, size_t count) {
+    const Range& range = ranges[(int)shape][(int)detail];
+    if (!count || !range.indexCount) return;
+    
+    bindGeometry();
+    state->enableClientState(GL_VERTEX_ARRAY);
+    state->enableClientState(GL_NORMAL_ARRAY);
+    state->disableClientState(GL_COLOR_ARRAY);
+    state->disableClientState(GL_TEXTURE_COORD_ARRAY);
+    
+    glVertexPointer(3, GL_FLOAT, sizeof(Vertex), (const void*)offsetof(Vertex, position));
+    glNormalPointer(GL_FLOAT, sizeof(Vertex), (const void*)offsetof(Vertex, normal));
+    
+    const void* first = (const void*)(range.firstIndex * sizeof(uint16_t));
+    for (size_t i = 0; i < count; i++) {
+        const Color& color = instances[i].color;
+        glColor4f(color.r, color.g, color.b, color.a);
+        
+        glPushMatrix();
+        glMultMatrixf(instances[i].transform.m);
+        glDrawElements(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_SHORT, first);
+        glPopMatrix();
+    }
+}
@@ -0,0 +1,53 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include <cstring>
+
+uint64_t RenderQueue::makeKey(Pass pass, float depth, uint32_t material, uint32_t mesh) {
+    // The bits of a non-negative float sort like its value; the top 16 keep
+    // the exponent and 7 bits of mantissa, buckets under 1% of the distance wide
+    depth = std::max(depth, 0.0f);
+    uint32_t bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    uint64_t bucket = bits >> 16;
+    if (pass == Pass::TRANSPARENT) {
+        bucket = 0xFFFF - bucket;
+    }
+    
+    return ((uint64_t)pass << 60) | (bucket << 44) | ((uint64_t)(material & 0xFFF) << 32) | mesh;
+}
+
+void RenderQueue::append(const RenderQueue& other) {
+    items.insert(items.end(), other.items.begin(), other.items.end());
+}
+
+void RenderQueue::sort() {
+    if (items.size() < 2) return;
+    
+    // Bits that differ between any two keys
+    uint64_t first = items[0].key;
+    uint64_t differing = 0;
+    for (const Item& item : items) {
+        differing |= item.key ^ first;
+    }
+    
+    scratch.resize(items.size());
+    for (int shift = 0; shift < 64; shift += 8) {
+        if (!((differing >> shift) & 0xFF)) continue;
+        
+        size_t offsets[256] = {};
+        for (const Item& item : items) {
+            offsets[(item.key >> shift) & 0xFF]++;
+        }
+        size_t total = 0;
+        for (size_t& offset : offsets) {
+            size_t count = offset;
+            offset = total;
+            total += count;
+        }
+        
+        for (const Item& item : items) {
+            scratch[offsets[(item.key >> shift) & 0xFF]++] = item;
+        }
+        items.swap(scratch);
+    }
+}
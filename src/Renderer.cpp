@@ -1,21 +1,206 @@
 #include "Renderer.h"
-#include "Camera.h"
 #include "Aircraft.h"
 #include "Terrain.h"
 #include "Sky.h"
+#include "ModelFile.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <iostream>
+#include <limits>
 
-#ifdef __APPLE__
-#include <OpenGL/gl.h>
-#include <OpenGL/glu.h>
-#else
-#include <GL/gl.h>
-#include <GL/glu.h>
-#endif
+#include "GLExtensions.h"
 
-Renderer::Renderer() {}
+namespace {
+    // Interleaved terrain vertex as stored in the chunk vertex buffers; the
+    // color has the lighting baked in, so there is no normal
+    struct TerrainVertex {
+        float position[3];
+        GLubyte color[4];
+    };
+    
+    GLubyte toByte(float value) {
+        return (GLubyte)(std::max(0.0f, std::min(1.0f, value)) * 255.0f + 0.5f);
+    }
+    
+    // Sky light on lit geometry, as in the lit shader
+    const float kAmbientLight[3] = { 0.5f, 0.5f, 0.55f };
+    
+    // Interleaves a chunk's vertex data, lit the way the lit shader would with
+    // the ambient light dimmed where the terrain hides the sky; false if the
+    // chunk is incomplete
+    bool packTerrainVertices(const TerrainChunk& chunk, int vertexCount, const Vector3& sunDirection,
+                             const Color& sunLight, TerrainVertex* out) {
+        const auto& vertices = chunk.vertices;
+        const auto& normals = chunk.normals;
+        const auto& colors = chunk.colors;
+        const auto& skyVisibility = chunk.skyVisibility;
+        if ((int)vertices.size() < vertexCount || (int)normals.size() < vertexCount ||
+            (int)colors.size() < vertexCount || (int)skyVisibility.size() < vertexCount) {
+            return false;
+        }
+        
+        for (int i = 0; i < vertexCount; i++) {
+            TerrainVertex& v = out[i];
+            v.position[0] = vertices[i].x;
+            v.position[1] = vertices[i].y;
+            v.position[2] = vertices[i].z;
+            
+            float diffuse = std::max(Vector3::dot(normals[i], sunDirection), 0.0f);
+            float sky = skyVisibility[i];
+            v.color[0] = toByte(colors[i].r * (kAmbientLight[0] * sky + sunLight.r * diffuse));
+            v.color[1] = toByte(colors[i].g * (kAmbientLight[1] * sky + sunLight.g * diffuse));
+            v.color[2] = toByte(colors[i].b * (kAmbientLight[2] * sky + sunLight.b * diffuse));
+            v.color[3] = toByte(colors[i].a);
+        }
+        return true;
+    }
+    
+    // Bytes per frame in the stream buffer before it grows: room for every
+    // chunk inside the render distance arriving in the same frame
+    constexpr size_t kStreamBufferSize = 4 * 1024 * 1024;
+    
+    // Grid cells per vertical stripe in the shared terrain index buffer. Walking
+    // the grid in narrow stripes keeps the previous row's vertices in a 16-entry
+    // post-transform cache (ACMR ~0.6 versus ~1.0 for full-width rows).
+    constexpr int kIndexStripeWidth = 7;
+    
+    // Resident terrain chunks packed again per frame after the sun moves,
+    // and how far it has to move first: about half a degree, or a step in
+    // its color of about one level in 255
+    constexpr int kTerrainRelightsPerFrame = 8;
+    constexpr float kTerrainRelightCosine = 0.99996f;
+    constexpr float kTerrainRelightColorStep = 0.005f;
+    
+    // Uniform buffer binding point of the FrameData block
+    constexpr unsigned int kFrameDataBinding = 0;
+    
+    // Same light model as the fixed-function setup in initOpenGL (global ambient
+    // plus LIGHT0 ambient, color material), evaluated per pixel, then linear
+    // fog on the eye-space distance. Per-frame values come from FrameData, a
+    // uniform block under GLSL 3.30 and plain uniforms under GLSL 1.20.
+    const char* kFrameDataFields[] = {
+        "mat4 projection",
+        "vec4 sunDirection",
+        "vec4 sunColor",
+        "vec4 ambientColor",
+        "vec4 fogColor",
+        "vec4 fogParams"
+    };
+    
+    const char* kLitVertexShader =
+        "VARYING vec3 eyePosition;\n"
+        "VARYING vec3 eyeNormal;\n"
+        "VARYING vec4 vertexColor;\n"
+        "void main() {\n"
+        "    vec4 position = gl_ModelViewMatrix * gl_Vertex;\n"
+        "    eyePosition = position.xyz;\n"
+        "    eyeNormal = gl_NormalMatrix * gl_Normal;\n"
+        "    vertexColor = gl_Color;\n"
+        "    gl_Position = projection * position;\n"
+        "}\n";
+    
+    // Lit vertex shader for PrimitiveMeshes instances (GLSL 3.30 only)
+    const char* kLitInstancedVertexShader =
+        "layout(location = 0) in vec3 vertexPosition;\n"
+        "layout(location = 1) in vec3 vertexNormal;\n"
+        "layout(location = 2) in mat4 instanceTransform;\n"
+        "layout(location = 6) in vec4 instanceColor;\n"
+        "VARYING vec3 eyePosition;\n"
+        "VARYING vec3 eyeNormal;\n"
+        "VARYING vec4 vertexColor;\n"
+        "void main() {\n"
+        "    vec4 position = gl_ModelViewMatrix * (instanceTransform * vec4(vertexPosition, 1.0));\n"
+        "    eyePosition = position.xyz;\n"
+        "    eyeNormal = gl_NormalMatrix * (mat3(instanceTransform) * vertexNormal);\n"
+        "    vertexColor = instanceColor;\n"
+        "    gl_Position = projection * position;\n"
+        "}\n";
+    
+    // On-screen radius in pixels below which a primitive drops a detail level
+    constexpr float kLowDetailPixels = 6.0f;
+    constexpr float kMediumDetailPixels = 48.0f;
+    
+    // Same for aircraft: the reduced mesh, then the impostor. Once at a level,
+    // an aircraft only leaves it when its radius is this fraction past the
+    // threshold, so it does not flicker between two levels.
+    constexpr float kAircraftReducedPixels = 40.0f;
+    constexpr float kAircraftImpostorPixels = 12.0f;
+    constexpr float kAircraftLodHysteresis = 0.2f;
+    
+    // Impostor atlas: one column per kImpostorYaws directions around the
+    // aircraft, one row per kImpostorPitches elevations spread over
+    // +-kImpostorMaxPitch degrees. Frames are power-of-two squares, so mipmap
+    // levels down to kImpostorMipLevels never mix two frames.
+    constexpr int kImpostorFrameSize = 64;
+    constexpr int kImpostorYaws = 16;
+    constexpr int kImpostorPitches = 5;
+    constexpr float kImpostorMaxPitch = 60.0f;
+    constexpr int kImpostorMipLevels = 4;
+    
+    // HUD and minimap layout, in pixels
+    constexpr int kOverlayMargin = 20;
+    constexpr int kPanelWidth = 250;
+    constexpr int kPanelHeight = 180;
+    constexpr int kCrosshairSize = 60;
+    constexpr int kMinimapSize = 150;
+    
+    // Frames the readings must hold before an overlay goes into its cached
+    // texture. A redraw costs as much as dozens of frames drawn directly, so
+    // readings that change every few frames, as in flight, stay direct.
+    constexpr int kOverlaySteadyFrames = 60;
+    
+    // Room around each part in an overlay texture for outlines and
+    // multisampled edges
+    constexpr int kOverlayPadding = 2;
+    
+    // Sky dome rings and the vertices around each; rings crowd towards the
+    // horizon, where the sky's color changes fastest
+    constexpr int kSkyDomeRows = 24;
+    constexpr int kSkyDomeColumns = 48;
+    constexpr float kSunAngularRadius = 0.025f;     // Radians; several times the real sun's
+    
+    const char* kLitFragmentShader =
+        "VARYING vec3 eyePosition;\n"
+        "VARYING vec3 eyeNormal;\n"
+        "VARYING vec4 vertexColor;\n"
+        "void main() {\n"
+        "    float diffuse = max(dot(normalize(eyeNormal), sunDirection.xyz), 0.0);\n"
+        "    vec3 lit = min(vertexColor.rgb * (ambientColor.rgb + sunColor.rgb * diffuse), 1.0);\n"
+        "    float visibility = clamp((fogParams.y - length(eyePosition)) * fogParams.z, 0.0, 1.0);\n"
+        "    FRAG_COLOR = vec4(mix(fogColor.rgb, lit, visibility), vertexColor.a);\n"
+        "}\n";
+    
+    std::string litShaderSource(const char* body, bool vertexStage, bool glsl330) {
+        std::string source;
+        if (glsl330) {
+            source = "#version 330 compatibility\n";
+            source += vertexStage ? "#define VARYING out\n" : "#define VARYING in\nout vec4 fragColor;\n#define FRAG_COLOR fragColor\n";
+            source += "layout(std140) uniform FrameData {\n";
+            for (const char* field : kFrameDataFields) {
+                source += std::string("    ") + field + ";\n";
+            }
+            source += "};\n";
+        } else {
+            source = "#version 120\n#define VARYING varying\n";
+            source += vertexStage ? "" : "#define FRAG_COLOR gl_FragColor\n";
+            for (const char* field : kFrameDataFields) {
+                source += std::string("uniform ") + field + ";\n";
+            }
+        }
+        return source + body;
+    }
+    
+    void setVector(float* out, float x, float y, float z, float w) {
+        out[0] = x;
+        out[1] = y;
+        out[2] = z;
+        out[3] = w;
+    }
+}
+
+Renderer::Renderer(int threadCount) : workers(threadCount) {}
 
 Renderer::~Renderer() {
     shutdown();
@@ -29,20 +214,24 @@ bool Renderer::initialize(SDL_Window* win, int width, int height) {
     initOpenGL();
     
     std::cout << "Renderer initialized: " << screenWidth << "x" << screenHeight << std::endl;
+    std::cout << "Render lists built on " << workers.getThreadCount() << " threads" << std::endl;
     return true;
 }
 
 void Renderer::initOpenGL() {
+    GLExt::load();
+    glState.reset();
+    
     // Enable depth testing
-    glEnable(GL_DEPTH_TEST);
+    glState.enable(GL_DEPTH_TEST);
     glDepthFunc(GL_LEQUAL);
     
     // Enable smooth shading
     glShadeModel(GL_SMOOTH);
     
     // Enable lighting
-    glEnable(GL_LIGHTING);
-    glEnable(GL_LIGHT0);
+    glState.enable(GL_LIGHTING);
+    glState.enable(GL_LIGHT0);
     
     // Set up light
     GLfloat lightPosition[] = { 1.0f, 1.0f, 1.0f, 0.0f };
@@ -56,485 +245,264 @@ void Renderer::initOpenGL() {
     glLightfv(GL_LIGHT0, GL_SPECULAR, lightSpecular);
     
     // Enable color material
-    glEnable(GL_COLOR_MATERIAL);
+    glState.enable(GL_COLOR_MATERIAL);
     glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
     
     // Enable blending for transparency
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glState.enable(GL_BLEND);
+    glState.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     
     // Enable multisampling
-    glEnable(GL_MULTISAMPLE);
+    glState.enable(GL_MULTISAMPLE);
     
     // Set viewport
     glViewport(0, 0, screenWidth, screenHeight);
     
     // Set clear color
     glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+    
+    // Linear fog for the fixed-function path; out of range until a sky is applied
+    glFogi(GL_FOG_MODE, GL_LINEAR);
+    glFogf(GL_FOG_START, 1.0e6f);
+    glFogf(GL_FOG_END, 2.0e6f);
+    
+    // Impostors are cut out of their frames by alpha
+    glAlphaFunc(GL_GREATER, 0.5f);
+    
+    // HUD overlays are cached in textures multisampled like the window
+    overlaysCached = OverlayLayer::isSupported();
+    glGetIntegerv(GL_SAMPLES, &framebufferSamples);
+    
+    initShaders();
+    if (streamBuffer.initialize(glState, kStreamBufferSize)) {
+        clouds.setStreamBuffer(&streamBuffer);
+        particles.setStreamBuffer(&streamBuffer);
+        primitives.setStreamBuffer(&streamBuffer);
+    }
+    clouds.initialize(glState);
+    particles.initialize(glState);
+    primitives.initialize(glState);
+    
+    // Two triangles between each pair of neighboring dome vertices
+    skyDomeIndices.clear();
+    for (int row = 0; row < kSkyDomeRows; row++) {
+        for (int column = 0; column < kSkyDomeColumns; column++) {
+            uint16_t lower = (uint16_t)(row * (kSkyDomeColumns + 1) + column);
+            uint16_t upper = (uint16_t)(lower + kSkyDomeColumns + 1);
+            uint16_t quad[6] = { lower, upper, (uint16_t)(lower + 1), (uint16_t)(lower + 1), upper, (uint16_t)(upper + 1) };
+            skyDomeIndices.insert(skyDomeIndices.end(), quad, quad + 6);
+        }
+    }
+}
+
+void Renderer::initShaders() {
+    // Until a sky is applied: the initial LIGHT0 setup and no fog
+    std::copy(projectionMatrix.m, projectionMatrix.m + 16, frameUniforms.projection);
+    float invLength = 1.0f / std::sqrt(3.0f);
+    setVector(frameUniforms.sunDirection, invLength, invLength, invLength, 0.0f);
+    setVector(frameUniforms.sunColor, 0.9f, 0.9f, 0.85f, 1.0f);
+    setVector(frameUniforms.ambientColor, 0.5f, 0.5f, 0.55f, 1.0f);
+    setVector(frameUniforms.fogColor, clearColor.r, clearColor.g, clearColor.b, 1.0f);
+    setVector(frameUniforms.fogParams, 1.0e6f, 2.0e6f, 1.0e-6f, 0.0f);
+    frameUniformsDirty = true;
+    
+    if (!GLExt::hasShaders) {
+        std::cout << "Shaders unavailable, using fixed-function lighting" << std::endl;
+        return;
+    }
+    
+    // GLSL 3.30 with a uniform buffer, then GLSL 1.20 with plain uniforms
+    bool useBlock = GLExt::hasGLSL330 && GLExt::hasUniformBuffer;
+    if (useBlock) {
+        useBlock = litProgram.compile("lit", litShaderSource(kLitVertexShader, true, true),
+                                      litShaderSource(kLitFragmentShader, false, true)) &&
+                   litProgram.bindUniformBlock("FrameData", kFrameDataBinding);
+    }
+    
+    if (useBlock) {
+        glGenBuffers(1, &frameUniformBuffer);
+        glState.bindBuffer(GL_UNIFORM_BUFFER, frameUniformBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+        GLExt::BindBufferBase(GL_UNIFORM_BUFFER, kFrameDataBinding, frameUniformBuffer);
+    } else {
+        litProgram.compile("lit", litShaderSource(kLitVertexShader, true, false),
+                           litShaderSource(kLitFragmentShader, false, false));
+    }
+    
+    // Instanced primitives share the FrameData block, so need the 3.30 path
+    if (frameUniformBuffer && GLExt::hasInstancing) {
+        if (litInstancedProgram.compile("lit instanced", litShaderSource(kLitInstancedVertexShader, true, true),
+                                        litShaderSource(kLitFragmentShader, false, true))) {
+            litInstancedProgram.bindUniformBlock("FrameData", kFrameDataBinding);
+        }
+    }
+    
+    if (litProgram.isValid()) {
+        std::cout << "Lit shader: " << (frameUniformBuffer ? "GLSL 3.30, uniform buffer" : "GLSL 1.20")
+                  << (litInstancedProgram.isValid() ? ", instanced primitives" : "") << std::endl;
+    } else {
+        std::cout << "Lit shader unavailable, using fixed-function lighting" << std::endl;
+    }
 }
 
 void Renderer::shutdown() {
-    // Cleanup OpenGL resources if needed
+    frameCapture.stop();
+    releaseTerrainBuffers();
+    releaseAircraftMeshes();
+    
+    releaseOffscreenTarget();
+    clouds.release();
+    particles.release();
+    primitives.release();
+    streamBuffer.release();
+    for (ViewOverlay& overlay : overlays) {
+        overlay.layer.release();
+        overlay.valid = false;
+    }
+    litProgram.release();
+    litInstancedProgram.release();
+    glState.deleteBuffer(frameUniformBuffer);
+    frameUniformBuffer = 0;
 }
 
 void Renderer::beginFrame() {
+    glState.depthMask(true);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    stats = RenderStats();
+    streamBuffer.beginFrame();
+    
+    // State counters cover the whole previous frame, including the 2D flush
+    stats.stateChangesIssued = glState.getIssued();
+    stats.stateChangesFiltered = glState.getFiltered();
+    glState.resetCounters();
 }
 
 void Renderer::endFrame() {
+    flush2D();
+    frameCapture.captureFrame();
+    glyphCache.endFrame();
+    streamBuffer.endFrame();
     glFlush();
 }
 
+void Renderer::flush2D() {
+    uiBatch.flush(glState, screenWidth, screenHeight);
+}
+
 void Renderer::setViewport(int x, int y, int width, int height) {
     screenWidth = width;
     screenHeight = height;
     glViewport(x, y, width, height);
 }
 
-void Renderer::setClearColor(const Color& color) {
-    clearColor = color;
-    glClearColor(color.r, color.g, color.b, color.a);
-}
-
-void Renderer::setProjectionMatrix(float fov, float aspect, float nearPlane, float farPlane) {
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(fov, aspect, nearPlane, farPlane);
-    glMatrixMode(GL_MODELVIEW);
-}
-
-void Renderer::setViewMatrix(const Vector3& eye, const Vector3& target, const Vector3& up) {
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    gluLookAt(eye.x, eye.y, eye.z,
-              target.x, target.y, target.z,
-              up.x, up.y, up.z);
-}
-
-void Renderer::renderText(const std::string& text, float x, float y, float scale, const Color& color) {
-    // Switch to 2D rendering
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-    glOrtho(0, screenWidth, screenHeight, 0, -1, 1);
+bool Renderer::createOffscreenTarget(int width, int height) {
+    if (!GLExt::hasFramebuffer) {
+        std::cerr << "Offscreen rendering needs framebuffer objects (GL 3.0)" << std::endl;
+        return false;
+    }
     
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
+    releaseOffscreenTarget();
     
-    glDisable(GL_LIGHTING);
-    glDisable(GL_DEPTH_TEST);
+    glGenFramebuffers(1, &offscreenFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, offscreenFramebuffer);
     
-    glColor4f(color.r, color.g, color.b, color.a);
+    glGenRenderbuffers(1, &offscreenColorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreenColorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreenColorBuffer);
     
-    float charWidth = 10.0f * scale;
-    float charHeight = 16.0f * scale;
-    float cursorX = x;
+    glGenRenderbuffers(1, &offscreenDepthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, offscreenDepthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, offscreenDepthBuffer);
     
-    for (char c : text) {
-        if (c == '\n') {
-            cursorX = x;
-            y += charHeight * 1.2f;
-            continue;
-        }
-        drawCharacter(c, cursorX, y, scale);
-        cursorX += charWidth;
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Offscreen framebuffer incomplete: 0x" << std::hex << status << std::dec << std::endl;
+        releaseOffscreenTarget();
+        return false;
     }
     
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_LIGHTING);
-    
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
+    // The framebuffer stays bound; nothing else renders to the window
+    setViewport(0, 0, width, height);
+    framebufferSamples = 0;
+    std::cout << "Rendering offscreen at " << width << "x" << height << std::endl;
+    return true;
 }
 
-void Renderer::drawCharacter(char c, float x, float y, float scale) {
-    // Simple bitmap font rendering using lines
-    float w = 8.0f * scale;
-    float h = 14.0f * scale;
-    
-    glBegin(GL_LINES);
-    
-    // Define simple line-based characters
-    switch (c) {
-        case 'A': case 'a':
-            glVertex2f(x, y + h); glVertex2f(x + w/2, y);
-            glVertex2f(x + w/2, y); glVertex2f(x + w, y + h);
-            glVertex2f(x + w*0.2f, y + h*0.6f); glVertex2f(x + w*0.8f, y + h*0.6f);
-            break;
-        case 'B': case 'b':
-            glVertex2f(x, y); glVertex2f(x, y + h);
-            glVertex2f(x, y); glVertex2f(x + w*0.7f, y);
-            glVertex2f(x + w*0.7f, y); glVertex2f(x + w, y + h*0.2f);
-            glVertex2f(x + w, y + h*0.2f); glVertex2f(x + w*0.7f, y + h*0.5f);
-            glVertex2f(x, y + h*0.5f); glVertex2f(x + w*0.7f, y + h*0.5f);
-            glVertex2f(x + w*0.7f, y + h*0.5f); glVertex2f(x + w, y + h*0.8f);
-            glVertex2f(x + w, y + h*0.8f); glVertex2f(x + w*0.7f, y + h);
-            glVertex2f(x, y + h); glVertex2f(x + w*0.7f, y + h);
-            break;
-        case 'C': case 'c':
-            glVertex2f(x + w, y + h*0.2f); glVertex2f(x + w*0.5f, y);
-            glVertex2f(x + w*0.5f, y); glVertex2f(x, y + h*0.3f);
-            glVertex2f(x, y + h*0.3f); glVertex2f(x, y + h*0.7f);
-            glVertex2f(x, y + h*0.7f); glVertex2f(x + w*0.5f, y + h);
-            glVertex2f(x + w*0.5f, y + h); glVertex2f(x + w, y + h*0.8f);
-            break;
-        case 'D': case 'd':
-            glVertex2f(x, y); glVertex2f(x, y + h);
-            glVertex2f(x, y); glVertex2f(x + w*0.6f, y);
-            glVertex2f(x + w*0.6f, y); glVertex2f(x + w, y + h*0.3f);
-            glVertex2f(x + w, y + h*0.3f); glVertex2f(x + w, y + h*0.7f);
-            glVertex2f(x + w, y + h*0.7f); glVertex2f(x + w*0.6f, y + h);
-            glVertex2f(x + w*0.6f, y + h); glVertex2f(x, y + h);
-            break;
-        case 'E': case 'e':
-            glVertex2f(x, y); glVertex2f(x, y + h);
-            glVertex2f(x, y); glVertex2f(x + w, y);
-            glVertex2f(x, y + h*0.5f); glVertex2f(x + w*0.7f, y + h*0.5f);
-            glVertex2f(x, y + h); glVertex2f(x + w, y + h);
-            break;
-        case 'F': case 'f':
-            glVertex2f(x, y); glVertex2f(x, y + h);
-            glVertex2f(x, y); glVertex2f(x + w, y);
-            glVertex2f(x, y + h*0.5f); glVertex2f(x + w*0.7f, y + h*0.5f);
-            break;
-        case 'G': case 'g':
-            glVertex2f(x + w, y + h*0.2f); glVertex2f(x + w*0.5f, y);
-            glVertex2f(x + w*0.5f, y); glVertex2f(x, y + h*0.3f);
-            glVertex2f(x, y + h*0.3f); glVertex2f(x, y + h*0.7f);
-            glVertex2f(x, y + h*0.7f); glVertex2f(x + w*0.5f, y + h);
-            glVertex2f(x + w*0.5f, y + h); glVertex2f(x + w, y + h*0.7f);
-            glVertex2f(x + w, y + h*0.7f); glVertex2f(x + w, y + h*0.5f);
-            glVertex2f(x + w, y + h*0.5f); glVertex2f(x + w*0.5f, y + h*0.5f);
-            break;
-        case 'H': case 'h':
-            glVertex2f(x, y); glVertex2f(x, y + h);
-            glVertex2f(x + w, y); glVertex2f(x + w, y + h);
-            glVertex2f(x, y + h*0.5f); glVertex2f(x + w, y + h*0.5f);
-            break;
-        case 'I': case 'i':
-            glVertex2f(x + w*0.3f, y); glVertex2f(x + w*0.7f, y);
-            glVertex2f(x + w*0.5f, y); glVertex2f(x + w*0.5f, y + h);
-            glVertex2f(x + w*0.3f, y + h); glVertex2f(x + w*0.7f, y + h);
-            break;
-        case 'L': case 'l':
-            glVertex2f(x, y); glVertex2f(x, y + h);
-            glVertex2f(x, y + h); glVertex2f(x + w, y + h);
-            break;
-        case 'M': case 'm':
-            glVertex2f(x, y + h); glVertex2f(x, y);
-            glVertex2f(x, y); glVertex2f(x + w*0.5f, y + h*0.4f);
-            glVertex2f(x + w*0.5f, y + h*0.4f); glVertex2f(x + w, y);
-            glVertex2f(x + w, y); glVertex2f(x + w, y + h);
-            break;
-        case 'N': case 'n':
-            glVertex2f(x, y + h); glVertex2f(x, y);
-            glVertex2f(x, y); glVertex2f(x + w, y + h);
-            glVertex2f(x + w, y + h); glVertex2f(x + w, y);
-            break;
-        case 'O': case 'o':
-            glVertex2f(x + w*0.3f, y); glVertex2f(x + w*0.7f, y);
-            glVertex2f(x + w*0.7f, y); glVertex2f(x + w, y + h*0.3f);
-            glVertex2f(x + w, y + h*0.3f); glVertex2f(x + w, y + h*0.7f);
-            glVertex2f(x + w, y + h*0.7f); glVertex2f(x + w*0.7f, y + h);
-            glVertex2f(x + w*0.7f, y + h); glVertex2f(x + w*0.3f, y + h);
-            glVertex2f(x + w*0.3f, y + h); glVertex2f(x, y + h*0.7f);
-            glVertex2f(x, y + h*0.7f); glVertex2f(x, y + h*0.3f);
-            glVertex2f(x, y + h*0.3f); glVertex2f(x + w*0.3f, y);
-            break;
-        case 'P': case 'p':
-            glVertex2f(x, y); glVertex2f(x, y + h);
-            glVertex2f(x, y); glVertex2f(x + w*0.7f, y);
-            glVertex2f(x + w*0.7f, y); glVertex2f(x + w, y + h*0.15f);
-            glVertex2f(x + w, y + h*0.15f); glVertex2f(x + w, y + h*0.35f);
-            glVertex2f(x + w, y + h*0.35f); glVertex2f(x + w*0.7f, y + h*0.5f);
-            glVertex2f(x + w*0.7f, y + h*0.5f); glVertex2f(x, y + h*0.5f);
-            break;
-        case 'R': case 'r':
-            glVertex2f(x, y); glVertex2f(x, y + h);
-            glVertex2f(x, y); glVertex2f(x + w*0.7f, y);
-            glVertex2f(x + w*0.7f, y); glVertex2f(x + w, y + h*0.15f);
-            glVertex2f(x + w, y + h*0.15f); glVertex2f(x + w, y + h*0.35f);
-            glVertex2f(x + w, y + h*0.35f); glVertex2f(x + w*0.7f, y + h*0.5f);
-            glVertex2f(x + w*0.7f, y + h*0.5f); glVertex2f(x, y + h*0.5f);
-            glVertex2f(x + w*0.5f, y + h*0.5f); glVertex2f(x + w, y + h);
-            break;
-        case 'S': case 's':
-            glVertex2f(x + w, y + h*0.15f); glVertex2f(x + w*0.7f, y);
-            glVertex2f(x + w*0.7f, y); glVertex2f(x + w*0.3f, y);
-            glVertex2f(x + w*0.3f, y); glVertex2f(x, y + h*0.15f);
-            glVertex2f(x, y + h*0.15f); glVertex2f(x, y + h*0.35f);
-            glVertex2f(x, y + h*0.35f); glVertex2f(x + w*0.3f, y + h*0.5f);
-            glVertex2f(x + w*0.3f, y + h*0.5f); glVertex2f(x + w*0.7f, y + h*0.5f);
-            glVertex2f(x + w*0.7f, y + h*0.5f); glVertex2f(x + w, y + h*0.65f);
-            glVertex2f(x + w, y + h*0.65f); glVertex2f(x + w, y + h*0.85f);
-            glVertex2f(x + w, y + h*0.85f); glVertex2f(x + w*0.7f, y + h);
-            glVertex2f(x + w*0.7f, y + h); glVertex2f(x + w*0.3f, y + h);
-            glVertex2f(x + w*0.3f, y + h); glVertex2f(x, y + h*0.85f);
-            break;
-        case 'T': case 't':
-            glVertex2f(x, y); glVertex2f(x + w, y);
-            glVertex2f(x + w*0.5f, y); glVertex2f(x + w*0.5f, y + h);
-            break;
-        case 'U': case 'u':
-            glVertex2f(x, y); glVertex2f(x, y + h*0.7f);
-            glVertex2f(x, y + h*0.7f); glVertex2f(x + w*0.3f, y + h);
-            glVertex2f(x + w*0.3f, y + h); glVertex2f(x + w*0.7f, y + h);
-            glVertex2f(x + w*0.7f, y + h); glVertex2f(x + w, y + h*0.7f);
-            glVertex2f(x + w, y + h*0.7f); glVertex2f(x + w, y);
-            break;
-        case 'V': case 'v':
-            glVertex2f(x, y); glVertex2f(x + w*0.5f, y + h);
-            glVertex2f(x + w*0.5f, y + h); glVertex2f(x + w, y);
-            break;
-        case 'W': case 'w':
-            glVertex2f(x, y); glVertex2f(x + w*0.25f, y + h);
-            glVertex2f(x + w*0.25f, y + h); glVertex2f(x + w*0.5f, y + h*0.6f);
-            glVertex2f(x + w*0.5f, y + h*0.6f); glVertex2f(x + w*0.75f, y + h);
-            glVertex2f(x + w*0.75f, y + h); glVertex2f(x + w, y);
-            break;
-        case 'X': case 'x':
-            glVertex2f(x, y); glVertex2f(x + w, y + h);
-            glVertex2f(x + w, y); glVertex2f(x, y + h);
-            break;
-        case 'Y': case 'y':
-            glVertex2f(x, y); glVertex2f(x + w*0.5f, y + h*0.5f);
-            glVertex2f(x + w, y); glVertex2f(x + w*0.5f, y + h*0.5f);
-            glVertex2f(x + w*0.5f, y + h*0.5f); glVertex2f(x + w*0.5f, y + h);
-            break;
-        case 'Z': case 'z':
-            glVertex2f(x, y); glVertex2f(x + w, y);
-            glVertex2f(x + w, y); glVertex2f(x, y + h);
-            glVertex2f(x, y + h); glVertex2f(x + w, y + h);
-            break;
-        case '0':
-            glVertex2f(x + w*0.3f, y); glVertex2f(x + w*0.7f, y);
-            glVertex2f(x + w*0.7f, y); glVertex2f(x + w, y + h*0.2f);
-            glVertex2f(x + w, y + h*0.2f); glVertex2f(x + w, y + h*0.8f);
-            glVertex2f(x + w, y + h*0.8f); glVertex2f(x + w*0.7f, y + h);
-            glVertex2f(x + w*0.7f, y + h); glVertex2f(x + w*0.3f, y + h);
-            glVertex2f(x + w*0.3f, y + h); glVertex2f(x, y + h*0.8f);
-            glVertex2f(x, y + h*0.8f); glVertex2f(x, y + h*0.2f);
-            glVertex2f(x, y + h*0.2f); glVertex2f(x + w*0.3f, y);
-            break;
-        case '1':
-            glVertex2f(x + w*0.3f, y + h*0.2f); glVertex2f(x + w*0.5f, y);
-            glVertex2f(x + w*0.5f, y); glVertex2f(x + w*0.5f, y + h);
-            glVertex2f(x + w*0.2f, y + h); glVertex2f(x + w*0.8f, y + h);
-            break;
-        case '2':
-            glVertex2f(x, y + h*0.2f); glVertex2f(x + w*0.3f, y);
-            glVertex2f(x + w*0.3f, y); glVertex2f(x + w*0.7f, y);
-            glVertex2f(x + w*0.7f, y); glVertex2f(x + w, y + h*0.2f);
-            glVertex2f(x + w, y + h*0.2f); glVertex2f(x + w, y + h*0.4f);
-            glVertex2f(x + w, y + h*0.4f); glVertex2f(x, y + h);
-            glVertex2f(x, y + h); glVertex2f(x + w, y + h);
-            break;
-        case '3':
-            glVertex2f(x, y + h*0.15f); glVertex2f(x + w*0.3f, y);
-            glVertex2f(x + w*0.3f, y); glVertex2f(x + w*0.7f, y);
-            glVertex2f(x + w*0.7f, y); glVertex2f(x + w, y + h*0.15f);
-            glVertex2f(x + w, y + h*0.15f); glVertex2f(x + w, y + h*0.4f);
-            glVertex2f(x + w, y + h*0.4f); glVertex2f(x + w*0.5f, y + h*0.5f);
-            glVertex2f(x + w*0.5f, y + h*0.5f); glVertex2f(x + w, y + h*0.6f);
-            glVertex2f(x + w, y + h*0.6f); glVertex2f(x + w, y + h*0.85f);
-            glVertex2f(x + w, y + h*0.85f); glVertex2f(x + w*0.7f, y + h);
-            glVertex2f(x + w*0.7f, y + h); glVertex2f(x + w*0.3f, y + h);
-            glVertex2f(x + w*0.3f, y + h); glVertex2f(x, y + h*0.85f);
-            break;
-        case '4':
-            glVertex2f(x + w*0.7f, y); glVertex2f(x + w*0.7f, y + h);
-            glVertex2f(x + w*0.7f, y); glVertex2f(x, y + h*0.6f);
-            glVertex2f(x, y + h*0.6f); glVertex2f(x + w, y + h*0.6f);
-            break;
-        case '5':
-            glVertex2f(x + w, y); glVertex2f(x, y);
-            glVertex2f(x, y); glVertex2f(x, y + h*0.45f);
-            glVertex2f(x, y + h*0.45f); glVertex2f(x + w*0.7f, y + h*0.45f);
-            glVertex2f(x + w*0.7f, y + h*0.45f); glVertex2f(x + w, y + h*0.6f);
-            glVertex2f(x + w, y + h*0.6f); glVertex2f(x + w, y + h*0.85f);
-            glVertex2f(x + w, y + h*0.85f); glVertex2f(x + w*0.7f, y + h);
-            glVertex2f(x + w*0.7f, y + h); glVertex2f(x + w*0.3f, y + h);
-            glVertex2f(x + w*0.3f, y + h); glVertex2f(x, y + h*0.85f);
-            break;
-        case '6':
-            glVertex2f(x + w*0.7f, y); glVertex2f(x + w*0.3f, y);
-            glVertex2f(x + w*0.3f, y); glVertex2f(x, y + h*0.2f);
-            glVertex2f(x, y + h*0.2f); glVertex2f(x, y + h*0.8f);
-            glVertex2f(x, y + h*0.8f); glVertex2f(x + w*0.3f, y + h);
-            glVertex2f(x + w*0.3f, y + h); glVertex2f(x + w*0.7f, y + h);
-            glVertex2f(x + w*0.7f, y + h); glVertex2f(x + w, y + h*0.8f);
-            glVertex2f(x + w, y + h*0.8f); glVertex2f(x + w, y + h*0.6f);
-            glVertex2f(x + w, y + h*0.6f); glVertex2f(x + w*0.7f, y + h*0.5f);
-            glVertex2f(x + w*0.7f, y + h*0.5f); glVertex2f(x, y + h*0.5f);
-            break;
-        case '7':
-            glVertex2f(x, y); glVertex2f(x + w, y);
-            glVertex2f(x + w, y); glVertex2f(x + w*0.3f, y + h);
-            break;
-        case '8':
-            glVertex2f(x + w*0.3f, y); glVertex2f(x + w*0.7f, y);
-            glVertex2f(x + w*0.7f, y); glVertex2f(x + w, y + h*0.15f);
-            glVertex2f(x + w, y + h*0.15f); glVertex2f(x + w, y + h*0.35f);
-            glVertex2f(x + w, y + h*0.35f); glVertex2f(x + w*0.7f, y + h*0.5f);
-            glVertex2f(x + w*0.7f, y + h*0.5f); glVertex2f(x + w*0.3f, y + h*0.5f);
-            glVertex2f(x + w*0.3f, y + h*0.5f); glVertex2f(x, y + h*0.35f);
-            glVertex2f(x, y + h*0.35f); glVertex2f(x, y + h*0.15f);
-            glVertex2f(x, y + h*0.15f); glVertex2f(x + w*0.3f, y);
-            glVertex2f(x + w*0.3f, y + h*0.5f); glVertex2f(x, y + h*0.65f);
-            glVertex2f(x, y + h*0.65f); glVertex2f(x, y + h*0.85f);
-            glVertex2f(x, y + h*0.85f); glVertex2f(x + w*0.3f, y + h);
-            glVertex2f(x + w*0.3f, y + h); glVertex2f(x + w*0.7f, y + h);
-            glVertex2f(x + w*0.7f, y + h); glVertex2f(x + w, y + h*0.85f);
-            glVertex2f(x + w, y + h*0.85f); glVertex2f(x + w, y + h*0.65f);
-            glVertex2f(x + w, y + h*0.65f); glVertex2f(x + w*0.7f, y + h*0.5f);
-            break;
-        case '9':
-            glVertex2f(x + w, y + h*0.5f); glVertex2f(x + w*0.3f, y + h*0.5f);
-            glVertex2f(x + w*0.3f, y + h*0.5f); glVertex2f(x, y + h*0.35f);
-            glVertex2f(x, y + h*0.35f); glVertex2f(x, y + h*0.15f);
-            glVertex2f(x, y + h*0.15f); glVertex2f(x + w*0.3f, y);
-            glVertex2f(x + w*0.3f, y); glVertex2f(x + w*0.7f, y);
-            glVertex2f(x + w*0.7f, y); glVertex2f(x + w, y + h*0.15f);
-            glVertex2f(x + w, y + h*0.15f); glVertex2f(x + w, y + h*0.8f);
-            glVertex2f(x + w, y + h*0.8f); glVertex2f(x + w*0.7f, y + h);
-            glVertex2f(x + w*0.7f, y + h); glVertex2f(x + w*0.3f, y + h);
-            break;
-        case '.':
-            glVertex2f(x + w*0.4f, y + h*0.9f); glVertex2f(x + w*0.6f, y + h*0.9f);
-            glVertex2f(x + w*0.6f, y + h*0.9f); glVertex2f(x + w*0.6f, y + h);
-            glVertex2f(x + w*0.6f, y + h); glVertex2f(x + w*0.4f, y + h);
-            glVertex2f(x + w*0.4f, y + h); glVertex2f(x + w*0.4f, y + h*0.9f);
-            break;
-        case ':':
-            glVertex2f(x + w*0.4f, y + h*0.25f); glVertex2f(x + w*0.6f, y + h*0.25f);
-            glVertex2f(x + w*0.6f, y + h*0.25f); glVertex2f(x + w*0.6f, y + h*0.35f);
-            glVertex2f(x + w*0.6f, y + h*0.35f); glVertex2f(x + w*0.4f, y + h*0.35f);
-            glVertex2f(x + w*0.4f, y + h*0.35f); glVertex2f(x + w*0.4f, y + h*0.25f);
-            glVertex2f(x + w*0.4f, y + h*0.65f); glVertex2f(x + w*0.6f, y + h*0.65f);
-            glVertex2f(x + w*0.6f, y + h*0.65f); glVertex2f(x + w*0.6f, y + h*0.75f);
-            glVertex2f(x + w*0.6f, y + h*0.75f); glVertex2f(x + w*0.4f, y + h*0.75f);
-            glVertex2f(x + w*0.4f, y + h*0.75f); glVertex2f(x + w*0.4f, y + h*0.65f);
-            break;
-        case '-':
-            glVertex2f(x + w*0.2f, y + h*0.5f); glVertex2f(x + w*0.8f, y + h*0.5f);
-            break;
-        case '+':
-            glVertex2f(x + w*0.2f, y + h*0.5f); glVertex2f(x + w*0.8f, y + h*0.5f);
-            glVertex2f(x + w*0.5f, y + h*0.25f); glVertex2f(x + w*0.5f, y + h*0.75f);
-            break;
-        case '/':
-            glVertex2f(x, y + h); glVertex2f(x + w, y);
-            break;
-        case '%':
-            glVertex2f(x, y + h); glVertex2f(x + w, y);
-            glVertex2f(x + w*0.2f, y + h*0.1f); glVertex2f(x + w*0.3f, y + h*0.1f);
-            glVertex2f(x + w*0.3f, y + h*0.1f); glVertex2f(x + w*0.3f, y + h*0.25f);
-            glVertex2f(x + w*0.3f, y + h*0.25f); glVertex2f(x + w*0.2f, y + h*0.25f);
-            glVertex2f(x + w*0.2f, y + h*0.25f); glVertex2f(x + w*0.2f, y + h*0.1f);
-            glVertex2f(x + w*0.7f, y + h*0.75f); glVertex2f(x + w*0.8f, y + h*0.75f);
-            glVertex2f(x + w*0.8f, y + h*0.75f); glVertex2f(x + w*0.8f, y + h*0.9f);
-            glVertex2f(x + w*0.8f, y + h*0.9f); glVertex2f(x + w*0.7f, y + h*0.9f);
-            glVertex2f(x + w*0.7f, y + h*0.9f); glVertex2f(x + w*0.7f, y + h*0.75f);
-            break;
-        case ' ':
-            // Space - no lines
-            break;
-        default:
-            // Unknown character - draw a box
-            glVertex2f(x, y); glVertex2f(x + w, y);
-            glVertex2f(x + w, y); glVertex2f(x + w, y + h);
-            glVertex2f(x + w, y + h); glVertex2f(x, y + h);
-            glVertex2f(x, y + h); glVertex2f(x, y);
-            break;
-    }
-    
-    glEnd();
+void Renderer::releaseOffscreenTarget() {
+    if (!offscreenFramebuffer) return;
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &offscreenFramebuffer);
+    glDeleteRenderbuffers(1, &offscreenColorBuffer);
+    glDeleteRenderbuffers(1, &offscreenDepthBuffer);
+    offscreenFramebuffer = 0;
+    offscreenColorBuffer = 0;
+    offscreenDepthBuffer = 0;
 }
 
-void Renderer::renderRect(float x, float y, float width, float height, const Color& color, bool filled) {
-    // Switch to 2D rendering
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-    glOrtho(0, screenWidth, screenHeight, 0, -1, 1);
+bool Renderer::startCapture(const std::string& path, int fps) {
+    return frameCapture.start(path, screenWidth, screenHeight, fps, glState);
+}
+
+void Renderer::stopCapture() {
+    frameCapture.stop();
+}
+
+bool Renderer::readPixels(std::vector<unsigned char>& rgb) {
+    rgb.resize((size_t)screenWidth * screenHeight * 3);
     
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
+    glState.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, screenWidth, screenHeight, GL_RGB, GL_UNSIGNED_BYTE, rgb.data());
+    return glGetError() == GL_NO_ERROR;
+}
+
+void Renderer::setClearColor(const Color& color) {
+    clearColor = color;
+    glClearColor(color.r, color.g, color.b, color.a);
+}
+
+void Renderer::setProjectionMatrix(float fov, float aspect, float nearPlane, float farPlane) {
+    projectionMatrix = Matrix4::perspective(fov, aspect, nearPlane, farPlane);
+    frustum.extract(projectionMatrix * viewMatrix);
     
-    glDisable(GL_LIGHTING);
-    glDisable(GL_DEPTH_TEST);
+    std::copy(projectionMatrix.m, projectionMatrix.m + 16, frameUniforms.projection);
+    frameUniformsDirty = true;
     
-    glColor4f(color.r, color.g, color.b, color.a);
+    glState.matrixMode(GL_PROJECTION);
+    glLoadMatrixf(projectionMatrix.m);
+    glState.matrixMode(GL_MODELVIEW);
+}
+
+void Renderer::setViewMatrix(const Vector3& eye, const Vector3& target, const Vector3& up) {
+    viewMatrix = Matrix4::lookAt(eye, target, up);
+    eyePosition = eye;
+    frustum.extract(projectionMatrix * viewMatrix);
     
+    glState.matrixMode(GL_MODELVIEW);
+    glLoadMatrixf(viewMatrix.m);
+}
+
+void Renderer::renderText(const std::string& text, float x, float y, float scale, const Color& color) {
+    glyphCache.drawText(uiBatch, text, x, y, scale, color);
+}
+
+void Renderer::renderRect(float x, float y, float width, float height, const Color& color, bool filled) {
     if (filled) {
-        glBegin(GL_QUADS);
-        glVertex2f(x, y);
-        glVertex2f(x + width, y);
-        glVertex2f(x + width, y + height);
-        glVertex2f(x, y + height);
-        glEnd();
+        uiBatch.addRect(x, y, width, height, color);
     } else {
-        glBegin(GL_LINE_LOOP);
-        glVertex2f(x, y);
-        glVertex2f(x + width, y);
-        glVertex2f(x + width, y + height);
-        glVertex2f(x, y + height);
-        glEnd();
+        uiBatch.addRectOutline(x, y, width, height, color);
     }
-    
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_LIGHTING);
-    
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
 }
 
 void Renderer::renderCircle(float x, float y, float radius, const Color& color, bool filled) {
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-    glOrtho(0, screenWidth, screenHeight, 0, -1, 1);
-    
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-    
-    glDisable(GL_LIGHTING);
-    glDisable(GL_DEPTH_TEST);
-    
-    glColor4f(color.r, color.g, color.b, color.a);
-    
-    int segments = 32;
     if (filled) {
-        glBegin(GL_TRIANGLE_FAN);
-        glVertex2f(x, y);
-        for (int i = 0; i <= segments; i++) {
-            float angle = 2.0f * PI * i / segments;
-            glVertex2f(x + radius * std::cos(angle), y + radius * std::sin(angle));
-        }
-        glEnd();
+        uiBatch.addCircle(x, y, radius, color);
     } else {
-        glBegin(GL_LINE_LOOP);
-        for (int i = 0; i < segments; i++) {
-            float angle = 2.0f * PI * i / segments;
-            glVertex2f(x + radius * std::cos(angle), y + radius * std::sin(angle));
-        }
-        glEnd();
+        uiBatch.addCircleOutline(x, y, radius, color);
     }
-    
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_LIGHTING);
-    
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
 }
 
 void Renderer::renderProgressBar(float x, float y, float width, float height, float progress,
@@ -553,467 +521,915 @@ void Renderer::renderProgressBar(float x, float y, float width, float height, fl
 }
 
 void Renderer::renderCube(const Vector3& position, const Vector3& size, const Color& color) {
-    glPushMatrix();
-    glTranslatef(position.x, position.y, position.z);
-    glScalef(size.x, size.y, size.z);
-    
-    glColor4f(color.r, color.g, color.b, color.a);
-    
-    glBegin(GL_QUADS);
-    // Front face
-    glNormal3f(0, 0, 1);
-    glVertex3f(-0.5f, -0.5f, 0.5f);
-    glVertex3f(0.5f, -0.5f, 0.5f);
-    glVertex3f(0.5f, 0.5f, 0.5f);
-    glVertex3f(-0.5f, 0.5f, 0.5f);
-    
-    // Back face
-    glNormal3f(0, 0, -1);
-    glVertex3f(-0.5f, -0.5f, -0.5f);
-    glVertex3f(-0.5f, 0.5f, -0.5f);
-    glVertex3f(0.5f, 0.5f, -0.5f);
-    glVertex3f(0.5f, -0.5f, -0.5f);
-    
-    // Top face
-    glNormal3f(0, 1, 0);
-    glVertex3f(-0.5f, 0.5f, -0.5f);
-    glVertex3f(-0.5f, 0.5f, 0.5f);
-    glVertex3f(0.5f, 0.5f, 0.5f);
-    glVertex3f(0.5f, 0.5f, -0.5f);
-    
-    // Bottom face
-    glNormal3f(0, -1, 0);
-    glVertex3f(-0.5f, -0.5f, -0.5f);
-    glVertex3f(0.5f, -0.5f, -0.5f);
-    glVertex3f(0.5f, -0.5f, 0.5f);
-    glVertex3f(-0.5f, -0.5f, 0.5f);
-    
-    // Right face
-    glNormal3f(1, 0, 0);
-    glVertex3f(0.5f, -0.5f, -0.5f);
-    glVertex3f(0.5f, 0.5f, -0.5f);
-    glVertex3f(0.5f, 0.5f, 0.5f);
-    glVertex3f(0.5f, -0.5f, 0.5f);
-    
-    // Left face
-    glNormal3f(-1, 0, 0);
-    glVertex3f(-0.5f, -0.5f, -0.5f);
-    glVertex3f(-0.5f, -0.5f, 0.5f);
-    glVertex3f(-0.5f, 0.5f, 0.5f);
-    glVertex3f(-0.5f, 0.5f, -0.5f);
-    glEnd();
-    
-    glPopMatrix();
+    PrimitiveMeshes::Instance instance = {
+        Matrix4::translation(position) * Matrix4::scale(size.x, size.y, size.z), color
+    };
+    renderPrimitives(PrimitiveMeshes::Shape::CUBE, &instance, 1);
 }
 
-void Renderer::renderPlane3D(const Vector3& position, const Vector3& rotation,
-                             float wingspan, float length, const Color& primaryColor, const Color& secondaryColor,
-                             float gearState, float flapsState) {
-    glPushMatrix();
-    glTranslatef(position.x, position.y, position.z);
-    glRotatef(rotation.y, 0, 1, 0);  // Yaw
-    glRotatef(rotation.x, 1, 0, 0);  // Pitch
-    glRotatef(rotation.z, 0, 0, 1);  // Roll
+void Renderer::buildAircraftMesh(AircraftMesh& mesh, float wingspan, float length,
+                                 const Color& primaryColor, const Color& secondaryColor) {
+    mesh.wingspan = wingspan;
+    mesh.length = length;
+    
+    Mesh& body = mesh.body;
     
     // Fuselage (main body)
-    glColor4f(primaryColor.r, primaryColor.g, primaryColor.b, primaryColor.a);
+    body.color(primaryColor);
     
     float fuselageWidth = length * 0.08f;
     float fuselageHeight = length * 0.1f;
     
-    glBegin(GL_QUADS);
+    body.begin(Mesh::Primitive::QUADS);
     // Top
-    glNormal3f(0, 1, 0);
-    glVertex3f(-fuselageWidth, fuselageHeight, -length * 0.5f);
-    glVertex3f(fuselageWidth, fuselageHeight, -length * 0.5f);
-    glVertex3f(fuselageWidth, fuselageHeight, length * 0.5f);
-    glVertex3f(-fuselageWidth, fuselageHeight, length * 0.5f);
+    body.normal(0, 1, 0);
+    body.vertex(-fuselageWidth, fuselageHeight, -length * 0.5f);
+    body.vertex(fuselageWidth, fuselageHeight, -length * 0.5f);
+    body.vertex(fuselageWidth, fuselageHeight, length * 0.5f);
+    body.vertex(-fuselageWidth, fuselageHeight, length * 0.5f);
     
     // Bottom
-    glNormal3f(0, -1, 0);
-    glVertex3f(-fuselageWidth, -fuselageHeight, -length * 0.5f);
-    glVertex3f(-fuselageWidth, -fuselageHeight, length * 0.5f);
-    glVertex3f(fuselageWidth, -fuselageHeight, length * 0.5f);
-    glVertex3f(fuselageWidth, -fuselageHeight, -length * 0.5f);
+    body.normal(0, -1, 0);
+    body.vertex(-fuselageWidth, -fuselageHeight, -length * 0.5f);
+    body.vertex(-fuselageWidth, -fuselageHeight, length * 0.5f);
+    body.vertex(fuselageWidth, -fuselageHeight, length * 0.5f);
+    body.vertex(fuselageWidth, -fuselageHeight, -length * 0.5f);
     
     // Left side
-    glNormal3f(-1, 0, 0);
-    glVertex3f(-fuselageWidth, -fuselageHeight, -length * 0.5f);
-    glVertex3f(-fuselageWidth, fuselageHeight, -length * 0.5f);
-    glVertex3f(-fuselageWidth, fuselageHeight, length * 0.5f);
-    glVertex3f(-fuselageWidth, -fuselageHeight, length * 0.5f);
+    body.normal(-1, 0, 0);
+    body.vertex(-fuselageWidth, -fuselageHeight, -length * 0.5f);
+    body.vertex(-fuselageWidth, fuselageHeight, -length * 0.5f);
+    body.vertex(-fuselageWidth, fuselageHeight, length * 0.5f);
+    body.vertex(-fuselageWidth, -fuselageHeight, length * 0.5f);
     
     // Right side
-    glNormal3f(1, 0, 0);
-    glVertex3f(fuselageWidth, -fuselageHeight, -length * 0.5f);
-    glVertex3f(fuselageWidth, -fuselageHeight, length * 0.5f);
-    glVertex3f(fuselageWidth, fuselageHeight, length * 0.5f);
-    glVertex3f(fuselageWidth, fuselageHeight, -length * 0.5f);
-    glEnd();
+    body.normal(1, 0, 0);
+    body.vertex(fuselageWidth, -fuselageHeight, -length * 0.5f);
+    body.vertex(fuselageWidth, -fuselageHeight, length * 0.5f);
+    body.vertex(fuselageWidth, fuselageHeight, length * 0.5f);
+    body.vertex(fuselageWidth, fuselageHeight, -length * 0.5f);
+    body.end();
     
     // Nose cone
-    glBegin(GL_TRIANGLES);
-    glNormal3f(0, 0, -1);
-    glVertex3f(0, 0, -length * 0.5f - length * 0.15f);
-    glVertex3f(-fuselageWidth, fuselageHeight, -length * 0.5f);
-    glVertex3f(fuselageWidth, fuselageHeight, -length * 0.5f);
-    
-    glVertex3f(0, 0, -length * 0.5f - length * 0.15f);
-    glVertex3f(fuselageWidth, -fuselageHeight, -length * 0.5f);
-    glVertex3f(-fuselageWidth, -fuselageHeight, -length * 0.5f);
-    
-    glVertex3f(0, 0, -length * 0.5f - length * 0.15f);
-    glVertex3f(-fuselageWidth, -fuselageHeight, -length * 0.5f);
-    glVertex3f(-fuselageWidth, fuselageHeight, -length * 0.5f);
-    
-    glVertex3f(0, 0, -length * 0.5f - length * 0.15f);
-    glVertex3f(fuselageWidth, fuselageHeight, -length * 0.5f);
-    glVertex3f(fuselageWidth, -fuselageHeight, -length * 0.5f);
-    glEnd();
+    body.begin(Mesh::Primitive::TRIANGLES);
+    body.normal(0, 0, -1);
+    body.vertex(0, 0, -length * 0.5f - length * 0.15f);
+    body.vertex(-fuselageWidth, fuselageHeight, -length * 0.5f);
+    body.vertex(fuselageWidth, fuselageHeight, -length * 0.5f);
+    
+    body.vertex(0, 0, -length * 0.5f - length * 0.15f);
+    body.vertex(fuselageWidth, -fuselageHeight, -length * 0.5f);
+    body.vertex(-fuselageWidth, -fuselageHeight, -length * 0.5f);
+    
+    body.vertex(0, 0, -length * 0.5f - length * 0.15f);
+    body.vertex(-fuselageWidth, -fuselageHeight, -length * 0.5f);
+    body.vertex(-fuselageWidth, fuselageHeight, -length * 0.5f);
+    
+    body.vertex(0, 0, -length * 0.5f - length * 0.15f);
+    body.vertex(fuselageWidth, fuselageHeight, -length * 0.5f);
+    body.vertex(fuselageWidth, -fuselageHeight, -length * 0.5f);
+    body.end();
     
     // Wings
-    glColor4f(secondaryColor.r, secondaryColor.g, secondaryColor.b, secondaryColor.a);
+    body.color(secondaryColor);
     
     float wingThickness = 0.3f;
     float wingChord = length * 0.25f;  // Width of wing
     
-    glBegin(GL_QUADS);
+    body.begin(Mesh::Primitive::QUADS);
     // Left wing - top
-    glNormal3f(0, 1, 0);
-    glVertex3f(-fuselageWidth, 0, -wingChord * 0.3f);
-    glVertex3f(-wingspan * 0.5f, 0, 0);
-    glVertex3f(-wingspan * 0.5f, 0, wingChord * 0.7f);
-    glVertex3f(-fuselageWidth, 0, wingChord * 0.7f);
+    body.normal(0, 1, 0);
+    body.vertex(-fuselageWidth, 0, -wingChord * 0.3f);
+    body.vertex(-wingspan * 0.5f, 0, 0);
+    body.vertex(-wingspan * 0.5f, 0, wingChord * 0.7f);
+    body.vertex(-fuselageWidth, 0, wingChord * 0.7f);
     
     // Left wing - bottom
-    glNormal3f(0, -1, 0);
-    glVertex3f(-fuselageWidth, -wingThickness, -wingChord * 0.3f);
-    glVertex3f(-fuselageWidth, -wingThickness, wingChord * 0.7f);
-    glVertex3f(-wingspan * 0.5f, -wingThickness * 0.3f, wingChord * 0.7f);
-    glVertex3f(-wingspan * 0.5f, -wingThickness * 0.3f, 0);
+    body.normal(0, -1, 0);
+    body.vertex(-fuselageWidth, -wingThickness, -wingChord * 0.3f);
+    body.vertex(-fuselageWidth, -wingThickness, wingChord * 0.7f);
+    body.vertex(-wingspan * 0.5f, -wingThickness * 0.3f, wingChord * 0.7f);
+    body.vertex(-wingspan * 0.5f, -wingThickness * 0.3f, 0);
     
     // Right wing - top
-    glNormal3f(0, 1, 0);
-    glVertex3f(fuselageWidth, 0, -wingChord * 0.3f);
-    glVertex3f(fuselageWidth, 0, wingChord * 0.7f);
-    glVertex3f(wingspan * 0.5f, 0, wingChord * 0.7f);
-    glVertex3f(wingspan * 0.5f, 0, 0);
+    body.normal(0, 1, 0);
+    body.vertex(fuselageWidth, 0, -wingChord * 0.3f);
+    body.vertex(fuselageWidth, 0, wingChord * 0.7f);
+    body.vertex(wingspan * 0.5f, 0, wingChord * 0.7f);
+    body.vertex(wingspan * 0.5f, 0, 0);
     
     // Right wing - bottom
-    glNormal3f(0, -1, 0);
-    glVertex3f(fuselageWidth, -wingThickness, -wingChord * 0.3f);
-    glVertex3f(wingspan * 0.5f, -wingThickness * 0.3f, 0);
-    glVertex3f(wingspan * 0.5f, -wingThickness * 0.3f, wingChord * 0.7f);
-    glVertex3f(fuselageWidth, -wingThickness, wingChord * 0.7f);
-    glEnd();
+    body.normal(0, -1, 0);
+    body.vertex(fuselageWidth, -wingThickness, -wingChord * 0.3f);
+    body.vertex(wingspan * 0.5f, -wingThickness * 0.3f, 0);
+    body.vertex(wingspan * 0.5f, -wingThickness * 0.3f, wingChord * 0.7f);
+    body.vertex(fuselageWidth, -wingThickness, wingChord * 0.7f);
+    body.end();
     
     // Tail (vertical stabilizer)
-    glColor4f(primaryColor.r, primaryColor.g, primaryColor.b, primaryColor.a);
+    body.color(primaryColor);
     
     float tailHeight = length * 0.2f;
     float tailWidth = 0.2f;
     
-    glBegin(GL_TRIANGLES);
-    glNormal3f(1, 0, 0);
-    glVertex3f(tailWidth, fuselageHeight, length * 0.3f);
-    glVertex3f(tailWidth, fuselageHeight + tailHeight, length * 0.45f);
-    glVertex3f(tailWidth, fuselageHeight, length * 0.5f);
+    body.begin(Mesh::Primitive::TRIANGLES);
+    body.normal(1, 0, 0);
+    body.vertex(tailWidth, fuselageHeight, length * 0.3f);
+    body.vertex(tailWidth, fuselageHeight + tailHeight, length * 0.45f);
+    body.vertex(tailWidth, fuselageHeight, length * 0.5f);
     
-    glNormal3f(-1, 0, 0);
-    glVertex3f(-tailWidth, fuselageHeight, length * 0.3f);
-    glVertex3f(-tailWidth, fuselageHeight, length * 0.5f);
-    glVertex3f(-tailWidth, fuselageHeight + tailHeight, length * 0.45f);
-    glEnd();
+    body.normal(-1, 0, 0);
+    body.vertex(-tailWidth, fuselageHeight, length * 0.3f);
+    body.vertex(-tailWidth, fuselageHeight, length * 0.5f);
+    body.vertex(-tailWidth, fuselageHeight + tailHeight, length * 0.45f);
+    body.end();
     
     // Horizontal stabilizers
-    glBegin(GL_QUADS);
+    body.begin(Mesh::Primitive::QUADS);
     float stabSpan = wingspan * 0.35f;
     float stabChord = length * 0.12f;
     
     // Left stabilizer
-    glNormal3f(0, 1, 0);
-    glVertex3f(-fuselageWidth, fuselageHeight * 0.8f, length * 0.35f);
-    glVertex3f(-stabSpan, fuselageHeight * 0.8f, length * 0.4f);
-    glVertex3f(-stabSpan, fuselageHeight * 0.8f, length * 0.4f + stabChord);
-    glVertex3f(-fuselageWidth, fuselageHeight * 0.8f, length * 0.35f + stabChord);
+    body.normal(0, 1, 0);
+    body.vertex(-fuselageWidth, fuselageHeight * 0.8f, length * 0.35f);
+    body.vertex(-stabSpan, fuselageHeight * 0.8f, length * 0.4f);
+    body.vertex(-stabSpan, fuselageHeight * 0.8f, length * 0.4f + stabChord);
+    body.vertex(-fuselageWidth, fuselageHeight * 0.8f, length * 0.35f + stabChord);
     
     // Right stabilizer
-    glNormal3f(0, 1, 0);
-    glVertex3f(fuselageWidth, fuselageHeight * 0.8f, length * 0.35f);
-    glVertex3f(fuselageWidth, fuselageHeight * 0.8f, length * 0.35f + stabChord);
-    glVertex3f(stabSpan, fuselageHeight * 0.8f, length * 0.4f + stabChord);
-    glVertex3f(stabSpan, fuselageHeight * 0.8f, length * 0.4f);
-    glEnd();
-    
-    // ===== LANDING GEAR (Animated) =====
-    if (gearState > 0.01f) {  // Only draw if gear is at least slightly extended
-        glColor4f(0.2f, 0.2f, 0.2f, 1.0f);  // Dark grey
-        
-        float gearLength = length * 0.12f * gearState;  // Animated length
-        float gearWidth = length * 0.015f;
-        float wheelRadius = length * 0.03f * gearState;
-        
-        // Front gear (nose gear)
-        float noseGearZ = -length * 0.35f;
-        float gearAngle = (1.0f - gearState) * 90.0f;  // Rotates up when retracting
+    body.normal(0, 1, 0);
+    body.vertex(fuselageWidth, fuselageHeight * 0.8f, length * 0.35f);
+    body.vertex(fuselageWidth, fuselageHeight * 0.8f, length * 0.35f + stabChord);
+    body.vertex(stabSpan, fuselageHeight * 0.8f, length * 0.4f + stabChord);
+    body.vertex(stabSpan, fuselageHeight * 0.8f, length * 0.4f);
+    body.end();
+    
+    body.upload(glState);
+    
+    // ===== LANDING GEAR =====
+    // Built fully extended; buildAircraftList folds and shortens them
+    Color strutColor(0.2f, 0.2f, 0.2f, 1.0f);   // Dark grey
+    Color wheelColor(0.1f, 0.1f, 0.1f, 1.0f);   // Black wheel
+    
+    float gearLength = length * 0.12f;
+    float gearWidth = length * 0.015f;
+    float wheelRadius = length * 0.03f;
+    
+    // Front gear (nose gear)
+    GearLeg& nose = mesh.gear[0];
+    nose.mount = Vector3(0, -fuselageHeight, -length * 0.35f);
+    nose.strutLength = gearLength;
+    
+    nose.strut.color(strutColor);
+    nose.strut.begin(Mesh::Primitive::QUADS);
+    nose.strut.normal(0, 0, 1);
+    nose.strut.vertex(-gearWidth, 0, 0);
+    nose.strut.vertex(gearWidth, 0, 0);
+    nose.strut.vertex(gearWidth, -gearLength, 0);
+    nose.strut.vertex(-gearWidth, -gearLength, 0);
+    nose.strut.end();
+    
+    // Wheel (simple box for now)
+    nose.wheel.color(wheelColor);
+    nose.wheel.normal(0, 0, 1);
+    nose.wheel.begin(Mesh::Primitive::QUADS);
+    // Front
+    nose.wheel.vertex(-wheelRadius, -wheelRadius * 0.5f, wheelRadius * 0.3f);
+    nose.wheel.vertex(wheelRadius, -wheelRadius * 0.5f, wheelRadius * 0.3f);
+    nose.wheel.vertex(wheelRadius, wheelRadius * 0.5f, wheelRadius * 0.3f);
+    nose.wheel.vertex(-wheelRadius, wheelRadius * 0.5f, wheelRadius * 0.3f);
+    // Back
+    nose.wheel.vertex(-wheelRadius, -wheelRadius * 0.5f, -wheelRadius * 0.3f);
+    nose.wheel.vertex(-wheelRadius, wheelRadius * 0.5f, -wheelRadius * 0.3f);
+    nose.wheel.vertex(wheelRadius, wheelRadius * 0.5f, -wheelRadius * 0.3f);
+    nose.wheel.vertex(wheelRadius, -wheelRadius * 0.5f, -wheelRadius * 0.3f);
+    nose.wheel.end();
+    
+    // Main gear, left (side -1) and right (side 1)
+    float mainGearX = wingspan * 0.15f;
+    float mainGearZ = length * 0.05f;
+    
+    for (int i = 1; i <= 2; i++) {
+        float side = (i == 1) ? -1.0f : 1.0f;
+        GearLeg& leg = mesh.gear[i];
+        leg.mount = Vector3(side * mainGearX, -fuselageHeight, mainGearZ);
+        leg.strutLength = gearLength * 1.2f;
         
-        glPushMatrix();
-        glTranslatef(0, -fuselageHeight, noseGearZ);
-        glRotatef(gearAngle, 1, 0, 0);  // Rotate to fold up
+        // Strut faces outboard
+        leg.strut.color(strutColor);
+        leg.strut.normal(-side, 0, 0);
+        leg.strut.begin(Mesh::Primitive::QUADS);
+        leg.strut.vertex(0, 0, side * gearWidth);
+        leg.strut.vertex(0, 0, -side * gearWidth);
+        leg.strut.vertex(0, -leg.strutLength, -side * gearWidth);
+        leg.strut.vertex(0, -leg.strutLength, side * gearWidth);
+        leg.strut.end();
         
-        // Strut
-        glBegin(GL_QUADS);
-        glNormal3f(0, 0, 1);
-        glVertex3f(-gearWidth, 0, 0);
-        glVertex3f(gearWidth, 0, 0);
-        glVertex3f(gearWidth, -gearLength, 0);
-        glVertex3f(-gearWidth, -gearLength, 0);
-        glEnd();
+        leg.wheel.color(wheelColor);
+        leg.wheel.normal(-side, 0, 0);
+        leg.wheel.begin(Mesh::Primitive::QUADS);
+        leg.wheel.vertex(-wheelRadius * 0.5f, -wheelRadius, wheelRadius);
+        leg.wheel.vertex(wheelRadius * 0.5f, -wheelRadius, wheelRadius);
+        leg.wheel.vertex(wheelRadius * 0.5f, wheelRadius, wheelRadius);
+        leg.wheel.vertex(-wheelRadius * 0.5f, wheelRadius, wheelRadius);
+        leg.wheel.vertex(-wheelRadius * 0.5f, -wheelRadius, -wheelRadius);
+        leg.wheel.vertex(-wheelRadius * 0.5f, wheelRadius, -wheelRadius);
+        leg.wheel.vertex(wheelRadius * 0.5f, wheelRadius, -wheelRadius);
+        leg.wheel.vertex(wheelRadius * 0.5f, -wheelRadius, -wheelRadius);
+        leg.wheel.end();
+    }
+    
+    for (GearLeg& leg : mesh.gear) {
+        leg.strut.upload(glState);
+        leg.wheel.upload(glState);
+    }
+    
+    // ===== FLAPS =====
+    // One surface, hinged at its leading edge and placed on both wings
+    float flapWidth = wingspan * 0.15f;
+    float flapChord = length * 0.08f;
+    float flapThickness = 0.15f;
+    
+    mesh.flapMounts[0] = Vector3(-wingspan * 0.25f, -0.2f, length * 0.08f);
+    mesh.flapMounts[1] = Vector3(wingspan * 0.25f, -0.2f, length * 0.08f);
+    
+    Mesh& flap = mesh.flap;
+    flap.color(Color(secondaryColor.r * 0.8f, secondaryColor.g * 0.8f, secondaryColor.b * 0.8f, 1.0f));
+    flap.begin(Mesh::Primitive::QUADS);
+    // Top
+    flap.normal(0, 1, 0);
+    flap.vertex(-flapWidth * 0.5f, 0, 0);
+    flap.vertex(flapWidth * 0.5f, 0, 0);
+    flap.vertex(flapWidth * 0.5f, 0, flapChord);
+    flap.vertex(-flapWidth * 0.5f, 0, flapChord);
+    // Bottom
+    flap.normal(0, -1, 0);
+    flap.vertex(-flapWidth * 0.5f, -flapThickness, 0);
+    flap.vertex(-flapWidth * 0.5f, -flapThickness, flapChord);
+    flap.vertex(flapWidth * 0.5f, -flapThickness, flapChord);
+    flap.vertex(flapWidth * 0.5f, -flapThickness, 0);
+    flap.end();
+    flap.upload(glState);
+}
+
+const Renderer::AircraftMesh& Renderer::getAircraftMesh(AircraftType type, const AircraftSpecs& specs) {
+    std::unique_ptr<AircraftMesh>& mesh = aircraftMeshes[(int)type];
+    if (!mesh) {
+        mesh.reset(new AircraftMesh());
+        buildAircraftMesh(*mesh, specs.wingSpan, specs.length, specs.primaryColor, specs.secondaryColor);
+        loadAircraftModel(*mesh, type, specs);
         
-        // Wheel (simple box for now)
-        glColor4f(0.1f, 0.1f, 0.1f, 1.0f);  // Black wheel
-        glTranslatef(0, -gearLength, 0);
-        glBegin(GL_QUADS);
-        // Front
-        glVertex3f(-wheelRadius, -wheelRadius * 0.5f, wheelRadius * 0.3f);
-        glVertex3f(wheelRadius, -wheelRadius * 0.5f, wheelRadius * 0.3f);
-        glVertex3f(wheelRadius, wheelRadius * 0.5f, wheelRadius * 0.3f);
-        glVertex3f(-wheelRadius, wheelRadius * 0.5f, wheelRadius * 0.3f);
-        // Back
-        glVertex3f(-wheelRadius, -wheelRadius * 0.5f, -wheelRadius * 0.3f);
-        glVertex3f(-wheelRadius, wheelRadius * 0.5f, -wheelRadius * 0.3f);
-        glVertex3f(wheelRadius, wheelRadius * 0.5f, -wheelRadius * 0.3f);
-        glVertex3f(wheelRadius, -wheelRadius * 0.5f, -wheelRadius * 0.3f);
-        glEnd();
-        glPopMatrix();
+        // Bounding sphere covers wings, nose cone and tail
+        mesh->radius = std::max(specs.wingSpan, specs.length) * 0.75f;
+        buildReducedAircraftMesh(*mesh, specs.primaryColor, specs.secondaryColor);
+        buildAircraftImpostor(*mesh);
+    }
+    return *mesh;
+}
+
+void Renderer::buildReducedAircraftMesh(AircraftMesh& mesh, const Color& primaryColor, const Color& secondaryColor) {
+    // The body's outline from boxes and single-sided surfaces: the fuselage
+    // without its nose cone, both wings as one plate, one tail fin
+    float length = mesh.length;
+    float halfSpan = mesh.wingspan * 0.5f;
+    float fuselageWidth = length * 0.08f;
+    float fuselageHeight = length * 0.1f;
+    float wingChord = length * 0.25f;
+    float front = -length * 0.6f;       // Halfway along the nose cone
+    float back = length * 0.5f;
+    
+    Mesh& reduced = mesh.reduced;
+    reduced.color(primaryColor);
+    reduced.begin(Mesh::Primitive::QUADS);
+    reduced.normal(0, 1, 0);
+    reduced.vertex(-fuselageWidth, fuselageHeight, front);
+    reduced.vertex(fuselageWidth, fuselageHeight, front);
+    reduced.vertex(fuselageWidth, fuselageHeight, back);
+    reduced.vertex(-fuselageWidth, fuselageHeight, back);
+    
+    reduced.normal(0, -1, 0);
+    reduced.vertex(-fuselageWidth, -fuselageHeight, front);
+    reduced.vertex(-fuselageWidth, -fuselageHeight, back);
+    reduced.vertex(fuselageWidth, -fuselageHeight, back);
+    reduced.vertex(fuselageWidth, -fuselageHeight, front);
+    
+    reduced.normal(-1, 0, 0);
+    reduced.vertex(-fuselageWidth, -fuselageHeight, front);
+    reduced.vertex(-fuselageWidth, fuselageHeight, front);
+    reduced.vertex(-fuselageWidth, fuselageHeight, back);
+    reduced.vertex(-fuselageWidth, -fuselageHeight, back);
+    
+    reduced.normal(1, 0, 0);
+    reduced.vertex(fuselageWidth, -fuselageHeight, front);
+    reduced.vertex(fuselageWidth, -fuselageHeight, back);
+    reduced.vertex(fuselageWidth, fuselageHeight, back);
+    reduced.vertex(fuselageWidth, fuselageHeight, front);
+    
+    // Tail fin, seen from either side
+    float tailHeight = length * 0.2f;
+    reduced.normal(1, 0, 0);
+    reduced.vertex(0, fuselageHeight, length * 0.3f);
+    reduced.vertex(0, fuselageHeight, back);
+    reduced.vertex(0, fuselageHeight + tailHeight, back);
+    reduced.vertex(0, fuselageHeight + tailHeight, length * 0.45f);
+    reduced.normal(-1, 0, 0);
+    reduced.vertex(0, fuselageHeight, length * 0.3f);
+    reduced.vertex(0, fuselageHeight + tailHeight, length * 0.45f);
+    reduced.vertex(0, fuselageHeight + tailHeight, back);
+    reduced.vertex(0, fuselageHeight, back);
+    
+    reduced.color(secondaryColor);
+    reduced.normal(0, 1, 0);
+    reduced.vertex(-halfSpan, 0, 0);
+    reduced.vertex(halfSpan, 0, 0);
+    reduced.vertex(halfSpan, 0, wingChord * 0.7f);
+    reduced.vertex(-halfSpan, 0, wingChord * 0.7f);
+    reduced.normal(0, -1, 0);
+    reduced.vertex(-halfSpan, 0, 0);
+    reduced.vertex(-halfSpan, 0, wingChord * 0.7f);
+    reduced.vertex(halfSpan, 0, wingChord * 0.7f);
+    reduced.vertex(halfSpan, 0, 0);
+    reduced.end();
+    
+    reduced.upload(glState);
+}
+
+void Renderer::buildAircraftImpostor(AircraftMesh& mesh) {
+    if (!GLExt::hasFramebuffer || !mesh.body.isUploaded()) return;
+    
+    int width = kImpostorYaws * kImpostorFrameSize;
+    int height = kImpostorPitches * kImpostorFrameSize;
+    
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, kImpostorMipLevels);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    
+    GLuint depthBuffer;
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    
+    GLuint framebuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status == GL_FRAMEBUFFER_COMPLETE) {
+        glViewport(0, 0, width, height);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         
-        // Left main gear
-        float mainGearX = wingspan * 0.15f;
-        float mainGearZ = length * 0.05f;
+        // Fixed-function lighting with the sun high and ahead of the aircraft;
+        // the frames keep it whatever the aircraft's attitude
+        glState.useProgram(0);
+        glState.enable(GL_LIGHTING);
+        glState.disable(GL_FOG);
+        glState.disable(GL_TEXTURE_2D);
+        glState.enable(GL_DEPTH_TEST);
+        glState.depthMask(true);
+        GLfloat lightDirection[] = { 0.3f, 1.0f, -0.4f, 0.0f };
         
-        glColor4f(0.2f, 0.2f, 0.2f, 1.0f);
+        // Orthographic, the camera 2 radii out, so every frame is to scale
+        float r = mesh.radius;
+        glState.matrixMode(GL_PROJECTION);
         glPushMatrix();
-        glTranslatef(-mainGearX, -fuselageHeight, mainGearZ);
-        glRotatef(gearAngle, 1, 0, 0);
-        
-        glBegin(GL_QUADS);
-        glNormal3f(1, 0, 0);
-        glVertex3f(0, 0, -gearWidth);
-        glVertex3f(0, 0, gearWidth);
-        glVertex3f(0, -gearLength * 1.2f, gearWidth);
-        glVertex3f(0, -gearLength * 1.2f, -gearWidth);
-        glEnd();
-        
-        // Left wheel
-        glColor4f(0.1f, 0.1f, 0.1f, 1.0f);
-        glTranslatef(0, -gearLength * 1.2f, 0);
-        glBegin(GL_QUADS);
-        glVertex3f(-wheelRadius * 0.5f, -wheelRadius, wheelRadius);
-        glVertex3f(wheelRadius * 0.5f, -wheelRadius, wheelRadius);
-        glVertex3f(wheelRadius * 0.5f, wheelRadius, wheelRadius);
-        glVertex3f(-wheelRadius * 0.5f, wheelRadius, wheelRadius);
-        glVertex3f(-wheelRadius * 0.5f, -wheelRadius, -wheelRadius);
-        glVertex3f(-wheelRadius * 0.5f, wheelRadius, -wheelRadius);
-        glVertex3f(wheelRadius * 0.5f, wheelRadius, -wheelRadius);
-        glVertex3f(wheelRadius * 0.5f, -wheelRadius, -wheelRadius);
-        glEnd();
-        glPopMatrix();
-        
-        // Right main gear
-        glColor4f(0.2f, 0.2f, 0.2f, 1.0f);
+        glLoadIdentity();
+        glOrtho(-r, r, -r, r, r, 3.0f * r);
+        glState.matrixMode(GL_MODELVIEW);
         glPushMatrix();
-        glTranslatef(mainGearX, -fuselageHeight, mainGearZ);
-        glRotatef(gearAngle, 1, 0, 0);
         
-        glBegin(GL_QUADS);
-        glNormal3f(-1, 0, 0);
-        glVertex3f(0, 0, gearWidth);
-        glVertex3f(0, 0, -gearWidth);
-        glVertex3f(0, -gearLength * 1.2f, -gearWidth);
-        glVertex3f(0, -gearLength * 1.2f, gearWidth);
-        glEnd();
+        float pitchStep = 2.0f * kImpostorMaxPitch / (kImpostorPitches - 1);
+        for (int row = 0; row < kImpostorPitches; row++) {
+            float pitch = (-kImpostorMaxPitch + row * pitchStep) * DEG_TO_RAD;
+            for (int column = 0; column < kImpostorYaws; column++) {
+                float yaw = column * 2.0f * PI / kImpostorYaws;
+                Vector3 direction(std::cos(pitch) * std::sin(yaw), std::sin(pitch), std::cos(pitch) * std::cos(yaw));
+                Matrix4 view = Matrix4::lookAt(direction * (2.0f * r), Vector3(), Vector3(0, 1, 0));
+                glLoadMatrixf(view.m);
+                glLightfv(GL_LIGHT0, GL_POSITION, lightDirection);
+                
+                glViewport(column * kImpostorFrameSize, row * kImpostorFrameSize, kImpostorFrameSize, kImpostorFrameSize);
+                mesh.body.draw(glState);
+            }
+        }
         
-        // Right wheel
-        glColor4f(0.1f, 0.1f, 0.1f, 1.0f);
-        glTranslatef(0, -gearLength * 1.2f, 0);
-        glBegin(GL_QUADS);
-        glVertex3f(-wheelRadius * 0.5f, -wheelRadius, wheelRadius);
-        glVertex3f(wheelRadius * 0.5f, -wheelRadius, wheelRadius);
-        glVertex3f(wheelRadius * 0.5f, wheelRadius, wheelRadius);
-        glVertex3f(-wheelRadius * 0.5f, wheelRadius, wheelRadius);
-        glVertex3f(-wheelRadius * 0.5f, -wheelRadius, -wheelRadius);
-        glVertex3f(-wheelRadius * 0.5f, wheelRadius, -wheelRadius);
-        glVertex3f(wheelRadius * 0.5f, wheelRadius, -wheelRadius);
-        glVertex3f(wheelRadius * 0.5f, -wheelRadius, -wheelRadius);
-        glEnd();
         glPopMatrix();
-    }
-    
-    // ===== FLAPS (Animated) =====
-    if (flapsState > 0.01f) {
-        glColor4f(secondaryColor.r * 0.8f, secondaryColor.g * 0.8f, secondaryColor.b * 0.8f, 1.0f);
-        
-        float flapAngle = flapsState * 30.0f;  // Max 30 degree deflection
-        float flapWidth = wingspan * 0.15f;
-        float flapChord = length * 0.08f;
-        float flapThickness = 0.15f;
-        
-        // Left wing flap
-        glPushMatrix();
-        glTranslatef(-wingspan * 0.25f, -0.2f, length * 0.08f);
-        glRotatef(flapAngle, 1, 0, 0);  // Rotate down
-        
-        glBegin(GL_QUADS);
-        // Top
-        glNormal3f(0, 1, 0);
-        glVertex3f(-flapWidth * 0.5f, 0, 0);
-        glVertex3f(flapWidth * 0.5f, 0, 0);
-        glVertex3f(flapWidth * 0.5f, 0, flapChord);
-        glVertex3f(-flapWidth * 0.5f, 0, flapChord);
-        // Bottom
-        glNormal3f(0, -1, 0);
-        glVertex3f(-flapWidth * 0.5f, -flapThickness, 0);
-        glVertex3f(-flapWidth * 0.5f, -flapThickness, flapChord);
-        glVertex3f(flapWidth * 0.5f, -flapThickness, flapChord);
-        glVertex3f(flapWidth * 0.5f, -flapThickness, 0);
-        glEnd();
+        glState.matrixMode(GL_PROJECTION);
         glPopMatrix();
+        glState.matrixMode(GL_MODELVIEW);
+        glState.disable(GL_NORMALIZE);
         
-        // Right wing flap
-        glPushMatrix();
-        glTranslatef(wingspan * 0.25f, -0.2f, length * 0.08f);
-        glRotatef(flapAngle, 1, 0, 0);
-        
-        glBegin(GL_QUADS);
-        glNormal3f(0, 1, 0);
-        glVertex3f(-flapWidth * 0.5f, 0, 0);
-        glVertex3f(flapWidth * 0.5f, 0, 0);
-        glVertex3f(flapWidth * 0.5f, 0, flapChord);
-        glVertex3f(-flapWidth * 0.5f, 0, flapChord);
-        glNormal3f(0, -1, 0);
-        glVertex3f(-flapWidth * 0.5f, -flapThickness, 0);
-        glVertex3f(-flapWidth * 0.5f, -flapThickness, flapChord);
-        glVertex3f(flapWidth * 0.5f, -flapThickness, flapChord);
-        glVertex3f(flapWidth * 0.5f, -flapThickness, 0);
-        glEnd();
-        glPopMatrix();
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        mesh.impostorTexture = texture;
+    } else {
+        std::cerr << "Impostor framebuffer incomplete: 0x" << std::hex << status << std::dec << std::endl;
+        glDeleteTextures(1, &texture);
     }
     
-    glPopMatrix();
+    glBindFramebuffer(GL_FRAMEBUFFER, offscreenFramebuffer);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    glViewport(0, 0, screenWidth, screenHeight);
+    glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+}
+
+void Renderer::releaseAircraftMeshes() {
+    for (auto& entry : aircraftMeshes) {
+        if (entry.second->impostorTexture) {
+            glDeleteTextures(1, &entry.second->impostorTexture);
+        }
+    }
+    aircraftMeshes.clear();
+    aircraftLods.clear();
 }
 
-void Renderer::renderAircraft(const Aircraft* aircraft, const Camera* camera) {
-    if (!aircraft) return;
+Renderer::AircraftLod Renderer::selectAircraftLod(float pixels, const AircraftLodState& state, int view,
+                                                  bool hasImpostor) {
+    // On-screen radius at which each level gives way to the next coarser one
+    const float thresholds[] = { kAircraftReducedPixels, kAircraftImpostorPixels };
+    int coarsest = hasImpostor ? (int)AircraftLod::IMPOSTOR : (int)AircraftLod::REDUCED;
+    
+    if (!(state.known & (1u << view))) {
+        int level = 0;
+        while (level < coarsest && pixels < thresholds[level]) level++;
+        return (AircraftLod)level;
+    }
     
-    const AircraftSpecs& specs = aircraft->getSpecs();
+    int level = std::min((int)state.levels[view], coarsest);
+    while (level > 0 && pixels > thresholds[level - 1] * (1.0f + kAircraftLodHysteresis)) level--;
+    while (level < coarsest && pixels < thresholds[level] * (1.0f - kAircraftLodHysteresis)) level++;
+    return (AircraftLod)level;
+}
+
+void Renderer::loadAircraftModel(AircraftMesh& mesh, AircraftType type, const AircraftSpecs& specs) {
+    static const char* const kModelNames[] = {"boeing737", "f16", "f22", "cessna172", "a320"};
+    std::string path = std::string("assets/aircraft/") + kModelNames[(int)type] + ".obj";
+    
+    // The procedural body stays when there is no model
+    ModelFile model;
+    if (!model.load(path, specs.primaryColor)) return;
+    
+    // Models are +y up, nose towards -z and right wing towards +x, in any
+    // unit: center them and scale them to the aircraft's length
+    Vector3 boundsMin = model.getBoundsMin();
+    Vector3 boundsMax = model.getBoundsMax();
+    float modelLength = boundsMax.z - boundsMin.z;
+    float fit = modelLength > 0.0f ? specs.length / modelLength : 1.0f;
+    Vector3 center = (boundsMin + boundsMax) * 0.5f;
+    Vector3 offset = (model.getOffset() - center) * fit;
+    
+    if (!mesh.body.uploadQuantized(glState, model.getVertices(), model.getVertexCount(), model.getIndices(),
+                                   model.getIndexCount(), model.getIndexSize(), offset, model.getScale() * fit)) {
+        buildAircraftMesh(mesh, specs.wingSpan, specs.length, specs.primaryColor, specs.secondaryColor);
+        return;
+    }
     
-    renderPlane3D(
-        aircraft->getPosition(),
-        aircraft->getRotation(),
-        specs.wingSpan,
-        specs.length,
-        specs.primaryColor,
-        specs.secondaryColor,
-        aircraft->getGearAnimationState(),
-        aircraft->getFlapsAnimationState()
-    );
+    std::cout << "Loaded " << path << " (" << model.getIndexCount() / 3 << " triangles, "
+              << (model.wasCached() ? "mapped from cache" : "converted") << ")" << std::endl;
 }
 
-void Renderer::renderTerrain(const Terrain* terrain, const Camera* camera) {
-    if (!terrain) return;
+void Renderer::buildAircraftList(const Aircraft& aircraft, const AircraftMesh& mesh, AircraftLodState& lod,
+                                 RenderList& list) const {
+    const Vector3& position = aircraft.getPosition();
+    uint32_t views = 0;
+    for (size_t v = 0; v < viewStates.size(); v++) {
+        if (viewStates[v].frustum.intersectsSphere(position, mesh.radius)) {
+            views |= 1u << v;
+        }
+    }
     
-    // Render terrain chunks
-    const auto& chunks = terrain->getChunks();
+    if (!views) {
+        list.objectsCulled++;
+        return;
+    }
+    list.objectsVisible++;
+    
+    Vector3 rotation = aircraft.getRotation();
+    Matrix4 model = Matrix4::translation(position) *
+                    Matrix4::rotationY(rotation.y) *    // Yaw
+                    Matrix4::rotationX(rotation.x) *    // Pitch
+                    Matrix4::rotationZ(rotation.z);     // Roll
+    
+    // Level of detail in each view from the on-screen radius
+    uint32_t levelViews[3] = {};
+    for (size_t v = 0; v < viewStates.size(); v++) {
+        if (!(views & (1u << v))) continue;
+        const ViewState& view = viewStates[v];
+        float distance = std::max((position - view.eye).length(), 0.01f);
+        float pixels = mesh.radius * view.projection.m[5] * view.viewport[3] * 0.5f / distance;
+        
+        AircraftLod level = selectAircraftLod(pixels, lod, (int)v, mesh.impostorTexture != 0);
+        lod.levels[v] = level;
+        lod.known |= 1u << v;
+        levelViews[(int)level] |= 1u << v;
+        list.aircraftLods[(int)level]++;
+    }
     
-    if (chunks.empty()) {
-        // Fallback: render simple ground plane
-        glColor4f(0.2f, 0.5f, 0.2f, 1.0f);
-        glBegin(GL_QUADS);
-        glNormal3f(0, 1, 0);
-        glVertex3f(-5000, 0, -5000);
-        glVertex3f(5000, 0, -5000);
-        glVertex3f(5000, 0, 5000);
-        glVertex3f(-5000, 0, 5000);
-        glEnd();
-    } else {
-        // Render each chunk's terrain mesh
-        glBegin(GL_TRIANGLES);
-        for (const auto& [coord, chunk] : chunks) {
-            if (!chunk || !chunk->generated) continue;
+    if (levelViews[(int)AircraftLod::REDUCED]) {
+        queueMesh(list, {&mesh.reduced, model, false, levelViews[(int)AircraftLod::REDUCED]});
+    }
+    
+    if (levelViews[(int)AircraftLod::IMPOSTOR]) {
+        // The aircraft's axes in world space
+        const float* m = model.m;
+        Vector3 right(m[0], m[1], m[2]);
+        Vector3 up(m[4], m[5], m[6]);
+        Vector3 back(m[8], m[9], m[10]);
+        float pitchStep = 2.0f * kImpostorMaxPitch / (kImpostorPitches - 1);
+        float r = mesh.radius;
+        
+        for (size_t v = 0; v < viewStates.size(); v++) {
+            if (!(levelViews[(int)AircraftLod::IMPOSTOR] & (1u << v))) continue;
+            Vector3 toEye = viewStates[v].eye - position;
+            float distance = toEye.length();
+            toEye = toEye * (1.0f / std::max(distance, 0.01f));
             
-            int chunkSize = terrain->getChunkSize();
-            const auto& vertices = chunk->vertices;
-            const auto& normals = chunk->normals;
-            const auto& colors = chunk->colors;
+            // The frame rendered from the nearest direction, in the aircraft's frame
+            float yaw = std::atan2(Vector3::dot(toEye, right), Vector3::dot(toEye, back));
+            float pitch = std::asin(std::max(-1.0f, std::min(1.0f, Vector3::dot(toEye, up)))) * RAD_TO_DEG;
+            int column = ((int)std::lround(yaw * kImpostorYaws / (2.0f * PI)) % kImpostorYaws + kImpostorYaws) %
+                         kImpostorYaws;
+            int row = std::max(0, std::min(kImpostorPitches - 1,
+                                           (int)std::lround((pitch + kImpostorMaxPitch) / pitchStep)));
             
-            // Render chunk as grid of triangles
-            for (int z = 0; z < chunkSize - 1; z++) {
-                for (int x = 0; x < chunkSize - 1; x++) {
-                    int idx = z * chunkSize + x;
-                    
-                    // First triangle
-                    if (idx < (int)vertices.size() && idx < (int)colors.size()) {
-                        glColor4f(colors[idx].r, colors[idx].g, colors[idx].b, colors[idx].a);
-                        glNormal3f(normals[idx].x, normals[idx].y, normals[idx].z);
-                        glVertex3f(vertices[idx].x, vertices[idx].y, vertices[idx].z);
-                    }
-                    
-                    int idx2 = (z + 1) * chunkSize + x;
-                    if (idx2 < (int)vertices.size() && idx2 < (int)colors.size()) {
-                        glColor4f(colors[idx2].r, colors[idx2].g, colors[idx2].b, colors[idx2].a);
-                        glNormal3f(normals[idx2].x, normals[idx2].y, normals[idx2].z);
-                        glVertex3f(vertices[idx2].x, vertices[idx2].y, vertices[idx2].z);
-                    }
-                    
-                    int idx3 = z * chunkSize + (x + 1);
-                    if (idx3 < (int)vertices.size() && idx3 < (int)colors.size()) {
-                        glColor4f(colors[idx3].r, colors[idx3].g, colors[idx3].b, colors[idx3].a);
-                        glNormal3f(normals[idx3].x, normals[idx3].y, normals[idx3].z);
-                        glVertex3f(vertices[idx3].x, vertices[idx3].y, vertices[idx3].z);
-                    }
-                    
-                    // Second triangle
-                    if (idx3 < (int)vertices.size() && idx3 < (int)colors.size()) {
-                        glColor4f(colors[idx3].r, colors[idx3].g, colors[idx3].b, colors[idx3].a);
-                        glNormal3f(normals[idx3].x, normals[idx3].y, normals[idx3].z);
-                        glVertex3f(vertices[idx3].x, vertices[idx3].y, vertices[idx3].z);
-                    }
-                    
-                    if (idx2 < (int)vertices.size() && idx2 < (int)colors.size()) {
-                        glColor4f(colors[idx2].r, colors[idx2].g, colors[idx2].b, colors[idx2].a);
-                        glNormal3f(normals[idx2].x, normals[idx2].y, normals[idx2].z);
-                        glVertex3f(vertices[idx2].x, vertices[idx2].y, vertices[idx2].z);
-                    }
-                    
-                    int idx4 = (z + 1) * chunkSize + (x + 1);
-                    if (idx4 < (int)vertices.size() && idx4 < (int)colors.size()) {
-                        glColor4f(colors[idx4].r, colors[idx4].g, colors[idx4].b, colors[idx4].a);
-                        glNormal3f(normals[idx4].x, normals[idx4].y, normals[idx4].z);
-                        glVertex3f(vertices[idx4].x, vertices[idx4].y, vertices[idx4].z);
-                    }
-                }
+            // Facing the eye, turned so the frame's up is the aircraft's up as
+            // seen from there, like the camera the frame was rendered with
+            Vector3 quadUp = up - toEye * Vector3::dot(up, toEye);
+            if (quadUp.length() < 0.01f) quadUp = back - toEye * Vector3::dot(back, toEye);
+            quadUp = quadUp.normalized() * r;
+            Vector3 quadRight = Vector3::cross(quadUp, toEye).normalized() * r;
+            
+            float s0 = (float)column / kImpostorYaws;
+            float s1 = (float)(column + 1) / kImpostorYaws;
+            float t0 = (float)row / kImpostorPitches;
+            float t1 = (float)(row + 1) / kImpostorPitches;
+            Vector3 corners[4] = {
+                position - quadRight - quadUp, position + quadRight - quadUp,
+                position + quadRight + quadUp, position - quadRight + quadUp
+            };
+            float texCoords[4][2] = { {s0, t0}, {s1, t0}, {s1, t1}, {s0, t1} };
+            
+            ImpostorDraw draw;
+            draw.texture = mesh.impostorTexture;
+            for (int c = 0; c < 4; c++) {
+                float* vertex = draw.vertices[c];
+                vertex[0] = corners[c].x;
+                vertex[1] = corners[c].y;
+                vertex[2] = corners[c].z;
+                vertex[3] = texCoords[c][0];
+                vertex[4] = texCoords[c][1];
             }
+            
+            uint32_t index = (uint32_t)list.impostors.size();
+            list.impostors.push_back(draw);
+            list.queues[v].push(RenderQueue::makeKey(RenderQueue::Pass::OPAQUE, distance,
+                                                     (uint32_t)DrawMaterial::IMPOSTOR, draw.texture),
+                                (uint16_t)DrawType::IMPOSTOR, list.index, index);
         }
-        glEnd();
     }
     
-    // Render runway
-    const Runway& runway = terrain->getRunway();
-    glColor4f(0.3f, 0.3f, 0.35f, 1.0f);
-    glBegin(GL_QUADS);
-    glNormal3f(0, 1, 0.01f);
-    glVertex3f(runway.startX, runway.height + 0.1f, runway.startZ - runway.width / 2);
-    glVertex3f(runway.endX, runway.height + 0.1f, runway.startZ - runway.width / 2);
-    glVertex3f(runway.endX, runway.height + 0.1f, runway.startZ + runway.width / 2);
-    glVertex3f(runway.startX, runway.height + 0.1f, runway.startZ + runway.width / 2);
-    glEnd();
+    views = levelViews[(int)AircraftLod::FULL];
+    if (!views) return;
     
-    // Runway markings
-    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
-    for (float z = runway.startX; z < runway.endX; z += 50) {
-        glBegin(GL_QUADS);
-        glNormal3f(0, 1, 0.02f);
-        glVertex3f(z, runway.height + 0.2f, runway.startZ - 2);
+    queueMesh(list, {&mesh.body, model, false, views});
+    
+    // Landing gear: folds up and shortens while retracting
+    float gearState = aircraft.getGearAnimationState();
+    if (gearState > 0.01f) {  // Only draw if gear is at least slightly extended
+        Matrix4 fold = Matrix4::rotationX((1.0f - gearState) * 90.0f);
+        Matrix4 strutScale = Matrix4::scale(1.0f, gearState, 1.0f);
+        Matrix4 wheelScale = Matrix4::scale(gearState, gearState, gearState);
+        
+        for (const GearLeg& leg : mesh.gear) {
+            Matrix4 mount = model * Matrix4::translation(leg.mount) * fold;
+            queueMesh(list, {&leg.strut, mount * strutScale, true, views});
+            queueMesh(list, {&leg.wheel, mount * Matrix4::translation(Vector3(0, -leg.strutLength * gearState, 0)) * wheelScale,
+                             true, views});
+        }
+    }
+    
+    // Flaps: rotate down about the hinge, max 30 degree deflection
+    float flapsState = aircraft.getFlapsAnimationState();
+    if (flapsState > 0.01f) {
+        Matrix4 deflection = Matrix4::rotationX(flapsState * 30.0f);
+        for (const Vector3& mount : mesh.flapMounts) {
+            queueMesh(list, {&mesh.flap, model * Matrix4::translation(mount) * deflection, false, views});
+        }
+    }
+}
+
+void Renderer::queueMesh(RenderList& list, const MeshDraw& draw) const {
+    uint32_t index = (uint32_t)list.meshes.size();
+    list.meshes.push_back(draw);
+    
+    Vector3 position(draw.transform.m[12], draw.transform.m[13], draw.transform.m[14]);
+    DrawMaterial material = draw.normalize ? DrawMaterial::MESH_NORMALIZED : DrawMaterial::MESH;
+    for (size_t v = 0; v < viewStates.size(); v++) {
+        if (!(draw.views & (1u << v))) continue;
+        list.queues[v].push(RenderQueue::makeKey(RenderQueue::Pass::OPAQUE, (position - viewStates[v].eye).length(),
+                                                 (uint32_t)material, draw.mesh->getBuffer()),
+                            (uint16_t)DrawType::MESH, list.index, index);
+    }
+}
+
+void Renderer::buildTerrainList(const Terrain& terrain, int part, int partCount, RenderList& list) {
+    // Each part takes an even share of the hash buckets, so the chunks are
+    // split without first copying them out of the map. Every chunk is looked
+    // at once and tested against all views.
+    const auto& chunks = terrain.getChunks();
+    
+    // Chunks without a slot yet are packed here, straight into the stream
+    // buffer, and only copied on the GPU when they are assigned a slot
+    bool stage = streamBuffer.isReady() && GLExt::hasCopyBuffer && terrain.getChunkSize() == terrainChunkSize;
+    int vertexCount = terrainChunkSize * terrainChunkSize;
+    size_t bucketCount = chunks.bucket_count();
+    size_t first = bucketCount * part / partCount;
+    size_t last = bucketCount * (part + 1) / partCount;
+    
+    for (size_t bucket = first; bucket < last; bucket++) {
+        for (auto it = chunks.begin(bucket); it != chunks.end(bucket); ++it) {
+            const TerrainChunk* chunk = it->second.get();
+            if (!chunk || !chunk->generated) continue;
+            
+            uint32_t views = 0;
+            for (size_t v = 0; v < viewStates.size(); v++) {
+                if (viewStates[v].frustum.intersects(chunk->bounds)) {
+                    views |= 1u << v;
+                }
+            }
+            
+            if (!views) {
+                list.terrainChunksCulled++;
+                continue;
+            }
+            // Resident chunks lit for an older sun are packed again while
+            // this frame's budget lasts; the rest wait for a later frame
+            auto found = terrainSlots.find(it->first);
+            bool resident = found != terrainSlots.end();
+            bool relight = resident && found->second.slot >= 0 && found->second.lighting != terrainLightingVersion &&
+                           terrainRelightBudget.fetch_sub(1, std::memory_order_relaxed) > 0;
+            if (relight) {
+                list.terrainChunksRelit++;
+            }
+            
+            int64_t staged = -1;
+            if (stage && (!resident || relight)) {
+                size_t offset = 0;
+                auto* out = (TerrainVertex*)streamBuffer.allocate(vertexCount * sizeof(TerrainVertex), offset);
+                if (out && packTerrainVertices(*chunk, vertexCount, terrainSunDirection, terrainSunLight, out)) {
+                    staged = (int64_t)offset;
+                }
+            }
+            
+            uint32_t index = (uint32_t)list.terrainChunks.size();
+            list.terrainChunks.push_back({&*it, views, -1, staged, relight});
+            
+            Vector3 center = chunk->bounds.center();
+            for (size_t v = 0; v < viewStates.size(); v++) {
+                if (!(views & (1u << v))) continue;
+                list.queues[v].push(RenderQueue::makeKey(RenderQueue::Pass::TERRAIN, (center - viewStates[v].eye).length(),
+                                                         (uint32_t)DrawMaterial::TERRAIN, 0),
+                                    (uint16_t)DrawType::TERRAIN_CHUNK, list.index, index);
+            }
+        }
+    }
+}
+
+void Renderer::prepareTerrainSlots(const Terrain* terrain) {
+    const auto& chunks = terrain->getChunks();
+    if (chunks.empty()) return;
+    
+    int chunkSize = terrain->getChunkSize();
+    if (chunkSize != terrainChunkSize || (int)chunks.size() > terrainSlotCapacity) {
+        // Enough slots for everything inside the unload radius; every
+        // chunk re-uploads into the new buffer
+        int span = 2 * (terrain->getRenderDistance() + 2) + 1;
+        createTerrainBuffers(chunkSize, std::max(span * span, (int)chunks.size()));
+    }
+    
+    releaseUnloadedChunks(terrain);
+}
+
+void Renderer::updateTerrainLighting(const Sky* sky) {
+    // The sun as the lit shader sees it, or its initial light without a sky
+    Vector3 sunDirection = Vector3(1.0f, 1.0f, 1.0f).normalized();
+    Color sunLight(0.9f, 0.9f, 0.85f, 1.0f);
+    if (sky) {
+        sunDirection = sky->getSunDirection();
+        Color sun = sky->getSunColor();
+        float sunStrength = 0.9f * sky->getSunIntensity();
+        sunLight = Color(sun.r * sunStrength, sun.g * sunStrength, sun.b * sunStrength, 1.0f);
+    }
+    
+    terrainRelightBudget.store(kTerrainRelightsPerFrame, std::memory_order_relaxed);
+    
+    // Changes too small to see wait, so a slowly moving sun relights the
+    // terrain now and then rather than continuously
+    bool changed = terrainLightingVersion == 0 ||
+                   Vector3::dot(sunDirection, terrainSunDirection) < kTerrainRelightCosine ||
+                   std::fabs(sunLight.r - terrainSunLight.r) > kTerrainRelightColorStep ||
+                   std::fabs(sunLight.g - terrainSunLight.g) > kTerrainRelightColorStep ||
+                   std::fabs(sunLight.b - terrainSunLight.b) > kTerrainRelightColorStep;
+    if (!changed) return;
+    
+    terrainSunDirection = sunDirection;
+    terrainSunLight = sunLight;
+    terrainLightingVersion++;
+}
+
+void Renderer::updateTerrainSlots() {
+    // Everything visible in any view, so each view only looks up its slot
+    for (RenderList& list : renderLists) {
+        for (ChunkDraw& draw : list.terrainChunks) {
+            TerrainSlot& slot = terrainSlots[draw.entry->first];
+            if (slot.slot < 0 || draw.relight) {
+                uploadTerrainChunk(draw.entry->second, slot, draw.staged);
+            }
+            draw.slot = slot.slot;
+        }
+    }
+}
+
+void Renderer::submitQueue(const RenderScene& scene, int viewIndex) {
+    const std::vector<RenderQueue::Item>& items = viewQueues[viewIndex].getItems();
+    
+    size_t i = 0;
+    while (i < items.size()) {
+        const RenderQueue::Item& item = items[i];
+        
+        switch ((DrawType)item.type) {
+            case DrawType::SKY:
+                renderSky(scene.sky, viewIndex);
+                break;
+                
+            case DrawType::GROUND:
+                beginLitPass();
+                drawGround(*scene.terrain);
+                break;
+                
+            case DrawType::TERRAIN_CHUNK: {
+                // The terrain pass holds the chunks and then the ground, so
+                // the chunks all share one draw call
+                size_t end = i + 1;
+                while (end < items.size() && items[end].type == item.type) {
+                    end++;
+                }
+                beginBakedPass();
+                drawTerrainChunks(&items[i], end - i);
+                i = end;
+                continue;
+            }
+                
+            case DrawType::MESH: {
+                const MeshDraw& draw = renderLists[item.list].meshes[item.index];
+                beginLitPass();
+                glState.setEnabled(GL_NORMALIZE, draw.normalize);
+                glPushMatrix();
+                glMultMatrixf(draw.transform.m);
+                draw.mesh->draw(glState);
+                glPopMatrix();
+                break;
+            }
+                
+            case DrawType::IMPOSTOR: {
+                size_t end = i + 1;
+                while (end < items.size() && items[end].type == item.type) {
+                    end++;
+                }
+                drawImpostors(&items[i], end - i);
+                i = end;
+                continue;
+            }
+                
+            case DrawType::CLOUDS:
+                clouds.draw(viewIndex, glState);
+                break;
+                
+            case DrawType::PARTICLES:
+                particles.draw((ParticleSystem::Type)item.index, viewMatrix, particleLight, glState);
+                break;
+        }
+        i++;
+    }
+    
+    glState.disable(GL_NORMALIZE);
+}
+
+void Renderer::drawImpostors(const RenderQueue::Item* items, size_t count) {
+    // Unlit, the lighting is in the frames; fixed-function fog, which
+    // applyAtmosphere keeps current for either lighting path
+    glState.useProgram(0);
+    glState.disable(GL_LIGHTING);
+    glState.enable(GL_FOG);
+    glState.enable(GL_DEPTH_TEST);
+    glState.depthMask(true);
+    glState.enable(GL_TEXTURE_2D);
+    glState.enable(GL_ALPHA_TEST);
+    glColor4f(impostorTint.r, impostorTint.g, impostorTint.b, 1.0f);
+    
+    // One batch per run of the same atlas
+    unsigned int bound = 0;
+    for (size_t i = 0; i < count; i++) {
+        const ImpostorDraw& draw = renderLists[items[i].list].impostors[items[i].index];
+        if (draw.texture != bound) {
+            if (bound) glEnd();
+            glBindTexture(GL_TEXTURE_2D, draw.texture);
+            bound = draw.texture;
+            glBegin(GL_QUADS);
+        }
+        for (const float* vertex : draw.vertices) {
+            glTexCoord2f(vertex[3], vertex[4]);
+            glVertex3f(vertex[0], vertex[1], vertex[2]);
+        }
+    }
+    if (bound) glEnd();
+    
+    glState.disable(GL_ALPHA_TEST);
+    glState.disable(GL_TEXTURE_2D);
+}
+
+void Renderer::drawTerrainChunks(const RenderQueue::Item* items, size_t count) {
+    terrainDrawCounts.clear();
+    terrainDrawOffsets.clear();
+    terrainDrawBaseVertices.clear();
+    
+    int vertsPerChunk = terrainChunkSize * terrainChunkSize;
+    for (size_t i = 0; i < count; i++) {
+        const ChunkDraw& draw = renderLists[items[i].list].terrainChunks[items[i].index];
+        if (draw.slot < 0) continue;
+        
+        terrainDrawCounts.push_back(terrainIndexCount);
+        terrainDrawOffsets.push_back(nullptr);
+        terrainDrawBaseVertices.push_back(draw.slot * vertsPerChunk);
+    }
+    if (terrainDrawCounts.empty()) return;
+    
+    glState.bindBuffer(GL_ARRAY_BUFFER, terrainVertexBuffer);
+    glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, terrainIndexBuffer);
+    
+    glState.enableClientState(GL_VERTEX_ARRAY);
+    glState.disableClientState(GL_NORMAL_ARRAY);
+    glState.enableClientState(GL_COLOR_ARRAY);
+    glState.disableClientState(GL_TEXTURE_COORD_ARRAY);
+    
+    if (GLExt::hasBaseVertex) {
+        // All chunks in one call
+        glVertexPointer(3, GL_FLOAT, sizeof(TerrainVertex), (const void*)offsetof(TerrainVertex, position));
+        glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(TerrainVertex), (const void*)offsetof(TerrainVertex, color));
+        
+        GLExt::MultiDrawElementsBaseVertex(GL_TRIANGLES, terrainDrawCounts.data(), terrainIndexType,
+                                           terrainDrawOffsets.data(), (GLsizei)terrainDrawCounts.size(),
+                                           terrainDrawBaseVertices.data());
+    } else {
+        // GL 2.1 fallback: rebase the vertex pointers per chunk
+        for (size_t i = 0; i < terrainDrawBaseVertices.size(); i++) {
+            size_t base = terrainDrawBaseVertices[i] * sizeof(TerrainVertex);
+            glVertexPointer(3, GL_FLOAT, sizeof(TerrainVertex), (const void*)(base + offsetof(TerrainVertex, position)));
+            glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(TerrainVertex), (const void*)(base + offsetof(TerrainVertex, color)));
+            glDrawElements(GL_TRIANGLES, terrainDrawCounts[i], terrainIndexType, nullptr);
+        }
+    }
+}
+
+void Renderer::drawGround(const Terrain& terrain) {
+    if (terrain.getChunks().empty()) {
+        // Fallback: render simple ground plane
+        glColor4f(0.2f, 0.5f, 0.2f, 1.0f);
+        glBegin(GL_QUADS);
+        glNormal3f(0, 1, 0);
+        glVertex3f(-5000, 0, -5000);
+        glVertex3f(5000, 0, -5000);
+        glVertex3f(5000, 0, 5000);
+        glVertex3f(-5000, 0, 5000);
+        glEnd();
+    }
+    
+    // Render runway
+    const Runway& runway = terrain.getRunway();
+    glColor4f(0.3f, 0.3f, 0.35f, 1.0f);
+    glBegin(GL_QUADS);
+    glNormal3f(0, 1, 0.01f);
+    glVertex3f(runway.startX, runway.height + 0.1f, runway.startZ - runway.width / 2);
+    glVertex3f(runway.endX, runway.height + 0.1f, runway.startZ - runway.width / 2);
+    glVertex3f(runway.endX, runway.height + 0.1f, runway.startZ + runway.width / 2);
+    glVertex3f(runway.startX, runway.height + 0.1f, runway.startZ + runway.width / 2);
+    glEnd();
+    
+    // Runway markings
+    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+    for (float z = runway.startX; z < runway.endX; z += 50) {
+        glBegin(GL_QUADS);
+        glNormal3f(0, 1, 0.02f);
+        glVertex3f(z, runway.height + 0.2f, runway.startZ - 2);
         glVertex3f(z + 25, runway.height + 0.2f, runway.startZ - 2);
         glVertex3f(z + 25, runway.height + 0.2f, runway.startZ + 2);
         glVertex3f(z, runway.height + 0.2f, runway.startZ + 2);
@@ -1021,22 +1437,606 @@ void Renderer::renderTerrain(const Terrain* terrain, const Camera* camera) {
     }
 }
 
-void Renderer::renderSky(const Sky* sky, const Camera* camera) {
+void Renderer::createTerrainBuffers(int chunkSize, int slotCapacity) {
+    releaseTerrainBuffers();
+    
+    terrainChunkSize = chunkSize;
+    terrainSlotCapacity = slotCapacity;
+    
+    // Shared index buffer: two triangles per grid cell, in vertical stripes
+    std::vector<GLuint> indices;
+    indices.reserve((chunkSize - 1) * (chunkSize - 1) * 6);
+    for (int stripeX = 0; stripeX < chunkSize - 1; stripeX += kIndexStripeWidth) {
+        int stripeEnd = std::min(stripeX + kIndexStripeWidth, chunkSize - 1);
+        for (int z = 0; z < chunkSize - 1; z++) {
+            for (int x = stripeX; x < stripeEnd; x++) {
+                GLuint idx = z * chunkSize + x;
+                GLuint idx2 = (z + 1) * chunkSize + x;
+                GLuint idx3 = z * chunkSize + (x + 1);
+                GLuint idx4 = (z + 1) * chunkSize + (x + 1);
+                
+                indices.push_back(idx);
+                indices.push_back(idx2);
+                indices.push_back(idx3);
+                
+                indices.push_back(idx3);
+                indices.push_back(idx2);
+                indices.push_back(idx4);
+            }
+        }
+    }
+    terrainIndexCount = (int)indices.size();
+    
+    // 16-bit indices halve the buffer, but only reach the first 65536
+    // vertices; larger chunks keep 32-bit ones
+    glGenBuffers(1, &terrainIndexBuffer);
+    glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, terrainIndexBuffer);
+    if (chunkSize * chunkSize <= 65536) {
+        std::vector<GLushort> narrow(indices.begin(), indices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, narrow.size() * sizeof(GLushort), narrow.data(), GL_STATIC_DRAW);
+        terrainIndexType = GL_UNSIGNED_SHORT;
+    } else {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+        terrainIndexType = GL_UNSIGNED_INT;
+    }
+    
+    // One vertex buffer holding every resident chunk
+    glGenBuffers(1, &terrainVertexBuffer);
+    glState.bindBuffer(GL_ARRAY_BUFFER, terrainVertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, (size_t)slotCapacity * chunkSize * chunkSize * sizeof(TerrainVertex),
+                 nullptr, GL_DYNAMIC_DRAW);
+    
+    freeTerrainSlots.clear();
+    for (int i = slotCapacity - 1; i >= 0; i--) {
+        freeTerrainSlots.push_back(i);
+    }
+}
+
+void Renderer::releaseTerrainBuffers() {
+    glState.deleteBuffer(terrainVertexBuffer);
+    glState.deleteBuffer(terrainIndexBuffer);
+    terrainVertexBuffer = 0;
+    terrainIndexBuffer = 0;
+    terrainChunkSize = 0;
+    terrainSlotCapacity = 0;
+    terrainSlots.clear();
+    freeTerrainSlots.clear();
+}
+
+bool Renderer::uploadTerrainChunk(const std::shared_ptr<TerrainChunk>& chunk, TerrainSlot& slot, int64_t staged) {
+    // Relit chunks are written over their own slot
+    bool resident = slot.slot >= 0;
+    if (!resident && freeTerrainSlots.empty()) {
+        return false;
+    }
+    
+    int index = resident ? slot.slot : freeTerrainSlots.back();
+    int vertexCount = terrainChunkSize * terrainChunkSize;
+    size_t bytes = vertexCount * sizeof(TerrainVertex);
+    
+    if (staged >= 0) {
+        // Already packed into the stream buffer by the build phase
+        streamBuffer.flush();
+        glState.bindBuffer(GL_COPY_READ_BUFFER, streamBuffer.getBuffer());
+        glState.bindBuffer(GL_COPY_WRITE_BUFFER, terrainVertexBuffer);
+        GLExt::CopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)staged,
+                                 (GLintptr)(index * bytes), (GLsizeiptr)bytes);
+    } else {
+        std::vector<TerrainVertex> interleaved(vertexCount);
+        if (!packTerrainVertices(*chunk, vertexCount, terrainSunDirection, terrainSunLight, interleaved.data())) {
+            return false;  // Incomplete chunk data
+        }
+        
+        glState.bindBuffer(GL_ARRAY_BUFFER, terrainVertexBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, index * bytes, bytes, interleaved.data());
+    }
+    
+    if (!resident) {
+        slot.slot = index;
+        freeTerrainSlots.pop_back();
+        slot.chunk = chunk;
+    }
+    slot.lighting = terrainLightingVersion;
+    return true;
+}
+
+void Renderer::releaseUnloadedChunks(const Terrain* terrain) {
+    const auto& chunks = terrain->getChunks();
+    
+    // Free slots whose chunk was unloaded (or unloaded and regenerated)
+    for (auto it = terrainSlots.begin(); it != terrainSlots.end(); ) {
+        auto found = chunks.find(it->first);
+        if (found == chunks.end() || found->second != it->second.chunk.lock()) {
+            if (it->second.slot >= 0) {
+                freeTerrainSlots.push_back(it->second.slot);
+            }
+            it = terrainSlots.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void Renderer::applyAtmosphere(const Sky* sky) {
+    Vector3 sunDir = sky->getSunDirection();
+    Color sun = sky->getSunColor();
+    float sunStrength = 0.9f * sky->getSunIntensity();
+    Color fog = sky->getFogColor();
+    float fogStart = sky->getFogStart();
+    float fogEnd = sky->getFogEnd();
+    
+    // Fixed-function fog also covers impostors under the lit shader
+    GLfloat fogColor[] = { fog.r, fog.g, fog.b, 1.0f };
+    glFogfv(GL_FOG_COLOR, fogColor);
+    glFogf(GL_FOG_START, fogStart);
+    glFogf(GL_FOG_END, fogEnd);
+    
+    // Impostors were rendered under the initial LIGHT0 and keep that
+    // lighting; scale it to this sun, taking an average surface as lit at
+    // half strength
+    const float ambient[] = { 0.5f, 0.5f, 0.55f };
+    const float baked[] = { 0.9f, 0.9f, 0.85f };
+    const float current[] = { sun.r * sunStrength, sun.g * sunStrength, sun.b * sunStrength };
+    float tint[3];
+    for (int c = 0; c < 3; c++) {
+        tint[c] = std::min((ambient[c] + current[c] * 0.5f) / (ambient[c] + baked[c] * 0.5f), 1.0f);
+    }
+    impostorTint = Color(tint[0], tint[1], tint[2], 1.0f);
+    particleLight = Color(std::min(ambient[0] + current[0] * 0.5f, 1.0f), std::min(ambient[1] + current[1] * 0.5f, 1.0f),
+                          std::min(ambient[2] + current[2] * 0.5f, 1.0f), 1.0f);
+    
+    if (!litProgram.isValid()) {
+        // Light positions are transformed by the modelview matrix when set
+        glState.matrixMode(GL_MODELVIEW);
+        glLoadMatrixf(viewMatrix.m);
+        
+        GLfloat lightPosition[] = { sunDir.x, sunDir.y, sunDir.z, 0.0f };
+        GLfloat lightDiffuse[] = { sun.r * sunStrength, sun.g * sunStrength, sun.b * sunStrength, 1.0f };
+        glLightfv(GL_LIGHT0, GL_POSITION, lightPosition);
+        glLightfv(GL_LIGHT0, GL_DIFFUSE, lightDiffuse);
+        return;
+    }
+    
+    // The shader lights in eye space; rotate the sun by the view matrix
+    const float* v = viewMatrix.m;
+    setVector(frameUniforms.sunDirection,
+              v[0] * sunDir.x + v[4] * sunDir.y + v[8] * sunDir.z,
+              v[1] * sunDir.x + v[5] * sunDir.y + v[9] * sunDir.z,
+              v[2] * sunDir.x + v[6] * sunDir.y + v[10] * sunDir.z, 0.0f);
+    setVector(frameUniforms.sunColor, sun.r * sunStrength, sun.g * sunStrength, sun.b * sunStrength, 1.0f);
+    setVector(frameUniforms.fogColor, fog.r, fog.g, fog.b, 1.0f);
+    setVector(frameUniforms.fogParams, fogStart, fogEnd, 1.0f / std::max(fogEnd - fogStart, 1.0f), 0.0f);
+    frameUniformsDirty = true;
+}
+
+void Renderer::beginLitPass() {
+    glState.enable(GL_DEPTH_TEST);
+    glState.depthMask(true);
+    
+    if (!litProgram.isValid()) {
+        glState.useProgram(0);
+        glState.enable(GL_LIGHTING);
+        glState.enable(GL_FOG);
+        glState.disable(GL_TEXTURE_2D);
+        return;
+    }
+    
+    glState.useProgram(litProgram.getId());
+    if (!frameUniformsDirty) return;
+    frameUniformsDirty = false;
+    
+    if (frameUniformBuffer) {
+        glState.bindBuffer(GL_UNIFORM_BUFFER, frameUniformBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frameUniforms);
+    } else {
+        glUniformMatrix4fv(litProgram.getUniformLocation("projection"), 1, GL_FALSE, frameUniforms.projection);
+        glUniform4fv(litProgram.getUniformLocation("sunDirection"), 1, frameUniforms.sunDirection);
+        glUniform4fv(litProgram.getUniformLocation("sunColor"), 1, frameUniforms.sunColor);
+        glUniform4fv(litProgram.getUniformLocation("ambientColor"), 1, frameUniforms.ambientColor);
+        glUniform4fv(litProgram.getUniformLocation("fogColor"), 1, frameUniforms.fogColor);
+        glUniform4fv(litProgram.getUniformLocation("fogParams"), 1, frameUniforms.fogParams);
+    }
+}
+
+void Renderer::beginBakedPass() {
+    glState.enable(GL_DEPTH_TEST);
+    glState.depthMask(true);
+    glState.useProgram(0);
+    glState.disable(GL_LIGHTING);
+    glState.enable(GL_FOG);
+    glState.disable(GL_TEXTURE_2D);
+}
+
+void Renderer::beginUnlitPass() {
+    glState.useProgram(0);
+    glState.disable(GL_LIGHTING);
+    glState.disable(GL_FOG);
+    glState.disable(GL_TEXTURE_2D);
+    glState.disable(GL_DEPTH_TEST);
+}
+
+void Renderer::RenderList::clear() {
+    terrainChunks.clear();
+    meshes.clear();
+    ui.clear();
+    for (RenderQueue& queue : queues) {
+        queue.clear();
+    }
+    impostors.clear();
+    terrainChunksCulled = 0;
+    objectsVisible = 0;
+    objectsCulled = 0;
+    std::fill(std::begin(aircraftLods), std::end(aircraftLods), 0);
+    particlesDrawn = 0;
+    terrainChunksRelit = 0;
+}
+
+void Renderer::setupViews(const RenderScene& scene) {
+    int count = std::min((int)scene.views.size(), kMaxViews);
+    viewStates.resize(count);
+    
+    for (int i = 0; i < count; i++) {
+        const RenderView& view = scene.views[i];
+        ViewState& state = viewStates[i];
+        
+        int width = view.width > 0 ? view.width : screenWidth;
+        int height = view.height > 0 ? view.height : screenHeight;
+        state.viewport[0] = view.x;
+        state.viewport[1] = screenHeight - view.y - height;
+        state.viewport[2] = width;
+        state.viewport[3] = height;
+        
+        state.projection = Matrix4::perspective(view.fov, (float)width / (float)height, view.nearPlane, view.farPlane);
+        state.view = Matrix4::lookAt(view.eye, view.target, view.up);
+        state.eye = view.eye;
+        state.frustum.extract(state.projection * state.view);
+        state.skyRadius = std::sqrt(view.nearPlane * view.farPlane);
+    }
+}
+
+void Renderer::applyView(const ViewState& view) {
+    glViewport(view.viewport[0], view.viewport[1], view.viewport[2], view.viewport[3]);
+    
+    projectionMatrix = view.projection;
+    viewMatrix = view.view;
+    eyePosition = view.eye;
+    frustum = view.frustum;
+    
+    std::copy(projectionMatrix.m, projectionMatrix.m + 16, frameUniforms.projection);
+    frameUniformsDirty = true;
+    
+    glState.matrixMode(GL_PROJECTION);
+    glLoadMatrixf(projectionMatrix.m);
+    glState.matrixMode(GL_MODELVIEW);
+    glLoadMatrixf(viewMatrix.m);
+}
+
+void Renderer::buildRenderLists(const RenderScene& scene) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    
+    // Meshes are created with GL calls, so before the workers start; so are
+    // the level of detail states, which the map would move if inserted into
+    // concurrently
+    sceneFrame++;
+    sceneAircraftMeshes.clear();
+    sceneAircraftLods.clear();
+    for (const Aircraft* aircraft : scene.aircraft) {
+        sceneAircraftMeshes.push_back(&getAircraftMesh(aircraft->getType(), aircraft->getSpecs()));
+        AircraftLodState& lod = aircraftLods[aircraft];
+        lod.frame = sceneFrame;
+        sceneAircraftLods.push_back(&lod);
+    }
+    for (auto it = aircraftLods.begin(); it != aircraftLods.end();) {
+        it = it->second.frame == sceneFrame ? std::next(it) : aircraftLods.erase(it);
+    }
+    
+    int viewCount = (int)viewStates.size();
+    renderLists.resize(workers.getThreadCount());
+    for (size_t i = 0; i < renderLists.size(); i++) {
+        RenderList& list = renderLists[i];
+        list.clear();
+        list.queues.resize(viewCount);
+        list.index = (uint16_t)i;
+    }
+    
+    // Single tasks first, longest first, so none of them starts last and
+    // holds up the frame: cloud sorting for each view, then the overlays of
+    // all views, copying out the particles and each aircraft. Terrain is
+    // split into one part per thread and each part culls against every view.
+    // Only the overlay job uses the glyph cache.
+    clouds.setViewCount(viewCount);
+    skyDomes.resize(viewCount);
+    
+    int overlayJob = viewCount;
+    int particleJob = overlayJob + 1;
+    int firstAircraftJob = particleJob + 1;
+    int firstTerrainJob = firstAircraftJob + (int)scene.aircraft.size();
+    int terrainParts = scene.terrain ? workers.getThreadCount() : 0;
+    
+    workers.run(firstTerrainJob + terrainParts, [&](int job, int thread) {
+        RenderList& list = renderLists[thread];
+        
+        if (job < viewCount) {
+            const ViewState& view = viewStates[job];
+            RenderQueue& queue = list.queues[job];
+            if (scene.sky) {
+                if (scene.sky->hasAtmosphere()) {
+                    buildSkyDome(*scene.sky, view, skyDomes[job]);
+                } else {
+                    skyDomes[job].clear();
+                }
+                clouds.prepare(job, *scene.sky, view.eye, view.view, view.frustum);
+                queue.push(RenderQueue::makeKey(RenderQueue::Pass::BACKGROUND, 0.0f, (uint32_t)DrawMaterial::SKY, 0),
+                           (uint16_t)DrawType::SKY, list.index, 0);
+                if (clouds.getPuffsDrawn(job) > 0) {
+                    queue.push(RenderQueue::makeKey(RenderQueue::Pass::TRANSPARENT, clouds.getFarthestDistance(job),
+                                                    (uint32_t)DrawMaterial::CLOUDS, 0),
+                               (uint16_t)DrawType::CLOUDS, list.index, 0);
+                }
+            }
+            if (scene.terrain) {
+                // The runway lies on the terrain and the fallback plane under
+                // it, and their nearest point is usually right below the eye:
+                // keyed after every chunk, which hide most of them
+                queue.push(RenderQueue::makeKey(RenderQueue::Pass::TERRAIN, std::numeric_limits<float>::max(),
+                                                (uint32_t)DrawMaterial::GROUND, 0),
+                           (uint16_t)DrawType::GROUND, list.index, 0);
+            }
+            if (scene.particles) {
+                // Keyed by the nearest point of each pool's bounds
+                for (int type = 0; type < ParticleSystem::kTypeCount; type++) {
+                    const ParticleSystem::Pool& pool = scene.particles->getPool((ParticleSystem::Type)type);
+                    if (pool.count == 0) continue;
+                    AABB bounds = ParticleRenderer::getBounds(pool, (ParticleSystem::Type)type);
+                    if (!view.frustum.intersects(bounds)) continue;
+                    
+                    Vector3 nearest(std::max(bounds.min.x, std::min(bounds.max.x, view.eye.x)),
+                                    std::max(bounds.min.y, std::min(bounds.max.y, view.eye.y)),
+                                    std::max(bounds.min.z, std::min(bounds.max.z, view.eye.z)));
+                    queue.push(RenderQueue::makeKey(RenderQueue::Pass::TRANSPARENT, (nearest - view.eye).length(),
+                                                    (uint32_t)DrawMaterial::PARTICLES, type),
+                               (uint16_t)DrawType::PARTICLES, list.index, type);
+                    list.particlesDrawn += pool.count;
+                }
+            }
+        } else if (job == overlayJob) {
+            Uint64 overlayStart = SDL_GetPerformanceCounter();
+            for (int v = 0; v < viewCount; v++) {
+                buildOverlay(v, scene.views[v], viewStates[v].viewport, scene, list.ui);
+            }
+            stats.overlayMilliseconds += (float)((SDL_GetPerformanceCounter() - overlayStart) * 1000.0 /
+                                                 SDL_GetPerformanceFrequency());
+        } else if (job == particleJob) {
+            particles.prepare(scene.particles);
+        } else if (job < firstTerrainJob) {
+            int index = job - firstAircraftJob;
+            buildAircraftList(*scene.aircraft[index], *sceneAircraftMeshes[index], *sceneAircraftLods[index], list);
+        } else {
+            buildTerrainList(*scene.terrain, job - firstTerrainJob, terrainParts, list);
+        }
+    });
+    
+    // Each view's commands from every list, in submission order
+    viewQueues.resize(viewCount);
+    workers.run(viewCount, [&](int view, int) {
+        RenderQueue& queue = viewQueues[view];
+        queue.clear();
+        for (const RenderList& list : renderLists) {
+            queue.append(list.queues[view]);
+        }
+        queue.sort();
+    });
+    
+    stats.buildMilliseconds += (float)((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+    stats.buildThreads = workers.getThreadCount();
+}
+
+void Renderer::renderScene(const RenderScene& scene) {
+    if (scene.views.empty()) return;
+    
+    // Slots are settled first so the build knows which chunks still need
+    // uploading
+    setupViews(scene);
+    if (scene.terrain) {
+        prepareTerrainSlots(scene.terrain);
+        updateTerrainLighting(scene.sky);
+    }
+    buildRenderLists(scene);
+    
+    // Everything from here on is GL submission. Cached overlays are redrawn
+    // before the scene, as switching framebuffers in the middle of it makes
+    // tiled and software rasterizers render what was queued so far. Chunks
+    // visible in any view are uploaded once, then each view draws its share
+    // in draw order.
+    redrawOverlays();
+    updateTerrainSlots();
+    
+    for (size_t i = 0; i < viewStates.size(); i++) {
+        const ViewState& view = viewStates[i];
+        applyView(view);
+        
+        // Later views cover part of the earlier ones
+        if (i > 0) {
+            glState.enable(GL_SCISSOR_TEST);
+            glScissor(view.viewport[0], view.viewport[1], view.viewport[2], view.viewport[3]);
+            glState.depthMask(true);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glState.disable(GL_SCISSOR_TEST);
+        }
+        
+        submitQueue(scene, (int)i);
+        
+        if (scene.sky) {
+            stats.cloudPuffsVisible += clouds.getPuffsDrawn((int)i);
+            stats.cloudPuffsCulled += clouds.getPuffsCulled((int)i);
+        }
+    }
+    
+    // Overlays and later 3D draws go to the whole screen from the main view
+    if (viewStates.size() > 1) {
+        applyView(viewStates[0]);
+        if (scene.sky) {
+            applyAtmosphere(scene.sky);
+        }
+    }
+    glViewport(0, 0, screenWidth, screenHeight);
+    
+    submitOverlays();
+    
+    for (const RenderList& list : renderLists) {
+        uiBatch.append(list.ui);
+        stats.terrainChunksVisible += (int)list.terrainChunks.size();
+        stats.terrainChunksCulled += list.terrainChunksCulled;
+        stats.objectsVisible += list.objectsVisible;
+        stats.objectsCulled += list.objectsCulled;
+        stats.aircraftFull += list.aircraftLods[(int)AircraftLod::FULL];
+        stats.aircraftReduced += list.aircraftLods[(int)AircraftLod::REDUCED];
+        stats.aircraftImpostors += list.aircraftLods[(int)AircraftLod::IMPOSTOR];
+        stats.particlesDrawn += list.particlesDrawn;
+        stats.terrainChunksRelit += list.terrainChunksRelit;
+    }
+}
+
+void Renderer::redrawOverlays() {
+    if (!overlaysCached) return;
+    
+    Uint64 start = SDL_GetPerformanceCounter();
+    int viewCount = (int)viewStates.size();
+    
+    bool redrawn = false;
+    for (int i = 0; i < viewCount; i++) {
+        OverlayLayer& layer = overlays[i].layer;
+        if (!overlays[i].visible || !layer.isPending()) continue;
+        
+        if (!layer.update(glState, offscreenFramebuffer, framebufferSamples)) {
+            // Straight to the screen from the next frame on
+            overlaysCached = false;
+        }
+        stats.overlayRedraws++;
+        redrawn = true;
+    }
+    if (redrawn) {
+        glViewport(0, 0, screenWidth, screenHeight);
+        glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+    }
+    
+    float milliseconds = (float)((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+    stats.overlayMilliseconds += milliseconds;
+    stats.overlayRedrawMilliseconds += milliseconds;
+}
+
+void Renderer::submitOverlays() {
+    if (!overlaysCached) return;
+    
+    Uint64 start = SDL_GetPerformanceCounter();
+    int viewCount = (int)viewStates.size();
+    
+    // Anything queued before the scene goes under the overlays, anything
+    // queued after it over them
+    flush2D();
+    for (int i = 0; i < viewCount; i++) {
+        if (overlays[i].visible) {
+            overlays[i].layer.composite(glState, screenWidth, screenHeight);
+        }
+    }
+    
+    stats.overlayMilliseconds += (float)((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+}
+
+void Renderer::buildSkyDome(const Sky& sky, const ViewState& view, std::vector<SkyVertex>& dome) const {
+    // The sky only depends on direction and altitude, so the dome is drawn
+    // around the eye and its vertices are directions at the view's radius
+    dome.resize((kSkyDomeRows + 1) * (kSkyDomeColumns + 1));
+    SkyVertex* vertex = dome.data();
+    for (int row = 0; row <= kSkyDomeRows; row++) {
+        float t = 2.0f * row / kSkyDomeRows - 1.0f;
+        float elevation = t * std::fabs(t) * PI * 0.5f;
+        const SkyVertex* first = vertex;
+        for (int column = 0; column <= kSkyDomeColumns; column++, vertex++) {
+            float azimuth = 2.0f * PI * column / kSkyDomeColumns;
+            Vector3 direction(std::cos(elevation) * std::cos(azimuth), std::sin(elevation),
+                              std::cos(elevation) * std::sin(azimuth));
+            vertex->position[0] = direction.x * view.skyRadius;
+            vertex->position[1] = direction.y * view.skyRadius;
+            vertex->position[2] = direction.z * view.skyRadius;
+            
+            // The last column closes the ring
+            if (column == kSkyDomeColumns) {
+                std::copy(first->color, first->color + 4, vertex->color);
+                continue;
+            }
+            Color color = sky.getSkyColor(direction, view.eye.y);
+            vertex->color[0] = (uint8_t)(color.r * 255.0f + 0.5f);
+            vertex->color[1] = (uint8_t)(color.g * 255.0f + 0.5f);
+            vertex->color[2] = (uint8_t)(color.b * 255.0f + 0.5f);
+            vertex->color[3] = 255;
+        }
+    }
+}
+
+void Renderer::renderSky(const Sky* sky, int viewIndex) {
     if (!sky) return;
     
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_LIGHTING);
+    applyAtmosphere(sky);
+    beginUnlitPass();
+    
+    const std::vector<SkyVertex>& dome = skyDomes[viewIndex];
+    if (!dome.empty()) {
+        // Around the eye: the view's rotation without its translation
+        Matrix4 rotation = viewMatrix;
+        rotation.m[12] = rotation.m[13] = rotation.m[14] = 0.0f;
+        glState.matrixMode(GL_MODELVIEW);
+        glPushMatrix();
+        glLoadMatrixf(rotation.m);
+        
+        // Vertices and indices come from client memory
+        glState.bindBuffer(GL_ARRAY_BUFFER, 0);
+        glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        glState.enableClientState(GL_VERTEX_ARRAY);
+        glState.enableClientState(GL_COLOR_ARRAY);
+        glState.disableClientState(GL_TEXTURE_COORD_ARRAY);
+        glState.disableClientState(GL_NORMAL_ARRAY);
+        
+        glVertexPointer(3, GL_FLOAT, sizeof(SkyVertex), dome[0].position);
+        glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(SkyVertex), dome[0].color);
+        glDrawElements(GL_TRIANGLES, (GLsizei)skyDomeIndices.size(), GL_UNSIGNED_SHORT, skyDomeIndices.data());
+        glState.disableClientState(GL_COLOR_ARRAY);
+        
+        // The sun where it is in the world, colored by the air it shines through
+        Vector3 sunDir = sky->getSunDirection();
+        if (sunDir.y > 0) {
+            Color sunColor = sky->getSunColor();
+            float radius = viewStates[viewIndex].skyRadius * 0.99f;
+            Vector3 side = Vector3::cross(sunDir, Vector3(0, 1, 0)).normalized();
+            Vector3 up = Vector3::cross(side, sunDir);
+            Vector3 center = sunDir * radius;
+            float size = kSunAngularRadius * radius;
+            
+            glColor4f(sunColor.r, sunColor.g, sunColor.b, 1.0f);
+            glBegin(GL_TRIANGLE_FAN);
+            glVertex3f(center.x, center.y, center.z);
+            for (int i = 0; i <= 20; i++) {
+                float angle = 2.0f * PI * i / 20;
+                Vector3 edge = center + side * (size * std::cos(angle)) + up * (size * std::sin(angle));
+                glVertex3f(edge.x, edge.y, edge.z);
+            }
+            glEnd();
+        }
+        
+        glPopMatrix();
+        return;
+    }
     
     // Render sky gradient
     Color top = sky->getSkyColorTop();
     Color horizon = sky->getSkyColorHorizon();
     
-    glMatrixMode(GL_PROJECTION);
+    glState.matrixMode(GL_PROJECTION);
     glPushMatrix();
     glLoadIdentity();
     glOrtho(-1, 1, -1, 1, -1, 1);
     
-    glMatrixMode(GL_MODELVIEW);
+    glState.matrixMode(GL_MODELVIEW);
     glPushMatrix();
     glLoadIdentity();
     
@@ -1073,253 +2073,379 @@ void Renderer::renderSky(const Sky* sky, const Camera* camera) {
         glEnd();
     }
     
-    glMatrixMode(GL_PROJECTION);
+    glState.matrixMode(GL_PROJECTION);
     glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
+    glState.matrixMode(GL_MODELVIEW);
     glPopMatrix();
-    
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_LIGHTING);
 }
 
-void Renderer::renderHUD(const Aircraft* aircraft) {
-    if (!aircraft) return;
+bool Renderer::OverlayValues::sameLayout(const OverlayValues& other) const {
+    return type == other.type && showHUD == other.showHUD && showMinimap == other.showMinimap &&
+           x == other.x && y == other.y && width == other.width && height == other.height;
+}
+
+bool Renderer::OverlayValues::operator==(const OverlayValues& other) const {
+    return sameLayout(other) && speed == other.speed && altitude == other.altitude &&
+           heading == other.heading && verticalSpeed == other.verticalSpeed && throttle == other.throttle &&
+           flaps == other.flaps && runwayOffset == other.runwayOffset && gearDown == other.gearDown &&
+           onGround == other.onGround && stalling == other.stalling;
+}
+
+Renderer::OverlayValues Renderer::readOverlayValues(const Aircraft& aircraft, int x, int y, int width, int height) {
+    OverlayValues values;
+    values.type = aircraft.getType();
+    values.speed = (int)std::nearbyint(aircraft.getSpeed() * 1.944f);
+    values.altitude = (int)std::nearbyint(aircraft.getAltitude() * 3.281f);
+    values.heading = (int)std::nearbyint(aircraft.getHeading());
+    values.verticalSpeed = (int)std::nearbyint(aircraft.getVerticalSpeed() * 196.85f);
+    values.throttle = (int)std::nearbyint(aircraft.getThrottle() * 100.0f);
+    values.flaps = aircraft.getFlapsLevel();
+    
+    // The runway marker stops at the edge of the map
+    int runwayRange = kMinimapSize / 2 - 10;
+    int runwayOffset = (int)std::nearbyint(aircraft.getPosition().z / 50.0f);
+    values.runwayOffset = std::max(-runwayRange, std::min(runwayRange, runwayOffset));
+    
+    values.gearDown = aircraft.isLandingGearDown();
+    values.onGround = aircraft.isOnGround();
+    values.stalling = aircraft.isStalling();
+    values.showHUD = true;
+    values.showMinimap = true;
+    values.x = x;
+    values.y = y;
+    values.width = width;
+    values.height = height;
+    return values;
+}
+
+void Renderer::buildOverlay(int viewIndex, const RenderView& view, const int* viewport, const RenderScene& scene,
+                            UIBatch& live) {
+    ViewOverlay& overlay = overlays[viewIndex];
+    overlay.visible = false;
+    if (!view.hudAircraft || (!scene.showHUD && !scene.showMinimap)) return;
+    
+    const Aircraft& aircraft = *view.hudAircraft;
+    OverlayValues values = readOverlayValues(aircraft, view.x, view.y, viewport[2], viewport[3]);
+    values.showHUD = scene.showHUD;
+    values.showMinimap = scene.showMinimap;
+    
+    // Where each part goes on screen
+    float left = (float)view.x;
+    float top = (float)view.y;
+    float right = left + values.width;
+    float bottom = top + values.height;
+    float centerX = left + values.width / 2.0f;
+    float centerY = top + values.height / 2.0f;
+    float panelY = bottom - kPanelHeight - kOverlayMargin;
+    float flightX = left + kOverlayMargin;
+    float statusX = right - kPanelWidth - kOverlayMargin;
+    float crosshairX = centerX - kCrosshairSize / 2.0f;
+    float crosshairY = centerY - kCrosshairSize / 2.0f;
+    float mapX = right - kMinimapSize - kOverlayMargin;
+    float mapY = top + kOverlayMargin;
+    
+    if (scene.showHUD) {
+        buildPitchLadder(live, aircraft.getPitch(), centerX, centerY);
+    }
     
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_LIGHTING);
+    bool steady = overlay.steadyFrames >= 0 && overlay.latest == values;
+    overlay.steadyFrames = steady ? std::min(overlay.steadyFrames + 1, kOverlaySteadyFrames) : 0;
+    overlay.latest = values;
     
-    float margin = 20.0f;
-    float panelWidth = 250.0f;
-    float panelHeight = 180.0f;
+    if (!overlaysCached || overlay.steadyFrames < kOverlaySteadyFrames) {
+        if (scene.showHUD) {
+            buildFlightPanel(live, values, flightX, panelY);
+            buildStatusPanel(live, values, aircraft, statusX, panelY);
+            buildCrosshair(live, crosshairX, crosshairY);
+        }
+        if (scene.showMinimap) {
+            buildMinimap(live, values, mapX, mapY);
+        }
+        return;
+    }
     
-    // Left panel - Flight data
-    renderRect(margin, screenHeight - panelHeight - margin, panelWidth, panelHeight, 
-               Color(0.0f, 0.0f, 0.0f, 0.6f), true);
-    renderRect(margin, screenHeight - panelHeight - margin, panelWidth, panelHeight, 
-               Color(0.3f, 0.8f, 0.3f, 0.8f), false);
+    overlay.visible = true;
+    if (overlay.valid && overlay.values == values) return;
+    
+    // Parts side by side along the texture, each with padding around it
+    auto paddedSize = [](int size) { return size + 2 * kOverlayPadding + 1; };
+    int textureWidth = 0;
+    int textureHeight = 0;
+    if (scene.showHUD) {
+        textureWidth += 2 * paddedSize(kPanelWidth) + paddedSize(kCrosshairSize);
+        textureHeight = paddedSize(kPanelHeight);
+    }
+    if (scene.showMinimap) {
+        textureWidth += paddedSize(kMinimapSize);
+        textureHeight = std::max(textureHeight, paddedSize(kMinimapSize));
+    }
+    
+    OverlayLayer& layer = overlay.layer;
+    UIBatch& batch = layer.getBatch();
+    layer.begin(textureWidth, textureHeight);
+    
+    // Regions land on whole screen pixels, so each part sits on the texture's
+    // pixel grid exactly as it would on the screen's
+    int cursor = 0;
+    auto place = [&](float screenX, float screenY, int width, int height, float& x, float& y) {
+        OverlayLayer::Region region;
+        region.x = cursor;
+        region.y = 0;
+        region.width = paddedSize(width);
+        region.height = paddedSize(height);
+        region.screenX = (int)std::floor(screenX) - kOverlayPadding;
+        region.screenY = (int)std::floor(screenY) - kOverlayPadding;
+        layer.addRegion(region);
+        cursor += region.width;
+        
+        x = region.x + (screenX - region.screenX);
+        y = region.y + (screenY - region.screenY);
+    };
+    
+    float x, y;
+    if (scene.showHUD) {
+        place(flightX, panelY, kPanelWidth, kPanelHeight, x, y);
+        buildFlightPanel(batch, values, x, y);
+        place(statusX, panelY, kPanelWidth, kPanelHeight, x, y);
+        buildStatusPanel(batch, values, aircraft, x, y);
+        place(crosshairX, crosshairY, kCrosshairSize, kCrosshairSize, x, y);
+        buildCrosshair(batch, x, y);
+    }
+    if (scene.showMinimap) {
+        place(mapX, mapY, kMinimapSize, kMinimapSize, x, y);
+        buildMinimap(batch, values, x, y);
+    }
+    
+    overlay.values = values;
+    overlay.valid = true;
+}
+
+void Renderer::buildFlightPanel(UIBatch& batch, const OverlayValues& values, float x, float y) {
+    batch.addRect(x, y, kPanelWidth, kPanelHeight, Color(0.0f, 0.0f, 0.0f, 0.6f));
+    batch.addRectOutline(x, y, kPanelWidth, kPanelHeight, Color(0.3f, 0.8f, 0.3f, 0.8f));
     
-    float textX = margin + 15.0f;
-    float textY = screenHeight - panelHeight - margin + 20.0f;
+    float textX = x + 15.0f;
+    float textY = y + 20.0f;
     float lineHeight = 22.0f;
     Color textColor = Color(0.3f, 1.0f, 0.3f, 1.0f);
     
     char buffer[64];
     
-    snprintf(buffer, sizeof(buffer), "SPEED: %.0f KTS", aircraft->getSpeed() * 1.944f);
-    renderText(buffer, textX, textY, 1.0f, textColor);
+    snprintf(buffer, sizeof(buffer), "SPEED: %d KTS", values.speed);
+    glyphCache.drawText(batch, buffer, textX, textY, 1.0f, textColor);
     textY += lineHeight;
     
-    snprintf(buffer, sizeof(buffer), "ALT: %.0f FT", aircraft->getAltitude() * 3.281f);
-    renderText(buffer, textX, textY, 1.0f, textColor);
+    snprintf(buffer, sizeof(buffer), "ALT: %d FT", values.altitude);
+    glyphCache.drawText(batch, buffer, textX, textY, 1.0f, textColor);
     textY += lineHeight;
     
-    snprintf(buffer, sizeof(buffer), "HDG: %.0f", aircraft->getHeading());
-    renderText(buffer, textX, textY, 1.0f, textColor);
+    snprintf(buffer, sizeof(buffer), "HDG: %d", values.heading);
+    glyphCache.drawText(batch, buffer, textX, textY, 1.0f, textColor);
     textY += lineHeight;
     
-    snprintf(buffer, sizeof(buffer), "VS: %.0f FPM", aircraft->getVerticalSpeed() * 196.85f);
-    renderText(buffer, textX, textY, 1.0f, textColor);
+    snprintf(buffer, sizeof(buffer), "VS: %d FPM", values.verticalSpeed);
+    glyphCache.drawText(batch, buffer, textX, textY, 1.0f, textColor);
     textY += lineHeight;
     
-    snprintf(buffer, sizeof(buffer), "THROTTLE: %.0f%%", aircraft->getThrottle() * 100.0f);
-    renderText(buffer, textX, textY, 1.0f, textColor);
+    snprintf(buffer, sizeof(buffer), "THROTTLE: %d%%", values.throttle);
+    glyphCache.drawText(batch, buffer, textX, textY, 1.0f, textColor);
     textY += lineHeight;
     
-    snprintf(buffer, sizeof(buffer), "FLAPS: %d", aircraft->getFlapsLevel());
-    renderText(buffer, textX, textY, 1.0f, textColor);
+    snprintf(buffer, sizeof(buffer), "FLAPS: %d", values.flaps);
+    glyphCache.drawText(batch, buffer, textX, textY, 1.0f, textColor);
+}
+
+void Renderer::buildStatusPanel(UIBatch& batch, const OverlayValues& values, const Aircraft& aircraft,
+                                float x, float y) {
+    batch.addRect(x, y, kPanelWidth, kPanelHeight, Color(0.0f, 0.0f, 0.0f, 0.6f));
+    batch.addRectOutline(x, y, kPanelWidth, kPanelHeight, Color(0.3f, 0.8f, 0.3f, 0.8f));
     
-    // Right panel - Aircraft status
-    float rightPanelX = screenWidth - panelWidth - margin;
-    renderRect(rightPanelX, screenHeight - panelHeight - margin, panelWidth, panelHeight,
-               Color(0.0f, 0.0f, 0.0f, 0.6f), true);
-    renderRect(rightPanelX, screenHeight - panelHeight - margin, panelWidth, panelHeight,
-               Color(0.3f, 0.8f, 0.3f, 0.8f), false);
+    float textX = x + 15.0f;
+    float textY = y + 20.0f;
+    float lineHeight = 22.0f;
+    Color textColor = Color(0.3f, 1.0f, 0.3f, 1.0f);
     
-    textX = rightPanelX + 15.0f;
-    textY = screenHeight - panelHeight - margin + 20.0f;
+    char buffer[64];
     
-    renderText(aircraft->getSpecs().name.c_str(), textX, textY, 1.0f, textColor);
+    glyphCache.drawText(batch, aircraft.getSpecs().name.c_str(), textX, textY, 1.0f, textColor);
     textY += lineHeight;
     
-    snprintf(buffer, sizeof(buffer), "GEAR: %s", aircraft->isLandingGearDown() ? "DOWN" : "UP");
-    renderText(buffer, textX, textY, 1.0f, 
-               aircraft->isLandingGearDown() ? Color(0.3f, 1.0f, 0.3f) : Color(1.0f, 0.8f, 0.3f));
+    snprintf(buffer, sizeof(buffer), "GEAR: %s", values.gearDown ? "DOWN" : "UP");
+    glyphCache.drawText(batch, buffer, textX, textY, 1.0f, 
+                        values.gearDown ? Color(0.3f, 1.0f, 0.3f) : Color(1.0f, 0.8f, 0.3f));
     textY += lineHeight;
     
-    snprintf(buffer, sizeof(buffer), "GROUND: %s", aircraft->isOnGround() ? "YES" : "NO");
-    renderText(buffer, textX, textY, 1.0f, textColor);
+    snprintf(buffer, sizeof(buffer), "GROUND: %s", values.onGround ? "YES" : "NO");
+    glyphCache.drawText(batch, buffer, textX, textY, 1.0f, textColor);
     textY += lineHeight;
     
     // Stall warning
-    if (aircraft->isStalling()) {
-        renderText("STALL WARNING!", textX, textY, 1.2f, Color::Red());
+    if (values.stalling) {
+        glyphCache.drawText(batch, "STALL WARNING!", textX, textY, 1.2f, Color::Red());
     }
+}
+
+void Renderer::buildCrosshair(UIBatch& batch, float x, float y) {
+    float centerX = x + kCrosshairSize / 2.0f;
+    float centerY = y + kCrosshairSize / 2.0f;
     
-    // Center HUD - Artificial horizon reference
-    float centerX = screenWidth / 2.0f;
-    float centerY = screenHeight / 2.0f;
-    
-    // Crosshairs
     Color crosshairColor = Color(0.3f, 1.0f, 0.3f, 0.8f);
-    renderRect(centerX - 30, centerY - 1, 20, 2, crosshairColor, true);
-    renderRect(centerX + 10, centerY - 1, 20, 2, crosshairColor, true);
-    renderRect(centerX - 1, centerY - 30, 2, 20, crosshairColor, true);
-    renderRect(centerX - 1, centerY + 10, 2, 20, crosshairColor, true);
-    
-    // Pitch ladder
-    float pitch = aircraft->getPitch();
+    batch.addRect(centerX - 30, centerY - 1, 20, 2, crosshairColor);
+    batch.addRect(centerX + 10, centerY - 1, 20, 2, crosshairColor);
+    batch.addRect(centerX - 1, centerY - 30, 2, 20, crosshairColor);
+    batch.addRect(centerX - 1, centerY + 10, 2, 20, crosshairColor);
+}
+
+void Renderer::buildPitchLadder(UIBatch& batch, float pitch, float centerX, float centerY) {
+    Color ladderColor = Color(0.3f, 1.0f, 0.3f, 0.8f);
     for (int deg = -30; deg <= 30; deg += 10) {
         if (deg == 0) continue;
-        float y = centerY + (pitch - deg) * 3.0f;
-        if (y > centerY - 100 && y < centerY + 100) {
+        float lineY = centerY + (pitch - deg) * 3.0f;
+        if (lineY > centerY - 100 && lineY < centerY + 100) {
             float lineWidth = (deg % 20 == 0) ? 40.0f : 20.0f;
-            renderRect(centerX - lineWidth, y, lineWidth * 2, 1, crosshairColor, true);
+            batch.addRect(centerX - lineWidth, lineY, lineWidth * 2, 1, ladderColor);
             
             char degStr[8];
             snprintf(degStr, sizeof(degStr), "%d", deg);
-            renderText(degStr, centerX - lineWidth - 25, y - 5, 0.7f, crosshairColor);
+            glyphCache.drawText(batch, degStr, centerX - lineWidth - 25, lineY - 5, 0.7f, ladderColor);
         }
     }
-    
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_LIGHTING);
 }
 
-void Renderer::renderMinimap(const Aircraft* aircraft, const Terrain* terrain) {
-    if (!aircraft) return;
-    
-    float mapSize = 150.0f;
-    float mapX = screenWidth - mapSize - 20.0f;
-    float mapY = 20.0f;
+void Renderer::buildMinimap(UIBatch& batch, const OverlayValues& values, float x, float y) {
+    float mapSize = (float)kMinimapSize;
     
     // Background
-    renderRect(mapX, mapY, mapSize, mapSize, Color(0.0f, 0.0f, 0.0f, 0.7f), true);
-    renderRect(mapX, mapY, mapSize, mapSize, Color(0.3f, 0.8f, 0.3f, 0.8f), false);
+    batch.addRect(x, y, mapSize, mapSize, Color(0.0f, 0.0f, 0.0f, 0.7f));
+    batch.addRectOutline(x, y, mapSize, mapSize, Color(0.3f, 0.8f, 0.3f, 0.8f));
     
     // Aircraft position indicator (center)
-    float centerX = mapX + mapSize / 2.0f;
-    float centerY = mapY + mapSize / 2.0f;
+    float centerX = x + mapSize / 2.0f;
+    float centerY = y + mapSize / 2.0f;
     
     // Aircraft triangle
-    float heading = aircraft->getHeading() * DEG_TO_RAD;
+    float heading = values.heading * DEG_TO_RAD;
     float triSize = 8.0f;
     
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_LIGHTING);
-    
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-    glOrtho(0, screenWidth, screenHeight, 0, -1, 1);
-    
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-    
-    glColor4f(0.0f, 1.0f, 0.0f, 1.0f);
-    glBegin(GL_TRIANGLES);
-    glVertex2f(centerX + triSize * std::sin(heading), centerY - triSize * std::cos(heading));
-    glVertex2f(centerX + triSize * 0.5f * std::sin(heading + 2.5f), centerY - triSize * 0.5f * std::cos(heading + 2.5f));
-    glVertex2f(centerX + triSize * 0.5f * std::sin(heading - 2.5f), centerY - triSize * 0.5f * std::cos(heading - 2.5f));
-    glEnd();
+    batch.addTriangle(centerX + triSize * std::sin(heading), centerY - triSize * std::cos(heading),
+                      centerX + triSize * 0.5f * std::sin(heading + 2.5f), centerY - triSize * 0.5f * std::cos(heading + 2.5f),
+                      centerX + triSize * 0.5f * std::sin(heading - 2.5f), centerY - triSize * 0.5f * std::cos(heading - 2.5f),
+                      Color(0.0f, 1.0f, 0.0f, 1.0f));
     
     // Runway indicator
-    glColor4f(1.0f, 1.0f, 1.0f, 0.8f);
     float runwayX = centerX;
-    float runwayY = centerY - aircraft->getPosition().z / 50.0f;
-    runwayY = std::max(mapY + 10.0f, std::min(mapY + mapSize - 10.0f, runwayY));
-    glBegin(GL_LINES);
-    glVertex2f(runwayX - 5, runwayY);
-    glVertex2f(runwayX + 5, runwayY);
-    glEnd();
-    
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
-    
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_LIGHTING);
+    float runwayY = centerY - values.runwayOffset;
+    batch.addLine(runwayX - 5, runwayY, runwayX + 5, runwayY, Color(1.0f, 1.0f, 1.0f, 0.8f));
     
     // North indicator
-    renderText("N", mapX + mapSize / 2 - 5, mapY + 5, 0.8f, Color::White());
+    glyphCache.drawText(batch, "N", x + mapSize / 2 - 5, y + 5, 0.8f, Color::White());
+}
+
+void Renderer::renderStats(float x, float y) {
+    char buffer[64];
+    Color color(1.0f, 1.0f, 0.4f, 1.0f);
+    float lineHeight = 18.0f;
+    
+    snprintf(buffer, sizeof(buffer), "CHUNKS: %d VISIBLE %d CULLED %d RELIT",
+             stats.terrainChunksVisible, stats.terrainChunksCulled, stats.terrainChunksRelit);
+    renderText(buffer, x, y, 0.8f, color);
+    y += lineHeight;
+    
+    snprintf(buffer, sizeof(buffer), "OBJECTS: %d VISIBLE %d CULLED",
+             stats.objectsVisible, stats.objectsCulled);
+    renderText(buffer, x, y, 0.8f, color);
+    y += lineHeight;
+    
+    snprintf(buffer, sizeof(buffer), "CLOUD PUFFS: %d VISIBLE %d CULLED",
+             stats.cloudPuffsVisible, stats.cloudPuffsCulled);
+    renderText(buffer, x, y, 0.8f, color);
+    y += lineHeight;
+    
+    snprintf(buffer, sizeof(buffer), "AIRCRAFT: %d FULL %d REDUCED %d IMPOSTOR",
+             stats.aircraftFull, stats.aircraftReduced, stats.aircraftImpostors);
+    renderText(buffer, x, y, 0.8f, color);
+    y += lineHeight;
+    
+    snprintf(buffer, sizeof(buffer), "PARTICLES: %d DRAWN", stats.particlesDrawn);
+    renderText(buffer, x, y, 0.8f, color);
+    y += lineHeight;
+    
+    snprintf(buffer, sizeof(buffer), "BUILD: %.2f MS ON %d THREADS",
+             stats.buildMilliseconds, stats.buildThreads);
+    renderText(buffer, x, y, 0.8f, color);
+    y += lineHeight;
+    
+    snprintf(buffer, sizeof(buffer), "HUD: %.2f MS, %d REDRAWN",
+             stats.overlayMilliseconds, stats.overlayRedraws);
+    renderText(buffer, x, y, 0.8f, color);
+    y += lineHeight;
+    
+    snprintf(buffer, sizeof(buffer), "GL STATE: %d ISSUED %d FILTERED",
+             stats.stateChangesIssued, stats.stateChangesFiltered);
+    renderText(buffer, x, y, 0.8f, color);
 }
 
 void Renderer::renderSphere(const Vector3& position, float radius, const Color& color) {
-    glPushMatrix();
-    glTranslatef(position.x, position.y, position.z);
-    
-    glColor4f(color.r, color.g, color.b, color.a);
-    
-    int stacks = 16;
-    int slices = 16;
-    
-    for (int i = 0; i < stacks; i++) {
-        float lat0 = PI * (-0.5f + (float)i / stacks);
-        float lat1 = PI * (-0.5f + (float)(i + 1) / stacks);
-        float y0 = std::sin(lat0) * radius;
-        float y1 = std::sin(lat1) * radius;
-        float r0 = std::cos(lat0) * radius;
-        float r1 = std::cos(lat1) * radius;
-        
-        glBegin(GL_QUAD_STRIP);
-        for (int j = 0; j <= slices; j++) {
-            float lng = 2 * PI * (float)j / slices;
-            float x = std::cos(lng);
-            float z = std::sin(lng);
-            
-            glNormal3f(x * r0 / radius, y0 / radius, z * r0 / radius);
-            glVertex3f(x * r0, y0, z * r0);
-            
-            glNormal3f(x * r1 / radius, y1 / radius, z * r1 / radius);
-            glVertex3f(x * r1, y1, z * r1);
-        }
-        glEnd();
-    }
-    
-    glPopMatrix();
+    PrimitiveMeshes::Instance instance = {
+        Matrix4::translation(position) * Matrix4::scale(radius, radius, radius), color
+    };
+    renderPrimitives(PrimitiveMeshes::Shape::SPHERE, &instance, 1);
 }
 
 void Renderer::renderCylinder(const Vector3& position, float radius, float height, const Color& color) {
-    glPushMatrix();
-    glTranslatef(position.x, position.y, position.z);
+    PrimitiveMeshes::Instance instance = {
+        Matrix4::translation(position) * Matrix4::scale(radius, height, radius), color
+    };
+    renderPrimitives(PrimitiveMeshes::Shape::CYLINDER, &instance, 1);
+}
+
+void Renderer::renderPrimitives(PrimitiveMeshes::Shape shape, const PrimitiveMeshes::Instance* instances,
+                                size_t count) {
+    if (!count || !primitives.isReady()) return;
     
-    glColor4f(color.r, color.g, color.b, color.a);
+    // Pixels per world unit at distance 1, from the vertical field of view
+    float pixelScale = projectionMatrix.m[5] * screenHeight * 0.5f;
+    float unitRadius = PrimitiveMeshes::getBoundingRadius(shape);
     
-    int slices = 20;
+    for (auto& batch : primitiveBatches) {
+        batch.clear();
+    }
     
-    // Side
-    glBegin(GL_QUAD_STRIP);
-    for (int i = 0; i <= slices; i++) {
-        float angle = 2 * PI * i / slices;
-        float x = std::cos(angle) * radius;
-        float z = std::sin(angle) * radius;
+    for (size_t i = 0; i < count; i++) {
+        const float* m = instances[i].transform.m;
+        Vector3 center(m[12], m[13], m[14]);
+        float scale = std::max(Vector3(m[0], m[1], m[2]).length(),
+                               std::max(Vector3(m[4], m[5], m[6]).length(), Vector3(m[8], m[9], m[10]).length()));
+        float radius = unitRadius * scale;
         
-        glNormal3f(std::cos(angle), 0, std::sin(angle));
-        glVertex3f(x, 0, z);
-        glVertex3f(x, height, z);
+        if (!isVisible(center, radius)) {
+            stats.objectsCulled++;
+            continue;
+        }
+        stats.objectsVisible++;
+        
+        float distance = std::max((center - eyePosition).length(), 0.01f);
+        float pixels = radius * pixelScale / distance;
+        PrimitiveMeshes::Detail detail = pixels < kLowDetailPixels ? PrimitiveMeshes::Detail::LOW :
+                                         pixels < kMediumDetailPixels ? PrimitiveMeshes::Detail::MEDIUM :
+                                         PrimitiveMeshes::Detail::HIGH;
+        primitiveBatches[(int)detail].push_back(instances[i]);
     }
-    glEnd();
     
-    // Top cap
-    glBegin(GL_TRIANGLE_FAN);
-    glNormal3f(0, 1, 0);
-    glVertex3f(0, height, 0);
-    for (int i = 0; i <= slices; i++) {
-        float angle = 2 * PI * i / slices;
-        glVertex3f(std::cos(angle) * radius, height, std::sin(angle) * radius);
-    }
-    glEnd();
+    beginLitPass();
     
-    // Bottom cap
-    glBegin(GL_TRIANGLE_FAN);
-    glNormal3f(0, -1, 0);
-    glVertex3f(0, 0, 0);
-    for (int i = slices; i >= 0; i--) {
-        float angle = 2 * PI * i / slices;
-        glVertex3f(std::cos(angle) * radius, 0, std::sin(angle) * radius);
+    for (int detail = 0; detail < PrimitiveMeshes::kDetailCount; detail++) {
+        const auto& batch = primitiveBatches[detail];
+        if (batch.empty()) continue;
+        
+        if (litInstancedProgram.isValid()) {
+            glState.useProgram(litInstancedProgram.getId());
+            primitives.drawInstanced(shape, (PrimitiveMeshes::Detail)detail, batch.data(), batch.size());
+        } else {
+            // Scaled instances need their normals renormalized for fixed-function lighting
+            glState.enable(GL_NORMALIZE);
+            primitives.drawEach(shape, (PrimitiveMeshes::Detail)detail, batch.data(), batch.size());
+            glState.disable(GL_NORMALIZE);
+        }
     }
-    glEnd();
-    
-    glPopMatrix();
 }
@@ -0,0 +1,101 @@
+#include "ShaderProgram.h"
+#include "GLExtensions.h"
+#include <iostream>
+#include <vector>
+
+ShaderProgram::ShaderProgram() {
+}
+
+ShaderProgram::~ShaderProgram() {
+    release();
+}
+
+unsigned int ShaderProgram::compileStage(unsigned int type, const std::string& source) {
+    GLuint shader = glCreateShader(type);
+    const GLchar* text = source.c_str();
+    glShaderSource(shader, 1, &text, nullptr);
+    glCompileShader(shader);
+    
+    GLint status = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        GLint length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::vector<GLchar> log(length > 1 ? length : 1, '\0');
+        glGetShaderInfoLog(shader, (GLsizei)log.size(), nullptr, log.data());
+        
+        std::cerr << "Shader '" << name << "' " << (type == GL_VERTEX_SHADER ? "vertex" : "fragment")
+                  << " stage failed to compile:\n" << log.data() << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+bool ShaderProgram::compile(const std::string& programName, const std::string& vertexSource,
+                            const std::string& fragmentSource) {
+    release();
+    name = programName;
+    
+    GLuint vertexShader = compileStage(GL_VERTEX_SHADER, vertexSource);
+    if (!vertexShader) return false;
+    
+    GLuint fragmentShader = compileStage(GL_FRAGMENT_SHADER, fragmentSource);
+    if (!fragmentShader) {
+        glDeleteShader(vertexShader);
+        return false;
+    }
+    
+    program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+    
+    // The program keeps the compiled stages alive
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::vector<GLchar> log(length > 1 ? length : 1, '\0');
+        glGetProgramInfoLog(program, (GLsizei)log.size(), nullptr, log.data());
+        
+        std::cerr << "Shader '" << name << "' failed to link:\n" << log.data() << std::endl;
+        release();
+        return false;
+    }
+    
+    return true;
+}
+
+void ShaderProgram::release() {
+    if (program) {
+        glDeleteProgram(program);
+        program = 0;
+    }
+    uniformLocations.clear();
+}
+
+int ShaderProgram::getUniformLocation(const char* uniformName) {
+    auto it = uniformLocations.find(uniformName);
+    if (it != uniformLocations.end()) {
+        return it->second;
+    }
+    
+    int location = program ? glGetUniformLocation(program, uniformName) : -1;
+    uniformLocations.emplace(uniformName, location);
+    return location;
+}
+
+bool ShaderProgram::bindUniformBlock(const char* blockName, unsigned int bindingPoint) {
+    if (!program || !GLExt::hasUniformBuffer) return false;
+    
+    GLuint blockIndex = GLExt::GetUniformBlockIndex(program, blockName);
+    if (blockIndex == GL_INVALID_INDEX) return false;
+    
+    GLExt::UniformBlockBinding(program, blockIndex, bindingPoint);
+    return true;
+}
@@ -1,7 +1,27 @@
 #include "Sky.h"
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 
+namespace {
+    // Brings radiance from the atmosphere tables, for a sun of unit
+    // irradiance, to display brightness; the clear noon zenith comes out close
+    // to the fixed daytime sky
+    constexpr float kSkyExposure = 50.0f;
+    
+    // Sine of the lowest elevation looked up; below it the ground or the fog
+    // hides the sky, which keeps its horizon color
+    constexpr float kHorizonElevation = 0.01f;
+    
+    const Color kNightTop(0.05f, 0.05f, 0.15f);
+    const Color kNightHorizon(0.1f, 0.1f, 0.2f);
+    const Color kMoonColor(0.8f, 0.8f, 0.9f);
+    
+    float luminance(float r, float g, float b) {
+        return 0.2126f * r + 0.7152f * g + 0.0722f * b;
+    }
+}
+
 Sky::Sky() {
     setTimeOfDay(12.0f);  // Start at noon
     generateClouds();
@@ -9,6 +29,12 @@ Sky::Sky() {
 
 Sky::~Sky() {}
 
+bool Sky::loadAtmosphere(const std::string& cachePath) {
+    if (!atmosphere.initialize(cachePath)) return false;
+    updateSkyColors();
+    return true;
+}
+
 void Sky::update(float deltaTime) {
     // Advance time if enabled
     if (daySpeed > 0) {
@@ -88,6 +114,10 @@ void Sky::updateSkyColors() {
     // Fog color matches horizon
     fogColor = skyColorHorizon;
     
+    if (atmosphere.isReady()) {
+        updateAtmosphereColors();
+    }
+    
     // Adjust fog based on weather
     if (currentWeather == 1) {
         fogDensity = 0.002f;
@@ -104,6 +134,63 @@ void Sky::updateSkyColors() {
     }
 }
 
+void Sky::updateAtmosphereColors() {
+    skyColorTop = getSkyColor(Vector3(0, 1, 0), 0.0f);
+    
+    // Averaged around the horizon, which is brighter towards the sun
+    const int samples = 8;
+    float horizon[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < samples; i++) {
+        float angle = 2.0f * PI * i / samples;
+        Color color = getSkyColor(Vector3(std::cos(angle), 0.0f, std::sin(angle)), 0.0f);
+        horizon[0] += color.r / samples;
+        horizon[1] += color.g / samples;
+        horizon[2] += color.b / samples;
+    }
+    skyColorHorizon = Color(horizon[0], horizon[1], horizon[2]);
+    fogColor = skyColorHorizon;
+    
+    // Sunlight reddens through the longer path of air near the horizon;
+    // the moon takes over as it sets
+    Color light = atmosphere.getTransmittance(0.0f, getSunDirection().y);
+    float peak = std::max(light.r, std::max(light.g, light.b));
+    float day = std::min(peak / 0.05f, 1.0f);
+    if (peak > 0.0f) {
+        light = Color(light.r / peak, light.g / peak, light.b / peak);
+    }
+    sunColor = Color(kMoonColor.r + (light.r - kMoonColor.r) * day, kMoonColor.g + (light.g - kMoonColor.g) * day,
+                     kMoonColor.b + (light.b - kMoonColor.b) * day);
+}
+
+Color Sky::getSkyColor(const Vector3& direction, float altitude) const {
+    Vector3 view = direction.normalized();
+    float up = std::max(view.y, 0.0f);
+    view.y = std::max(view.y, kHorizonElevation);
+    Color radiance = atmosphere.getSkyRadiance(altitude, view, getSunDirection());
+    
+    // Exposed by luminance rather than per channel, so a bright sunset
+    // horizon saturates to orange instead of washing out to white
+    float brightness = luminance(radiance.r, radiance.g, radiance.b);
+    float scale = brightness > 0.0f ? (1.0f - std::exp(-kSkyExposure * brightness)) / brightness : 0.0f;
+    float rgb[3] = { std::min(radiance.r * scale, 1.0f), std::min(radiance.g * scale, 1.0f),
+                     std::min(radiance.b * scale, 1.0f) };
+    
+    // Cloud cover greys the sky out, and overcast darkens it
+    if (currentWeather > 0) {
+        float amount = currentWeather == 1 ? 0.6f : 0.85f;
+        float grey = luminance(rgb[0], rgb[1], rgb[2]) * (currentWeather == 1 ? 1.0f : 0.8f);
+        for (float& channel : rgb) {
+            channel += (grey - channel) * amount;
+        }
+    }
+    
+    // Never darker than the night sky
+    float night[3] = { kNightHorizon.r + (kNightTop.r - kNightHorizon.r) * up,
+                       kNightHorizon.g + (kNightTop.g - kNightHorizon.g) * up,
+                       kNightHorizon.b + (kNightTop.b - kNightHorizon.b) * up };
+    return Color(std::max(rgb[0], night[0]), std::max(rgb[1], night[1]), std::max(rgb[2], night[2]));
+}
+
 Vector3 Sky::getSunDirection() const {
     float sunAngle = (timeOfDay - 6.0f) / 12.0f * PI;
     
@@ -117,8 +204,10 @@ Vector3 Sky::getSunDirection() const {
 void Sky::generateClouds() {
     cloudPositions.clear();
     cloudSizes.clear();
+    cloudPuffs.clear();
     
     int cloudCount = 50 + currentWeather * 30;  // More clouds in bad weather
+    int puffsPerCloud = 8 + currentWeather * 8;  // And denser ones
     
     for (int i = 0; i < cloudCount; i++) {
         float x = ((float)rand() / RAND_MAX - 0.5f) * 8000.0f;
@@ -129,6 +218,20 @@ void Sky::generateClouds() {
         
         float size = 100.0f + ((float)rand() / RAND_MAX) * 200.0f;
         cloudSizes.push_back(size);
+        
+        // Puffs spread in a flattened blob; lower ones are shaded darker
+        for (int p = 0; p < puffsPerCloud; p++) {
+            CloudPuff puff;
+            puff.cloud = i;
+            puff.offset = Vector3(
+                ((float)rand() / RAND_MAX - 0.5f) * 2.0f * size,
+                ((float)rand() / RAND_MAX - 0.5f) * 0.5f * size,
+                ((float)rand() / RAND_MAX - 0.5f) * 2.0f * size
+            );
+            puff.size = size * (0.35f + ((float)rand() / RAND_MAX) * 0.25f);
+            puff.shade = 0.8f + 0.2f * (puff.offset.y / (0.5f * size) + 0.5f);
+            cloudPuffs.push_back(puff);
+        }
     }
 }
 
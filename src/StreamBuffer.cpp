@@ -0,0 +1,139 @@
+#include "StreamBuffer.h"
+#include "GLExtensions.h"
+#include "GLStateCache.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+StreamBuffer::StreamBuffer() {}
+
+StreamBuffer::~StreamBuffer() {
+    release();
+}
+
+bool StreamBuffer::initialize(GLStateCache& glState, size_t size) {
+    release();
+    
+    state = &glState;
+    frameSize = (std::max(size, kAlignment) + kAlignment - 1) / kAlignment * kAlignment;
+    if (!createBuffer()) return false;
+    
+    std::cout << "Stream buffer: " << kFramesInFlight << " x " << frameSize / 1024 << " KB, "
+              << (isPersistent() ? "persistently mapped" : "orphaned per frame") << std::endl;
+    return true;
+}
+
+void StreamBuffer::release() {
+    if (!state) return;
+    destroyBuffer();
+    state = nullptr;
+}
+
+bool StreamBuffer::createBuffer() {
+    glGenBuffers(1, &buffer);
+    state->bindBuffer(GL_ARRAY_BUFFER, buffer);
+    
+    if (GLExt::hasBufferStorage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GLsizeiptr total = (GLsizeiptr)(frameSize * kFramesInFlight);
+        GLExt::BufferStorage(GL_ARRAY_BUFFER, total, nullptr, flags);
+        mapped = (unsigned char*)GLExt::MapBufferRange(GL_ARRAY_BUFFER, 0, total, flags);
+        if (mapped) return true;
+        
+        // Storage is immutable, so start over with a plain buffer
+        std::cerr << "Persistent mapping failed; streaming through orphaned buffers" << std::endl;
+        state->deleteBuffer(buffer);
+        glGenBuffers(1, &buffer);
+        state->bindBuffer(GL_ARRAY_BUFFER, buffer);
+    }
+    
+    glBufferData(GL_ARRAY_BUFFER, frameSize, nullptr, GL_STREAM_DRAW);
+    staging.resize(frameSize);
+    return glGetError() == GL_NO_ERROR;
+}
+
+void StreamBuffer::destroyBuffer() {
+    for (int i = 0; i < kFramesInFlight; i++) {
+        waitForSegment(i);
+    }
+    
+    if (mapped) {
+        state->bindBuffer(GL_ARRAY_BUFFER, buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        mapped = nullptr;
+    }
+    state->deleteBuffer(buffer);
+    buffer = 0;
+    
+    staging.clear();
+    staging.shrink_to_fit();
+    flushed = 0;
+    head.store(0, std::memory_order_relaxed);
+}
+
+void StreamBuffer::waitForSegment(int index) {
+    GLsync fence = (GLsync)fences[index];
+    if (!fence) return;
+    
+    // Only blocks when the CPU is a full ring of frames ahead of the GPU
+    GLExt::ClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+    GLExt::DeleteSync(fence);
+    fences[index] = nullptr;
+}
+
+void StreamBuffer::beginFrame() {
+    if (!buffer) return;
+    
+    // Last frame asked for more than fitted; double until it does
+    size_t demand = head.load(std::memory_order_relaxed);
+    if (demand > frameSize) {
+        size_t size = frameSize;
+        while (size < demand) size *= 2;
+        destroyBuffer();
+        frameSize = size;
+        if (!createBuffer()) {
+            std::cerr << "Stream buffer resize to " << size << " bytes failed" << std::endl;
+            return;
+        }
+    }
+    
+    segment = (segment + 1) % kFramesInFlight;
+    if (mapped) {
+        waitForSegment(segment);
+    } else {
+        // Detach the storage the GPU may still read instead of waiting for it
+        state->bindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, frameSize, nullptr, GL_STREAM_DRAW);
+        flushed = 0;
+    }
+    head.store(0, std::memory_order_relaxed);
+}
+
+void StreamBuffer::endFrame() {
+    if (!mapped) return;
+    fences[segment] = GLExt::FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void* StreamBuffer::allocate(size_t size, size_t& offset) {
+    size = (size + kAlignment - 1) / kAlignment * kAlignment;
+    size_t start = head.fetch_add(size, std::memory_order_relaxed);
+    if (!buffer || start + size > frameSize) return nullptr;
+    
+    if (mapped) {
+        offset = segment * frameSize + start;
+        return mapped + offset;
+    }
+    offset = start;
+    return staging.data() + start;
+}
+
+void StreamBuffer::flush() {
+    if (mapped || !buffer) return;
+    
+    size_t end = std::min(head.load(std::memory_order_relaxed), frameSize);
+    if (end <= flushed) return;
+    
+    state->bindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferSubData(GL_ARRAY_BUFFER, flushed, end - flushed, staging.data() + flushed);
+    flushed = end;
+}
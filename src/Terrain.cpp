@@ -1,6 +1,35 @@
 #include "Terrain.h"
+#include <algorithm>
 #include <cmath>
 
+namespace {
+    // Palette indexed by Biome
+    const Color kBiomePalette[(int)Biome::COUNT] = {
+        {0.20f, 0.60f, 0.20f, 1.0f},   // Grassland
+        {0.10f, 0.38f, 0.14f, 1.0f},   // Forest
+        {0.80f, 0.70f, 0.48f, 1.0f},   // Desert
+        {0.45f, 0.42f, 0.40f, 1.0f},   // Rock
+        {0.95f, 0.95f, 0.98f, 1.0f}    // Snow
+    };
+    
+    // Sky visibility looks for the highest terrain in eight directions, out
+    // to kOcclusionReach vertices, so chunks are generated with a border of
+    // that many vertices of the chunks around them
+    constexpr int kOcclusionReach = 4;
+    constexpr int kOcclusionSteps[] = { 1, 2, 4 };
+    constexpr int kOcclusionDirections[8][2] = {
+        { 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 }
+    };
+}
+
+size_t TerrainChunk::getMemoryUsage() const {
+    return vertices.capacity() * sizeof(Vector3) +
+           normals.capacity() * sizeof(Vector3) +
+           colors.capacity() * sizeof(Color) +
+           biomes.capacity() * sizeof(Biome) +
+           skyVisibility.capacity() * sizeof(float);
+}
+
 Terrain::Terrain() {
     // Initialize runway on origin chunk
     mainRunway.startX = -200.0f;
@@ -20,17 +49,28 @@ void Terrain::generate(int size, float scale) {
 }
 
 void Terrain::update(float deltaTime, const Vector3& playerPosition) {
-    int playerChunkX = (int)std::floor(playerPosition.x / (chunkSize * terrainScale));
-    int playerChunkZ = (int)std::floor(playerPosition.z / (chunkSize * terrainScale));
-    
-    std::pair<int, int> currentChunk = {playerChunkX, playerChunkZ};
+    update(deltaTime, &playerPosition, 1);
+}
+
+void Terrain::update(float deltaTime, const Vector3* playerPositions, int playerCount) {
+    // Only update if a player moved to a new chunk, or one joined or left
+    bool moved = (int)lastPlayerChunks.size() != playerCount;
+    for (int i = 0; i < playerCount && !moved; i++) {
+        moved = getChunkCoord(playerPositions[i]) != lastPlayerChunks[i];
+    }
+    if (!moved) return;
     
-    // Only update if player moved to a new chunk
-    if (currentChunk != lastPlayerChunk) {
-        lastPlayerChunk = currentChunk;
-        loadChunksAroundPlayer(playerPosition);
-        unloadDistantChunks(playerPosition);
+    lastPlayerChunks.clear();
+    for (int i = 0; i < playerCount; i++) {
+        lastPlayerChunks.push_back(getChunkCoord(playerPositions[i]));
+        loadChunksAroundPlayer(playerPositions[i]);
     }
+    unloadDistantChunks();
+}
+
+std::pair<int, int> Terrain::getChunkCoord(const Vector3& position) const {
+    return {(int)std::floor(position.x / (chunkSize * terrainScale)),
+            (int)std::floor(position.z / (chunkSize * terrainScale))};
 }
 
 void Terrain::loadChunksAroundPlayer(const Vector3& playerPosition) {
@@ -50,18 +90,22 @@ void Terrain::loadChunksAroundPlayer(const Vector3& playerPosition) {
     }
 }
 
-void Terrain::unloadDistantChunks(const Vector3& playerPosition) {
-    int playerChunkX = (int)std::floor(playerPosition.x / (chunkSize * terrainScale));
-    int playerChunkZ = (int)std::floor(playerPosition.z / (chunkSize * terrainScale));
-    
+void Terrain::unloadDistantChunks() {
     int unloadDistance = renderDistance + 2;
     std::vector<std::pair<int, int>> toRemove;
     
-    // Find chunks to unload
+    // Find chunks out of range of every player
     for (auto& [coord, chunk] : activeChunks) {
-        int dx = std::abs(coord.first - playerChunkX);
-        int dz = std::abs(coord.second - playerChunkZ);
-        if (dx > unloadDistance || dz > unloadDistance) {
+        bool inRange = false;
+        for (const auto& player : lastPlayerChunks) {
+            int dx = std::abs(coord.first - player.first);
+            int dz = std::abs(coord.second - player.second);
+            if (dx <= unloadDistance && dz <= unloadDistance) {
+                inRange = true;
+                break;
+            }
+        }
+        if (!inRange) {
             toRemove.push_back(coord);
         }
     }
@@ -70,6 +114,15 @@ void Terrain::unloadDistantChunks(const Vector3& playerPosition) {
     for (auto& coord : toRemove) {
         activeChunks.erase(coord);
     }
+    chunksUnloaded += (int)toRemove.size();
+}
+
+size_t Terrain::getResidentMemory() const {
+    size_t total = 0;
+    for (const auto& [coord, chunk] : activeChunks) {
+        total += sizeof(TerrainChunk) + chunk->getMemoryUsage();
+    }
+    return total;
 }
 
 void Terrain::generateChunk(int chunkX, int chunkZ) {
@@ -83,56 +136,161 @@ void Terrain::generateChunk(int chunkX, int chunkZ) {
     float baseX = chunkX * chunkSize * terrainScale;
     float baseZ = chunkZ * chunkSize * terrainScale;
     
+    chunk->vertices.reserve(chunkSize * chunkSize);
+    chunk->normals.reserve(chunkSize * chunkSize);
+    chunk->colors.reserve(chunkSize * chunkSize);
+    chunk->biomes.reserve(chunkSize * chunkSize);
+    chunk->skyVisibility.reserve(chunkSize * chunkSize);
+    
+    // Heights including the border, so normals and sky visibility along the
+    // edges match the chunks next door
+    int border = kOcclusionReach;
+    int gridWidth = chunkSize + 2 * border;
+    std::vector<float> heights(gridWidth * gridWidth);
+    for (int gz = 0; gz < gridWidth; ++gz) {
+        for (int gx = 0; gx < gridWidth; ++gx) {
+            heights[gz * gridWidth + gx] = sampleHeight(baseX + (gx - border) * terrainScale,
+                                                        baseZ + (gz - border) * terrainScale);
+        }
+    }
+    auto heightAt = [&](int x, int z) { return heights[(z + border) * gridWidth + x + border]; };
+    
+    float minHeight = 1e30f;
+    float maxHeight = -1e30f;
+    
     // Generate vertices for this chunk
     for (int z = 0; z < chunkSize; ++z) {
         for (int x = 0; x < chunkSize; ++x) {
             float worldX = baseX + x * terrainScale;
             float worldZ = baseZ + z * terrainScale;
+            float height = heightAt(x, z);
+            
+            chunk->vertices.push_back({worldX, height, worldZ});
+            minHeight = std::min(minHeight, height);
+            maxHeight = std::max(maxHeight, height);
+        }
+    }
+    
+    float chunkExtent = (chunkSize - 1) * terrainScale;
+    chunk->bounds = AABB({baseX, minHeight, baseZ}, {baseX + chunkExtent, maxHeight, baseZ + chunkExtent});
+    
+    // Generate normals using neighbor heights
+    for (int z = 0; z < chunkSize; ++z) {
+        for (int x = 0; x < chunkSize; ++x) {
+            Vector3 e1 = {2.0f * terrainScale, heightAt(x + 1, z) - heightAt(x - 1, z), 0.0f};
+            Vector3 e2 = {0.0f, heightAt(x, z + 1) - heightAt(x, z - 1), 2.0f * terrainScale};
             
-            float height = perlinNoise(worldX * 0.01f, worldZ * 0.01f) * heightScale;
+            // Simplified normal: average of edge directions
+            Vector3 normal;
+            normal.x = -(e1.y * e2.z - e1.z * e2.y);
+            normal.y = (e1.x * e2.z - e1.z * e2.x);
+            normal.z = -(e1.x * e2.y - e1.y * e2.x);
             
-            // Flatten runway area
-            if (std::abs(worldZ - mainRunway.startZ) < mainRunway.width &&
-                worldX >= mainRunway.startX && worldX <= mainRunway.endX) {
-                height = mainRunway.height;
+            float len = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+            if (len > 0.001f) {
+                normal.x /= len;
+                normal.y /= len;
+                normal.z /= len;
             }
             
-            chunk->vertices.push_back({worldX, height, worldZ});
-            chunk->colors.push_back({0.2f, 0.6f, 0.2f, 1.0f}); // Green grass
+            chunk->normals.push_back(normal);
+        }
+    }
+    
+    // Sky visibility: one minus the mean sine of the horizon's elevation,
+    // taken as the steepest rise to a few points in each direction
+    constexpr int stepCount = sizeof(kOcclusionSteps) / sizeof(kOcclusionSteps[0]);
+    int offsets[8][stepCount];
+    float inverseDistances[8][stepCount];
+    for (int d = 0; d < 8; ++d) {
+        const int* direction = kOcclusionDirections[d];
+        float spacing = (direction[0] && direction[1]) ? terrainScale * 1.41421356f : terrainScale;
+        for (int s = 0; s < stepCount; ++s) {
+            offsets[d][s] = (direction[1] * gridWidth + direction[0]) * kOcclusionSteps[s];
+            inverseDistances[d][s] = 1.0f / (kOcclusionSteps[s] * spacing);
         }
     }
     
-    // Generate normals using neighbor vertices
     for (int z = 0; z < chunkSize; ++z) {
         for (int x = 0; x < chunkSize; ++x) {
-            Vector3 normal = {0.0f, 1.0f, 0.0f};
-            if (x > 0 && x < chunkSize - 1 && z > 0 && z < chunkSize - 1) {
-                Vector3 v0 = chunk->vertices[z * chunkSize + (x - 1)];
-                Vector3 v1 = chunk->vertices[z * chunkSize + (x + 1)];
-                Vector3 v2 = chunk->vertices[(z - 1) * chunkSize + x];
-                Vector3 v3 = chunk->vertices[(z + 1) * chunkSize + x];
-                
-                Vector3 e1 = {v1.x - v0.x, v1.y - v0.y, v1.z - v0.z};
-                Vector3 e2 = {v3.x - v2.x, v3.y - v2.y, v3.z - v2.z};
-                
-                // Simplified normal: average of edge directions
-                normal.x = -(e1.y * e2.z - e1.z * e2.y);
-                normal.y = (e1.x * e2.z - e1.z * e2.x);
-                normal.z = -(e1.x * e2.y - e1.y * e2.x);
-                
-                float len = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
-                if (len > 0.001f) {
-                    normal.x /= len;
-                    normal.y /= len;
-                    normal.z /= len;
+            const float* center = &heights[(z + border) * gridWidth + x + border];
+            float blocked = 0.0f;
+            
+            for (int d = 0; d < 8; ++d) {
+                float steepest = 0.0f;
+                for (int s = 0; s < stepCount; ++s) {
+                    steepest = std::max(steepest, (center[offsets[d][s]] - *center) * inverseDistances[d][s]);
                 }
+                blocked += steepest / std::sqrt(1.0f + steepest * steepest);
             }
             
-            chunk->normals.push_back(normal);
+            chunk->skyVisibility.push_back(1.0f - blocked / 8.0f);
+        }
+    }
+    
+    // Sample the climate field (temperature, moisture) on a coarse grid only.
+    // It varies over kilometers, so bilinear upsampling is indistinguishable
+    // from evaluating the extra noise octaves at every vertex.
+    int step = biomeGridStep;
+    int gridSize = (chunkSize - 1) / step + 2;
+    std::vector<float> temperatureGrid(gridSize * gridSize);
+    std::vector<float> moistureGrid(gridSize * gridSize);
+    
+    for (int gz = 0; gz < gridSize; ++gz) {
+        for (int gx = 0; gx < gridSize; ++gx) {
+            float worldX = baseX + gx * step * terrainScale;
+            float worldZ = baseZ + gz * step * terrainScale;
+            temperatureGrid[gz * gridSize + gx] = climateNoise(worldX * 0.0004f, worldZ * 0.0004f);
+            moistureGrid[gz * gridSize + gx] = climateNoise(worldX * 0.0006f + 173.0f, worldZ * 0.0006f - 91.0f);
+        }
+    }
+    
+    // Upsample to vertices and pick a palette entry per vertex
+    for (int z = 0; z < chunkSize; ++z) {
+        int gz = z / step;
+        float fz = (float)(z % step) / step;
+        
+        for (int x = 0; x < chunkSize; ++x) {
+            int gx = x / step;
+            float fx = (float)(x % step) / step;
+            
+            int g00 = gz * gridSize + gx;
+            int g10 = g00 + 1;
+            int g01 = g00 + gridSize;
+            int g11 = g01 + 1;
+            
+            float temperature =
+                (temperatureGrid[g00] * (1.0f - fx) + temperatureGrid[g10] * fx) * (1.0f - fz) +
+                (temperatureGrid[g01] * (1.0f - fx) + temperatureGrid[g11] * fx) * fz;
+            float moisture =
+                (moistureGrid[g00] * (1.0f - fx) + moistureGrid[g10] * fx) * (1.0f - fz) +
+                (moistureGrid[g01] * (1.0f - fx) + moistureGrid[g11] * fx) * fz;
+            
+            int idx = z * chunkSize + x;
+            const Vector3& vertex = chunk->vertices[idx];
+            float slope = 1.0f - chunk->normals[idx].y;
+            
+            Biome biome = Biome::GRASSLAND;
+            if (!isOnRunway(vertex)) {
+                biome = classifyBiome(vertex.y, temperature, moisture, slope);
+            }
+            
+            chunk->biomes.push_back(biome);
+            chunk->colors.push_back(kBiomePalette[(int)biome]);
         }
     }
     
     chunk->generated = true;
+    chunksGenerated++;
+}
+
+float Terrain::sampleHeight(float worldX, float worldZ) const {
+    // Flatten runway area
+    if (std::abs(worldZ - mainRunway.startZ) < mainRunway.width &&
+        worldX >= mainRunway.startX && worldX <= mainRunway.endX) {
+        return mainRunway.height;
+    }
+    return perlinNoise(worldX * 0.01f, worldZ * 0.01f) * heightScale;
 }
 
 float Terrain::getHeightAt(float x, float z) const {
@@ -195,6 +353,32 @@ float Terrain::smoothNoise(float x, float z) const {
     return nx0 * (1.0f - v) + nx1 * v;
 }
 
+float Terrain::climateNoise(float x, float z) const {
+    // Two low-frequency octaves, remapped to 0-1
+    float value = smoothNoise(x, z) * 0.67f + smoothNoise(x * 2.0f, z * 2.0f) * 0.33f;
+    return value * 0.5f + 0.5f;
+}
+
+Biome Terrain::classifyBiome(float height, float temperature, float moisture, float slope) const {
+    // Temperature drops with altitude
+    float altitude = height / heightScale;              // Roughly -0.5 to 0.5
+    float coldness = altitude + (0.5f - temperature) * 0.3f;
+    
+    if (coldness > 0.3f && slope < 0.85f) {
+        return Biome::SNOW;
+    }
+    if (slope > 0.8f || altitude > 0.3f) {
+        return Biome::ROCK;
+    }
+    if (temperature > 0.55f && moisture < 0.45f) {
+        return Biome::DESERT;
+    }
+    if (moisture > 0.5f) {
+        return Biome::FOREST;
+    }
+    return Biome::GRASSLAND;
+}
+
 float Terrain::perlinNoise(float x, float z) const {
     float value = 0.0f;
     float amplitude = 1.0f;
@@ -0,0 +1,83 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threadCount) {
+    if (threadCount <= 0) {
+        threadCount = (int)std::thread::hardware_concurrency();
+    }
+    threadCount = std::max(1, std::min(threadCount, kMaxThreads));
+    
+    // The caller is thread 0
+    workers.reserve(threadCount - 1);
+    for (int i = 1; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::run(int count, const std::function<void(int, int)>& function) {
+    if (count <= 0) return;
+    
+    // Not worth waking anyone for
+    if (workers.empty() || count == 1) {
+        for (int i = 0; i < count; i++) {
+            function(i, 0);
+        }
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &function;
+        jobCount = count;
+        nextJob.store(0, std::memory_order_relaxed);
+        busyWorkers = (int)workers.size();
+        batch++;
+    }
+    wake.notify_all();
+    
+    runJobs(0);
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return busyWorkers == 0; });
+    job = nullptr;
+}
+
+void ThreadPool::workerLoop(int thread) {
+    uint64_t seenBatch = 0;
+    
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || batch != seenBatch; });
+            if (stopping) return;
+            seenBatch = batch;
+        }
+        
+        runJobs(thread);
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busyWorkers == 0) {
+            finished.notify_one();
+        }
+    }
+}
+
+void ThreadPool::runJobs(int thread) {
+    while (true) {
+        int index = nextJob.fetch_add(1, std::memory_order_relaxed);
+        if (index >= jobCount) break;
+        (*job)(index, thread);
+    }
+}
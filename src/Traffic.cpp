@@ -0,0 +1,91 @@
+#include "Traffic.h"
+#include "Aircraft.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const float kMinRadius = 400.0f;
+    const float kMaxRadius = 6000.0f;
+    const float kMinHeight = 150.0f;       // Above the circuit center
+    const float kMaxHeight = 1500.0f;
+    const float kMinSpeed = 50.0f;         // Meters per second
+    const float kMaxSpeed = 150.0f;
+    const float kMaxBank = 60.0f;          // Degrees
+    const float kGravity = 9.81f;
+}
+
+Traffic::Traffic() {
+}
+
+Traffic::~Traffic() {
+}
+
+void Traffic::spawn(int count, const Vector3& center) {
+    clear();
+    random.seed(1);
+    
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const AircraftType types[] = {
+        AircraftType::BOEING_737, AircraftType::F16_FIGHTER, AircraftType::F22_RAPTOR,
+        AircraftType::CESSNA_172, AircraftType::A320_AIRBUS
+    };
+    
+    circuits.reserve(count);
+    for (int i = 0; i < count; i++) {
+        Circuit circuit;
+        circuit.aircraft = std::make_unique<Aircraft>(types[i % 5]);
+        circuit.aircraft->reset();
+        circuit.aircraft->setThrottle(0.6f);        // Cruise power, which sets the exhaust
+        
+        // Spread evenly over the area rather than bunched at the center
+        circuit.radius = std::sqrt(kMinRadius * kMinRadius +
+                                   unit(random) * (kMaxRadius * kMaxRadius - kMinRadius * kMinRadius));
+        circuit.center = center + Vector3(0.0f, kMinHeight + unit(random) * (kMaxHeight - kMinHeight), 0.0f);
+        circuit.angle = unit(random) * 2.0f * PI;
+        
+        // Specs are in km/h
+        float speed = circuit.aircraft->getSpecs().maxSpeed / 3.6f * (0.4f + 0.2f * unit(random));
+        speed = std::max(kMinSpeed, std::min(kMaxSpeed, speed));
+        circuit.angularSpeed = speed / circuit.radius * (unit(random) < 0.5f ? -1.0f : 1.0f);
+        
+        place(circuit);
+        circuits.push_back(std::move(circuit));
+    }
+}
+
+void Traffic::clear() {
+    circuits.clear();
+}
+
+void Traffic::update(float deltaTime) {
+    for (Circuit& circuit : circuits) {
+        circuit.angle = std::fmod(circuit.angle + circuit.angularSpeed * deltaTime, 2.0f * PI);
+        place(circuit);
+    }
+}
+
+void Traffic::appendAircraft(std::vector<const Aircraft*>& aircraft) const {
+    for (const Circuit& circuit : circuits) {
+        aircraft.push_back(circuit.aircraft.get());
+    }
+}
+
+void Traffic::place(Circuit& circuit) const {
+    float s = std::sin(circuit.angle);
+    float c = std::cos(circuit.angle);
+    circuit.aircraft->setPosition(circuit.center + Vector3(c * circuit.radius, 0.0f, s * circuit.radius));
+    
+    // Heading along the tangent (the nose points down -z at zero yaw), banked
+    // for a coordinated turn
+    float direction = circuit.angularSpeed < 0.0f ? -1.0f : 1.0f;
+    Vector3 tangent(-s * direction, 0.0f, c * direction);
+    float yaw = std::atan2(-tangent.x, -tangent.z) * RAD_TO_DEG;
+    float speed = std::fabs(circuit.angularSpeed) * circuit.radius;
+    float bank = std::min(std::atan(speed * speed / (circuit.radius * kGravity)) * RAD_TO_DEG, kMaxBank);
+    
+    // Positive roll raises the right wing; lower the wing facing the center
+    Vector3 right(std::cos(yaw * DEG_TO_RAD), 0.0f, -std::sin(yaw * DEG_TO_RAD));
+    float centerSide = -c * right.x - s * right.z;
+    circuit.aircraft->setRotation(Vector3(0.0f, yaw, centerSide > 0.0f ? -bank : bank));
+    circuit.aircraft->setVelocity(tangent * speed);
+}
@@ -0,0 +1,161 @@
+#include "UIBatch.h"
+#include "GLExtensions.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace {
+    uint8_t toByte(float value) {
+        return (uint8_t)(std::max(0.0f, std::min(1.0f, value)) * 255.0f + 0.5f);
+    }
+    
+    // Every nth point of the unit circle: small circles look the same with 8 or 16 sides
+    int circleStep(float radius) {
+        return radius < 4.0f ? 4 : (radius < 12.0f ? 2 : 1);
+    }
+}
+
+UIBatch::UIBatch() {
+    for (int i = 0; i <= kCircleSegments; i++) {
+        float angle = 2.0f * PI * i / kCircleSegments;
+        circleCos[i] = std::cos(angle);
+        circleSin[i] = std::sin(angle);
+    }
+    
+    triangles.reserve(4096);
+    lines.reserve(8192);
+}
+
+UIBatch::Vertex UIBatch::makeVertex(float x, float y, const Color& color) {
+    Vertex v;
+    v.x = x;
+    v.y = y;
+    v.color[0] = toByte(color.r);
+    v.color[1] = toByte(color.g);
+    v.color[2] = toByte(color.b);
+    v.color[3] = toByte(color.a);
+    return v;
+}
+
+void UIBatch::addTriangle(float x0, float y0, float x1, float y1, float x2, float y2, const Color& color) {
+    triangles.push_back(makeVertex(x0, y0, color));
+    triangles.push_back(makeVertex(x1, y1, color));
+    triangles.push_back(makeVertex(x2, y2, color));
+}
+
+void UIBatch::addRect(float x, float y, float width, float height, const Color& color) {
+    Vertex v0 = makeVertex(x, y, color);
+    Vertex v1 = makeVertex(x + width, y, color);
+    Vertex v2 = makeVertex(x + width, y + height, color);
+    Vertex v3 = makeVertex(x, y + height, color);
+    
+    triangles.push_back(v0);
+    triangles.push_back(v1);
+    triangles.push_back(v2);
+    triangles.push_back(v0);
+    triangles.push_back(v2);
+    triangles.push_back(v3);
+}
+
+void UIBatch::addRectOutline(float x, float y, float width, float height, const Color& color) {
+    Vertex v0 = makeVertex(x, y, color);
+    Vertex v1 = makeVertex(x + width, y, color);
+    Vertex v2 = makeVertex(x + width, y + height, color);
+    Vertex v3 = makeVertex(x, y + height, color);
+    
+    lines.push_back(v0); lines.push_back(v1);
+    lines.push_back(v1); lines.push_back(v2);
+    lines.push_back(v2); lines.push_back(v3);
+    lines.push_back(v3); lines.push_back(v0);
+}
+
+void UIBatch::addCircle(float x, float y, float radius, const Color& color) {
+    Vertex center = makeVertex(x, y, color);
+    Vertex previous = makeVertex(x + radius * circleCos[0], y + radius * circleSin[0], color);
+    
+    int step = circleStep(radius);
+    for (int i = step; i <= kCircleSegments; i += step) {
+        Vertex current = makeVertex(x + radius * circleCos[i], y + radius * circleSin[i], color);
+        triangles.push_back(center);
+        triangles.push_back(previous);
+        triangles.push_back(current);
+        previous = current;
+    }
+}
+
+void UIBatch::addCircleOutline(float x, float y, float radius, const Color& color) {
+    Vertex previous = makeVertex(x + radius * circleCos[0], y + radius * circleSin[0], color);
+    
+    int step = circleStep(radius);
+    for (int i = step; i <= kCircleSegments; i += step) {
+        Vertex current = makeVertex(x + radius * circleCos[i], y + radius * circleSin[i], color);
+        lines.push_back(previous);
+        lines.push_back(current);
+        previous = current;
+    }
+}
+
+void UIBatch::addLine(float x0, float y0, float x1, float y1, const Color& color) {
+    lines.push_back(makeVertex(x0, y0, color));
+    lines.push_back(makeVertex(x1, y1, color));
+}
+
+void UIBatch::addLines(const Vertex* vertices, size_t count) {
+    lines.insert(lines.end(), vertices, vertices + count);
+}
+
+void UIBatch::append(const UIBatch& other) {
+    triangles.insert(triangles.end(), other.triangles.begin(), other.triangles.end());
+    lines.insert(lines.end(), other.lines.begin(), other.lines.end());
+}
+
+void UIBatch::flush(GLStateCache& state, int screenWidth, int screenHeight) {
+    if (empty()) return;
+    
+    // One 2D setup for the whole batch
+    state.matrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0, screenWidth, screenHeight, 0, -1, 1);
+    
+    state.matrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    
+    state.useProgram(0);
+    state.disable(GL_LIGHTING);
+    state.disable(GL_FOG);
+    state.disable(GL_TEXTURE_2D);
+    state.disable(GL_DEPTH_TEST);
+    
+    // Vertices come from client memory
+    state.bindBuffer(GL_ARRAY_BUFFER, 0);
+    state.enableClientState(GL_VERTEX_ARRAY);
+    state.enableClientState(GL_COLOR_ARRAY);
+    state.disableClientState(GL_NORMAL_ARRAY);
+    state.disableClientState(GL_TEXTURE_COORD_ARRAY);
+    
+    if (!triangles.empty()) {
+        glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &triangles[0].x);
+        glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), triangles[0].color);
+        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)triangles.size());
+    }
+    
+    if (!lines.empty()) {
+        glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &lines[0].x);
+        glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), lines[0].color);
+        glDrawArrays(GL_LINES, 0, (GLsizei)lines.size());
+    }
+    
+    state.matrixMode(GL_PROJECTION);
+    glPopMatrix();
+    state.matrixMode(GL_MODELVIEW);
+    glPopMatrix();
+    
+    clear();
+}
+
+void UIBatch::clear() {
+    triangles.clear();
+    lines.clear();
+}
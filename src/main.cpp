@@ -14,12 +14,82 @@
 #include "Game.h"
 #include <iostream>
 #include <memory>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]" << std::endl;
+    std::cout << "  --headless          Render offscreen without a window and print frame timings" << std::endl;
+    std::cout << "  --frames N          Frames to render in headless mode (default 300)" << std::endl;
+    std::cout << "  --size WxH          Headless render resolution (default 1920x1080)" << std::endl;
+    std::cout << "  --output FILE.ppm   Save the last headless frame" << std::endl;
+    std::cout << "  --threads N         Threads building render lists (default one per core)" << std::endl;
+    std::cout << "  --tower-view        Open the tower picture-in-picture view (F4)" << std::endl;
+    std::cout << "  --split-screen      Two players side by side, the second on another controller (F5)" << std::endl;
+    std::cout << "  --traffic N         AI aircraft flying circuits around the airport" << std::endl;
+    std::cout << "  --day-speed H       Hours the time of day advances per second (default 0, noon)" << std::endl;
+    std::cout << "  --airborne          Start the headless flight climbing instead of on the runway" << std::endl;
+    std::cout << "  --capture FILE      Record every frame (.y4m video, .png sequence, else raw rgb24)" << std::endl;
+    std::cout << "  --capture-fps N     Frame rate written to the video header (default 60)" << std::endl;
+}
+
+// Returns false on an unknown or malformed option
+static bool parseOptions(int argc, char* argv[], GameOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        
+        if (std::strcmp(arg, "--headless") == 0) {
+            options.headless = true;
+        } else if (std::strcmp(arg, "--frames") == 0 && hasValue) {
+            options.frames = std::atoi(argv[++i]);
+            if (options.frames <= 0) return false;
+        } else if (std::strcmp(arg, "--size") == 0 && hasValue) {
+            if (std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2 ||
+                options.width <= 0 || options.height <= 0) {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--output") == 0 && hasValue) {
+            options.outputPath = argv[++i];
+        } else if (std::strcmp(arg, "--threads") == 0 && hasValue) {
+            options.renderThreads = std::atoi(argv[++i]);
+            if (options.renderThreads <= 0) return false;
+        } else if (std::strcmp(arg, "--tower-view") == 0) {
+            options.towerView = true;
+        } else if (std::strcmp(arg, "--split-screen") == 0) {
+            options.splitScreen = true;
+        } else if (std::strcmp(arg, "--traffic") == 0 && hasValue) {
+            options.traffic = std::atoi(argv[++i]);
+            if (options.traffic < 0) return false;
+        } else if (std::strcmp(arg, "--day-speed") == 0 && hasValue) {
+            options.daySpeed = (float)std::atof(argv[++i]);
+            if (options.daySpeed < 0.0f) return false;
+        } else if (std::strcmp(arg, "--airborne") == 0) {
+            options.airborne = true;
+        } else if (std::strcmp(arg, "--capture") == 0 && hasValue) {
+            options.capturePath = argv[++i];
+        } else if (std::strcmp(arg, "--capture-fps") == 0 && hasValue) {
+            options.captureFps = std::atoi(argv[++i]);
+            if (options.captureFps <= 0) return false;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
 int main(int argc, char* argv[]) {
-    // Seed random number generator
-    std::srand(static_cast<unsigned>(std::time(nullptr)));
+    GameOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return -1;
+    }
+    
+    // Seed random number generator; headless runs use a fixed seed so
+    // terrain and clouds match between benchmark runs
+    std::srand(options.headless ? 1u : static_cast<unsigned>(std::time(nullptr)));
     
     try {
         std::cout << "==================================" << std::endl;
@@ -29,7 +99,7 @@ int main(int argc, char* argv[]) {
         
         // Create and initialize the game
         auto game = std::make_unique<Game>();
-        if (!game->initialize()) {
+        if (!game->initialize(options)) {
             std::cerr << "ERROR: Failed to initialize game!" << std::endl;
             return -1;
         }